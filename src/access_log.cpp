@@ -0,0 +1,213 @@
+#include "access_log.h"
+
+#include <bit>
+#include <cstdio>
+#include <ctime>
+#include <utility>
+
+#include "json_writer.h"
+
+namespace access_log {
+
+using namespace std::literals;
+
+namespace {
+
+std::atomic<std::uint64_t> next_logger_id{0};
+
+// Кольца текущего потока по номерам журналов; обычно журнал один
+thread_local std::vector<std::pair<std::uint64_t, Ring*>> thread_rings;
+thread_local std::uint64_t thread_requests = 0;
+
+}  // namespace
+
+Ring::Ring(size_t capacity)
+    : slots_(std::bit_ceil(std::max<size_t>(capacity, 2)))
+    , mask_{slots_.size() - 1} {
+}
+
+bool Ring::Push(const Record& record) noexcept {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+        return false;
+    }
+    slots_[tail & mask_] = record;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+Logger::Logger(std::ostream& out, Options options)
+    : out_{out}
+    , options_{options}
+    , id_{next_logger_id.fetch_add(1, std::memory_order_relaxed)}
+    , sample_rate_{std::max<std::uint32_t>(options.sample_rate, 1)}
+    , thread_{[this] {
+        Run();
+    }} {
+}
+
+Logger::~Logger() {
+    Stop();
+}
+
+bool Logger::Sample() noexcept {
+    return ++thread_requests % sample_rate_.load(std::memory_order_relaxed) == 0;
+}
+
+void Logger::LogRequest(const boost::asio::ip::address& address, std::string_view uri, std::string_view method) noexcept {
+    Record record;
+    record.kind = Record::Kind::REQUEST;
+    record.time = std::chrono::system_clock::now();
+    record.address = address;
+    record.uri.Assign(uri);
+    record.method.Assign(method);
+    Push(record);
+}
+
+void Logger::LogResponse(const boost::asio::ip::address& address, std::chrono::milliseconds response_time, int code,
+                         std::string_view content_type) noexcept {
+    Record record;
+    record.kind = Record::Kind::RESPONSE;
+    record.time = std::chrono::system_clock::now();
+    record.address = address;
+    record.code = code;
+    record.response_time_ms = response_time.count();
+    record.content_type.Assign(content_type);
+    Push(record);
+}
+
+void Logger::Push(const Record& record) noexcept {
+    Ring* ring = nullptr;
+    try {
+        ring = GetThreadRing();
+    } catch (...) {
+    }
+    if (!ring || !ring->Push(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+Ring* Logger::GetThreadRing() {
+    for (const auto& [id, ring] : thread_rings) {
+        if (id == id_) {
+            return ring;
+        }
+    }
+    auto ring = std::make_shared<Ring>(options_.ring_capacity);
+    {
+        std::lock_guard lock{rings_mutex_};
+        rings_.push_back(ring);
+    }
+    thread_rings.emplace_back(id_, ring.get());
+    return ring.get();
+}
+
+void Logger::WriteLine(std::string line) {
+    std::lock_guard lock{lines_mutex_};
+    lines_.push_back(std::move(line));
+}
+
+void Logger::Flush() {
+    DrainAll();
+}
+
+void Logger::Stop() {
+    {
+        std::lock_guard lock{stop_mutex_};
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+    DrainAll();
+}
+
+void Logger::Run() {
+    std::unique_lock lock{stop_mutex_};
+    while (!stopping_) {
+        // Поток ввода-вывода никого не будит: журнал сам просыпается раз в flush_period
+        stop_cv_.wait_for(lock, options_.flush_period, [this] {
+            return stopping_;
+        });
+        lock.unlock();
+        DrainAll();
+        lock.lock();
+    }
+}
+
+void Logger::DrainAll() {
+    std::lock_guard drain_lock{drain_mutex_};
+    std::vector<std::string> lines;
+    {
+        std::lock_guard lock{lines_mutex_};
+        lines.swap(lines_);
+    }
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard lock{rings_mutex_};
+        rings = rings_;
+    }
+    batch_.clear();
+    for (const auto& line : lines) {
+        batch_.append(line).push_back('\n');
+    }
+    std::uint64_t written = 0;
+    for (const auto& ring : rings) {
+        written += ring->Drain([this](const Record& record) {
+            Format(record);
+        });
+    }
+    if (const auto dropped = dropped_.load(std::memory_order_relaxed); dropped != reported_dropped_) {
+        json_writer::JsonWriter writer{128};
+        writer.BeginObject()
+            .KeyFragment(R"("data":)").BeginObject().KeyFragment(R"("dropped":)").Int(dropped - reported_dropped_).EndObject()
+            .KeyFragment(R"("message":)").String("log records dropped"sv)
+            .EndObject();
+        batch_.append(writer.View()).push_back('\n');
+        reported_dropped_ = dropped;
+    }
+    if (batch_.empty()) {
+        return;
+    }
+    out_.write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+    out_.flush();
+    written_.fetch_add(written, std::memory_order_relaxed);
+}
+
+void Logger::Format(const Record& record) {
+    // Дата и время с точностью до секунды меняются редко, поэтому форматируются один раз в секунду
+    const auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch());
+    const std::time_t second = since_epoch.count() / 1000000;
+    if (second != formatted_second_) {
+        std::tm tm{};
+        localtime_r(&second, &tm);
+        char buffer[32];
+        second_prefix_.assign(buffer, std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm));
+        formatted_second_ = second;
+    }
+    char fraction[8];
+    std::snprintf(fraction, sizeof(fraction), ".%06d", static_cast<int>(since_epoch.count() % 1000000));
+
+    json_writer::JsonWriter writer{Record::MAX_URI_SIZE + 128};
+    writer.BeginObject().KeyFragment(R"("timestamp":)").String(second_prefix_ + fraction)
+        .KeyFragment(R"("data":)").BeginObject()
+        .KeyFragment(R"("ip":)").String(record.address.to_string());
+    if (record.kind == Record::Kind::REQUEST) {
+        writer.KeyFragment(R"("URI":)").String(record.uri.View())
+            .KeyFragment(R"("method":)").String(record.method.View())
+            .EndObject()
+            .KeyFragment(R"("message":)").String("request received"sv);
+    } else {
+        writer.KeyFragment(R"("response_time":)").Int(record.response_time_ms)
+            .KeyFragment(R"("code":)").Int(record.code)
+            .KeyFragment(R"("content_type":)").String(record.content_type.View())
+            .EndObject()
+            .KeyFragment(R"("message":)").String("response sent"sv);
+    }
+    writer.EndObject();
+    batch_.append(writer.View()).push_back('\n');
+}
+
+}  // namespace access_log
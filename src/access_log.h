@@ -0,0 +1,177 @@
+#pragma once
+
+#include <boost/asio/ip/address.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace access_log {
+
+// Строка фиксированной ёмкости: запись журнала копируется в кольцо без выделения памяти
+template <size_t N>
+class FixedString {
+public:
+    void Assign(std::string_view str) noexcept {
+        size_ = std::min(str.size(), N);
+        std::copy_n(str.data(), size_, data_);
+    }
+
+    std::string_view View() const noexcept {
+        return {data_, size_};
+    }
+
+private:
+    char data_[N]{};
+    size_t size_ = 0;
+};
+
+struct Record {
+    enum class Kind : std::uint8_t {
+        REQUEST,
+        RESPONSE
+    };
+
+    // Длиннее URI обрезается
+    constexpr static size_t MAX_URI_SIZE = 256;
+
+    Kind kind = Kind::REQUEST;
+    std::chrono::system_clock::time_point time;
+    boost::asio::ip::address address;
+    // Только для запроса
+    FixedString<16> method;
+    FixedString<MAX_URI_SIZE> uri;
+    // Только для ответа
+    int code = 0;
+    std::int64_t response_time_ms = 0;
+    FixedString<64> content_type;
+};
+
+/*
+ *  Кольцо записей с одним писателем и одним читателем. Писатель - поток ввода-вывода,
+ *  читатель - поток журнала. Если кольцо заполнено, запись отбрасывается, а не ждёт.
+ */
+class Ring {
+public:
+    explicit Ring(size_t capacity);
+
+    bool Push(const Record& record) noexcept;
+
+    template <typename Fn>
+    size_t Drain(Fn&& fn) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t count = tail - head;
+        for (; head != tail; ++head) {
+            fn(slots_[head & mask_]);
+        }
+        head_.store(head, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<Record> slots_;
+    const size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/*
+ *  Журнал запросов и ответов вне пути обработки запроса. Поток ввода-вывода только
+ *  копирует поля в своё кольцо, а форматирует JSON и пишет в out отдельный поток журнала.
+ *  Строки в том же формате, что у Boost.Log в main.cpp. Записываются только выбранные
+ *  запросы: каждый sample_rate-й в каждом потоке; ответы с кодом 5xx пишутся всегда.
+ */
+class Logger {
+public:
+    struct Options {
+        std::uint32_t sample_rate = 1;
+        size_t ring_capacity = 1024;
+        std::chrono::milliseconds flush_period{20};
+    };
+
+    struct Stats {
+        std::uint64_t written = 0;
+        std::uint64_t dropped = 0;
+    };
+
+    explicit Logger(std::ostream& out, Options options);
+
+    explicit Logger(std::ostream& out)
+        : Logger(out, Options{}) {
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger();
+
+    // Решение о выборке для очередного запроса текущего потока
+    bool Sample() noexcept;
+
+    void SetSampleRate(std::uint32_t sample_rate) noexcept {
+        sample_rate_.store(std::max<std::uint32_t>(sample_rate, 1), std::memory_order_relaxed);
+    }
+
+    void LogRequest(const boost::asio::ip::address& address, std::string_view uri, std::string_view method) noexcept;
+
+    void LogResponse(const boost::asio::ip::address& address, std::chrono::milliseconds response_time, int code,
+                     std::string_view content_type) noexcept;
+
+    // Уже отформатированная строка, например от Boost.Log. Выводится тем же потоком журнала
+    void WriteLine(std::string line);
+
+    // Выводит всё накопленное; вызывается из любого потока
+    void Flush();
+
+    // Выводит остатки и останавливает поток журнала
+    void Stop();
+
+    Stats GetStats() const noexcept {
+        return {written_.load(std::memory_order_relaxed), dropped_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    void Push(const Record& record) noexcept;
+    Ring* GetThreadRing();
+    void Run();
+    void DrainAll();
+    void Format(const Record& record);
+
+    std::ostream& out_;
+    const Options options_;
+    const std::uint64_t id_;
+    std::atomic<std::uint32_t> sample_rate_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+
+    // Кольца читает только тот, кто держит drain_mutex_
+    std::mutex drain_mutex_;
+    std::string batch_;
+    std::time_t formatted_second_ = -1;
+    std::string second_prefix_;
+
+    std::mutex lines_mutex_;
+    std::vector<std::string> lines_;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::uint64_t reported_dropped_ = 0;
+    std::thread thread_;
+};
+
+}  // namespace access_log
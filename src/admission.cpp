@@ -0,0 +1,79 @@
+#include "admission.h"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace admission {
+
+void QueueMonitor::Start(Clock::time_point enqueued) noexcept {
+    const bool drained = depth_.fetch_sub(1, std::memory_order_relaxed) == 1;
+    const Clock::rep wait = (Clock::now() - enqueued).count();
+    // Задачи strand выполняются по одной, поэтому гонки записи здесь нет.
+    // Опустевшая очередь сбрасывает ожидание: иначе после всплеска оно не убывало бы,
+    // пока через strand не пройдут новые запросы
+    const Clock::rep smoothed = wait_.load(std::memory_order_relaxed);
+    wait_.store(drained ? 0 : smoothed + (wait - smoothed) / 8, std::memory_order_relaxed);
+    if (wait > max_wait_.load(std::memory_order_relaxed)) {
+        max_wait_.store(wait, std::memory_order_relaxed);
+    }
+}
+
+bool AdmissionControl::Admit(Priority priority) noexcept {
+    bool admitted = true;
+    if (priority == Priority::LOW) {
+        admitted = queue_.Depth() < options_.shed_depth && queue_.Wait() < options_.shed_wait;
+    } else if (priority == Priority::NORMAL) {
+        admitted = queue_.Depth() < options_.max_depth;
+    }
+    if (!admitted) {
+        shed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return admitted;
+}
+
+RateLimiter::RateLimiter(Options options, size_t shard_count)
+    : options_{options}
+    , shard_count_{std::bit_ceil(std::max<size_t>(shard_count, 1))}
+    , shards_{std::make_unique<Shard[]>(shard_count_)} {
+}
+
+bool RateLimiter::TryAcquire(std::string_view token, Clock::time_point now) {
+    if (!IsEnabled()) {
+        return true;
+    }
+    const auto key = token_table::ParseToken(token);
+    if (!key) {
+        return true;
+    }
+    Shard& shard = shards_[KeyHash{}(*key) & (shard_count_ - 1)];
+    std::lock_guard lock{shard.mutex};
+    const auto refill = [this, now](Bucket& bucket) {
+        // now берётся до блокировки, поэтому соседний поток мог записать время позже
+        if (now > bucket.updated) {
+            const std::chrono::duration<double> elapsed = now - bucket.updated;
+            bucket.tokens = std::min(options_.burst, bucket.tokens + elapsed.count() * options_.rate);
+            bucket.updated = now;
+        }
+    };
+    if (++shard.calls % PRUNE_PERIOD == 0) {
+        // Полная корзина ничем не отличается от новой
+        for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+            refill(it->second);
+            it = it->second.tokens >= options_.burst ? shard.buckets.erase(it) : std::next(it);
+        }
+    }
+    auto [it, inserted] = shard.buckets.try_emplace(*key, Bucket{options_.burst, now});
+    Bucket& bucket = it->second;
+    if (!inserted) {
+        refill(bucket);
+    }
+    if (bucket.tokens < 1.0) {
+        limited_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+}  // namespace admission
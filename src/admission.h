@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "token_table.h"
+
+namespace admission {
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ *  Нагрузка на api_strand: сколько задач ждут в очереди и сколько ждали последние из них.
+ *  Время ожидания сглаживается: каждая задача сдвигает его на 1/8 к своему.
+ *  Пока очередь пуста, ожидание считается нулевым.
+ */
+class QueueMonitor {
+public:
+    // Вызывается перед отправкой задачи в strand, результат передаётся в Start
+    Clock::time_point Enqueue() noexcept {
+        depth_.fetch_add(1, std::memory_order_relaxed);
+        enqueued_.fetch_add(1, std::memory_order_relaxed);
+        return Clock::now();
+    }
+
+    // Вызывается первой строкой задачи, уже внутри strand
+    void Start(Clock::time_point enqueued) noexcept;
+
+    std::int64_t Depth() const noexcept {
+        return depth_.load(std::memory_order_relaxed);
+    }
+
+    Clock::duration Wait() const noexcept {
+        if (Depth() == 0) {
+            return Clock::duration::zero();
+        }
+        return Clock::duration{wait_.load(std::memory_order_relaxed)};
+    }
+
+    Clock::duration MaxWait() const noexcept {
+        return Clock::duration{max_wait_.load(std::memory_order_relaxed)};
+    }
+
+    std::uint64_t Enqueued() const noexcept {
+        return enqueued_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> depth_{0};
+    std::atomic<std::uint64_t> enqueued_{0};
+    std::atomic<Clock::rep> wait_{0};
+    std::atomic<Clock::rep> max_wait_{0};
+};
+
+enum class Priority {
+    // Опрос состояния и рекорды: клиент повторит запрос
+    LOW,
+    // Вход в игру
+    NORMAL,
+    // Действия игроков и тики не отбрасываются никогда
+    CRITICAL
+};
+
+/*
+ *  Отбрасывает запросы заранее, пока они не встали в очередь: при перегрузке api_strand
+ *  первыми отказывают запросам с низким приоритетом, при полной очереди - и входу в игру.
+ *  Запросы LOW в api_strand не попадают, но выполняются на тех же потоках ввода-вывода,
+ *  которые кладут в strand действия игроков. Их отказ освобождает эти потоки
+ */
+class AdmissionControl {
+public:
+    struct Options {
+        // Очередь длиннее или ожидание дольше - перегрузка, запросы LOW отбрасываются
+        std::int64_t shed_depth = 64;
+        Clock::duration shed_wait = std::chrono::milliseconds{50};
+        // Очередь длиннее - отбрасываются и запросы NORMAL
+        std::int64_t max_depth = 1024;
+        // Значение Retry-After в ответе 503
+        std::chrono::seconds retry_after{1};
+    };
+
+    AdmissionControl(const QueueMonitor& queue, Options options)
+        : queue_{queue}
+        , options_{options} {
+    }
+
+    bool Admit(Priority priority) noexcept;
+
+    const Options& GetOptions() const noexcept {
+        return options_;
+    }
+
+    std::uint64_t Shed() const noexcept {
+        return shed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const QueueMonitor& queue_;
+    const Options options_;
+    std::atomic<std::uint64_t> shed_{0};
+};
+
+/*
+ *  Ограничение частоты запросов по токену игрока: корзина на burst запросов,
+ *  которая пополняется со скоростью rate в секунду. rate = 0 отключает ограничение.
+ *  Корзины разбиты на шарды со своими блокировками; давно не тронутые корзины удаляются.
+ */
+class RateLimiter {
+public:
+    struct Options {
+        double rate = 0.0;
+        double burst = 1.0;
+    };
+
+    explicit RateLimiter(Options options, size_t shard_count = 16);
+
+    // false - запрос сверх лимита. Неверный токен не ограничивается: его отвергнет обработчик
+    bool TryAcquire(std::string_view token, Clock::time_point now = Clock::now());
+
+    bool IsEnabled() const noexcept {
+        return options_.rate > 0.0;
+    }
+
+    std::uint64_t Limited() const noexcept {
+        return limited_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Bucket {
+        double tokens = 0.0;
+        Clock::time_point updated;
+    };
+
+    struct KeyHash {
+        size_t operator()(const token_table::TokenKey& key) const noexcept {
+            return static_cast<size_t>(key.hi ^ (key.lo * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<token_table::TokenKey, Bucket, KeyHash> buckets;
+        std::uint64_t calls = 0;
+    };
+
+    // Раз в столько обращений к шарду из него удаляются полные корзины
+    constexpr static std::uint64_t PRUNE_PERIOD = 1024;
+
+    const Options options_;
+    const size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<std::uint64_t> limited_{0};
+};
+
+}  // namespace admission
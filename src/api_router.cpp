@@ -0,0 +1,50 @@
+#include "api_router.h"
+
+namespace api_router {
+
+using namespace std::literals;
+
+Target SplitTarget(std::string_view target) {
+    const size_t query_pos = target.find('?');
+    Target result{target.substr(0, query_pos),
+                  query_pos == std::string_view::npos ? ""sv : target.substr(query_pos + 1)};
+    if (result.path.size() > 1 && result.path.ends_with('/')) {
+        result.path.remove_suffix(1);
+    }
+    return result;
+}
+
+std::optional<std::string_view> QueryParams::Find(std::string_view name) const noexcept {
+    std::string_view query = query_;
+    while (!query.empty()) {
+        const size_t end = query.find('&');
+        const std::string_view pair = query.substr(0, end);
+        query = end == std::string_view::npos ? ""sv : query.substr(end + 1);
+        if (!pair.starts_with(name)) {
+            continue;
+        }
+        if (pair.size() == name.size()) {
+            return ""sv;
+        }
+        if (pair[name.size()] == '=') {
+            return pair.substr(name.size() + 1);
+        }
+    }
+    return std::nullopt;
+}
+
+bool AllowsMethod(std::string_view allow, std::string_view method) noexcept {
+    while (!allow.empty()) {
+        const size_t end = allow.find(',');
+        if (allow.substr(0, end) == method) {
+            return true;
+        }
+        allow = end == std::string_view::npos ? ""sv : allow.substr(end + 1);
+        while (allow.starts_with(' ')) {
+            allow.remove_prefix(1);
+        }
+    }
+    return false;
+}
+
+}  // namespace api_router
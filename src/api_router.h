@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace api_router {
+
+// Путь без строки запроса и завершающего '/' и сама строка запроса
+struct Target {
+    std::string_view path;
+    std::string_view query;
+};
+
+Target SplitTarget(std::string_view target);
+
+/*
+ *  Параметры строки запроса вида a=1&b=2. Ничего не копирует и не выделяет память:
+ *  значения ссылаются на исходную строку и не раскодируются.
+ */
+class QueryParams {
+public:
+    explicit QueryParams(std::string_view query) noexcept
+        : query_{query} {
+    }
+
+    // Первое значение параметра; параметр без '=' считается пустым
+    std::optional<std::string_view> Find(std::string_view name) const noexcept;
+
+private:
+    std::string_view query_;
+};
+
+template <typename Endpoint>
+struct Route {
+    std::string_view path;
+    Endpoint endpoint;
+    // Методы через запятую, как в заголовке Allow
+    std::string_view allow;
+    // Кроме самого пути принимается путь с одним сегментом-параметром: path/<параметр>
+    bool has_parameter = false;
+};
+
+bool AllowsMethod(std::string_view allow, std::string_view method) noexcept;
+
+template <typename Endpoint>
+struct Match {
+    const Route<Endpoint>* route = nullptr;
+    std::string_view parameter;
+    std::string_view query;
+
+    bool Allows(std::string_view method) const noexcept {
+        return AllowsMethod(route->allow, method);
+    }
+};
+
+constexpr std::uint32_t Hash(std::string_view str, std::uint32_t seed) noexcept {
+    std::uint32_t hash = 2166136261u ^ seed;
+    for (const char c : str) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ *  Таблица маршрутов с совершенным хешем, который строится при компиляции:
+ *  подбирается seed, при котором все пути попадают в разные ячейки. Поиск - один проход
+ *  по пути для хеша и одно сравнение строк, ещё по одному для пути с параметром.
+ */
+template <typename Endpoint, size_t N>
+class Router {
+public:
+    constexpr explicit Router(const std::array<Route<Endpoint>, N>& routes)
+        : routes_{routes} {
+        constexpr std::uint32_t MAX_SEED = 1000;
+        while (!TryBuild()) {
+            if (++seed_ == MAX_SEED) {
+                // Вне constexpr не бывает: таблица строится при компиляции
+                throw std::logic_error("duplicate routes");
+            }
+        }
+    }
+
+    std::optional<Match<Endpoint>> Find(std::string_view target) const noexcept {
+        const auto [path, query] = SplitTarget(target);
+        if (const auto* route = Lookup(path)) {
+            return Match<Endpoint>{route, {}, query};
+        }
+        if (const size_t slash = path.rfind('/'); slash != std::string_view::npos) {
+            const auto* route = Lookup(path.substr(0, slash));
+            if (route && route->has_parameter && slash + 1 < path.size()) {
+                return Match<Endpoint>{route, path.substr(slash + 1), query};
+            }
+        }
+        return std::nullopt;
+    }
+
+    constexpr const std::array<Route<Endpoint>, N>& Routes() const noexcept {
+        return routes_;
+    }
+
+private:
+    constexpr static size_t SLOTS = std::bit_ceil(N * 4);
+    constexpr static std::uint8_t EMPTY = 0xFF;
+    static_assert(N < EMPTY);
+
+    constexpr bool TryBuild() {
+        slots_.fill(EMPTY);
+        for (size_t i = 0; i < N; ++i) {
+            auto& slot = slots_[Hash(routes_[i].path, seed_) & (SLOTS - 1)];
+            if (slot != EMPTY) {
+                return false;
+            }
+            slot = static_cast<std::uint8_t>(i);
+        }
+        return true;
+    }
+
+    const Route<Endpoint>* Lookup(std::string_view path) const noexcept {
+        const auto slot = slots_[Hash(path, seed_) & (SLOTS - 1)];
+        return slot != EMPTY && routes_[slot].path == path ? &routes_[slot] : nullptr;
+    }
+
+    std::array<Route<Endpoint>, N> routes_;
+    std::array<std::uint8_t, SLOTS> slots_{};
+    std::uint32_t seed_ = 0;
+};
+
+}  // namespace api_router
@@ -0,0 +1,83 @@
+#include "binary_encoder.h"
+
+#include <bit>
+#include <cstring>
+
+#include "snapshot.h"
+
+namespace binary_encoder {
+
+namespace {
+
+class Writer {
+public:
+    explicit Writer(size_t size)
+        : buffer_(size, '\0') {
+    }
+
+    template <typename T>
+    Writer& Put(T value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return Put(std::bit_cast<snapshot::detail::UnsignedOfSize<T>>(value));
+        } else {
+            value = snapshot::detail::ToLittleEndian(value);
+            std::memcpy(buffer_.data() + offset_, &value, sizeof(value));
+            offset_ += sizeof(value);
+            return *this;
+        }
+    }
+
+    Writer& PutBytes(std::string_view bytes) {
+        std::memcpy(buffer_.data() + offset_, bytes.data(), bytes.size());
+        offset_ += bytes.size();
+        return *this;
+    }
+
+    std::string Release() {
+        return std::move(buffer_);
+    }
+
+private:
+    std::string buffer_;
+    size_t offset_ = 0;
+};
+
+}  // namespace
+
+std::string GameStateToBinary(const model::SessionSnapshot& snapshot) {
+    // Размер известен заранее, поэтому буфер выделяется один раз
+    size_t size = HEADER_SIZE + snapshot.dogs.size() * DOG_SIZE + snapshot.lost_objects.size() * LOOT_SIZE;
+    for (const auto& dog : snapshot.dogs) {
+        size += dog.bag.size() * BAG_ITEM_SIZE;
+    }
+
+    Writer writer{size};
+    writer.PutBytes(MAGIC)
+        .Put(snapshot.session_serial)
+        .Put(snapshot.version)
+        .Put(static_cast<std::uint32_t>(snapshot.dogs.size()))
+        .Put(static_cast<std::uint32_t>(snapshot.lost_objects.size()));
+    for (const auto& dog : snapshot.dogs) {
+        writer.Put(static_cast<std::uint64_t>(*dog.id))
+            .Put(static_cast<float>(dog.x))
+            .Put(static_cast<float>(dog.y))
+            .Put(static_cast<float>(dog.dx))
+            .Put(static_cast<float>(dog.dy))
+            .Put(static_cast<std::int32_t>(dog.score))
+            .Put(static_cast<std::uint8_t>(dog.dir.empty() ? 'U' : dog.dir.front()))
+            .Put(std::uint8_t{0})
+            .Put(static_cast<std::uint16_t>(dog.bag.size()));
+        for (const auto& [id, type] : dog.bag) {
+            writer.Put(static_cast<std::int32_t>(id)).Put(static_cast<std::int32_t>(type));
+        }
+    }
+    for (const auto& item : snapshot.lost_objects) {
+        writer.Put(static_cast<std::int32_t>(item.id))
+            .Put(static_cast<std::int32_t>(item.type))
+            .Put(static_cast<float>(item.x))
+            .Put(static_cast<float>(item.y));
+    }
+    return writer.Release();
+}
+
+}  // namespace binary_encoder
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "model.h"
+
+namespace binary_encoder {
+
+/*
+ *  Состояние сессии в виде потока записей фиксированного размера, все числа little-endian.
+ *  Заголовок, 28 байт:
+ *      char[4] "DSST", u64 номер сессии, u64 версия снимка, u32 число собак, u32 число трофеев.
+ *      Номер сессии и версия, записанные через точку, - токен для ?since=
+ *  Собака, 32 байта и по 8 байт на каждый предмет в рюкзаке:
+ *      u64 id, f32 x, f32 y, f32 dx, f32 dy, i32 score, u8 направление ('U', 'R', 'D', 'L'),
+ *      u8 0, u16 число предметов, затем предметы: i32 id, i32 type
+ *  Трофей, 16 байт:
+ *      i32 id, i32 type, f32 x, f32 y
+ *  Декодер для браузера - static/js/state_decoder.js
+ */
+constexpr std::string_view MAGIC = "DSST";
+constexpr size_t HEADER_SIZE = 28;
+constexpr size_t DOG_SIZE = 32;
+constexpr size_t BAG_ITEM_SIZE = 8;
+constexpr size_t LOOT_SIZE = 16;
+
+std::string GameStateToBinary(const model::SessionSnapshot& snapshot);
+
+}  // namespace binary_encoder
@@ -0,0 +1,135 @@
+#include "byte_range.h"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+
+namespace byte_range {
+
+using namespace std::literals;
+
+namespace {
+
+std::string_view Trim(std::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+std::optional<std::uint64_t> ParseNumber(std::string_view str) {
+    std::uint64_t value = 0;
+    const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (str.empty() || error != std::errc{} || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+}  // namespace
+
+ParsedRanges ParseRange(std::string_view header, std::uint64_t size) {
+    constexpr auto UNIT = "bytes="sv;
+    ParsedRanges result;
+    header = Trim(header);
+    if (!header.starts_with(UNIT)) {
+        return result;
+    }
+    header.remove_prefix(UNIT.size());
+
+    std::vector<Range> ranges;
+    size_t specs = 0;
+    while (!header.empty()) {
+        const size_t comma = header.find(',');
+        const std::string_view spec = Trim(header.substr(0, comma));
+        header.remove_prefix(comma == std::string_view::npos ? header.size() : comma + 1);
+        if (spec.empty()) {
+            continue;
+        }
+        if (++specs > MAX_RANGES) {
+            return result;
+        }
+        const size_t dash = spec.find('-');
+        if (dash == std::string_view::npos) {
+            return result;
+        }
+        const auto first = spec.substr(0, dash);
+        const auto last = spec.substr(dash + 1);
+        if (first.empty()) {
+            // "-n": последние n байтов
+            const auto suffix = ParseNumber(last);
+            if (!suffix) {
+                return result;
+            }
+            if (*suffix > 0 && size > 0) {
+                ranges.push_back({size - std::min(*suffix, size), size - 1});
+            }
+            continue;
+        }
+        const auto first_byte = ParseNumber(first);
+        const auto last_byte = last.empty() ? std::optional<std::uint64_t>{UINT64_MAX} : ParseNumber(last);
+        if (!first_byte || !last_byte || *last_byte < *first_byte) {
+            return result;
+        }
+        if (*first_byte < size) {
+            ranges.push_back({*first_byte, std::min(*last_byte, size - 1)});
+        }
+    }
+    if (specs == 0) {
+        return result;
+    }
+    // Диапазоны, которые в сумме длиннее тела, перекрываются: проще отдать всё тело
+    std::uint64_t total = 0;
+    for (const auto& range : ranges) {
+        total += range.Size();
+    }
+    if (total > size) {
+        return result;
+    }
+    // Перекрывающиеся и соседние диапазоны объединяются (RFC 7233, 6.1)
+    std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) {
+        return lhs.first < rhs.first;
+    });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= ranges[merged].last + 1) {
+            ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    if (!ranges.empty()) {
+        ranges.resize(merged + 1);
+    }
+    result.status = ranges.empty() ? ParsedRanges::Status::UNSATISFIABLE : ParsedRanges::Status::SATISFIABLE;
+    result.ranges = std::move(ranges);
+    return result;
+}
+
+std::string ContentRange(const Range& range, std::uint64_t size) {
+    return "bytes "s + std::to_string(range.first) + "-"s + std::to_string(range.last) + "/"s + std::to_string(size);
+}
+
+std::string MakeMultipartBody(std::string_view content, const std::vector<Range>& ranges,
+                              std::string_view content_type, std::string_view boundary) {
+    std::string body;
+    size_t size = 0;
+    for (const auto& range : ranges) {
+        size += range.Size() + boundary.size() + content_type.size() + 96;
+    }
+    body.reserve(size);
+    for (const auto& range : ranges) {
+        body.append("\r\n--"sv).append(boundary)
+            .append("\r\nContent-Type: "sv).append(content_type)
+            .append("\r\nContent-Range: "sv).append(ContentRange(range, content.size()))
+            .append("\r\n\r\n"sv)
+            .append(content.substr(range.first, range.Size()));
+    }
+    body.append("\r\n--"sv).append(boundary).append("--\r\n"sv);
+    return body;
+}
+
+}  // namespace byte_range
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace byte_range {
+
+// Диапазон байтов [first, last], обе границы включены, как в заголовке Range
+struct Range {
+    std::uint64_t first = 0;
+    std::uint64_t last = 0;
+
+    std::uint64_t Size() const noexcept {
+        return last - first + 1;
+    }
+
+    bool operator==(const Range&) const = default;
+};
+
+struct ParsedRanges {
+    enum class Status {
+        // Заголовок неверный или не про байты: отдаётся всё тело с кодом 200
+        IGNORED,
+        SATISFIABLE,
+        // Ни один диапазон не попадает в тело: 416
+        UNSATISFIABLE
+    };
+
+    Status status = Status::IGNORED;
+    std::vector<Range> ranges;
+};
+
+// Больше диапазонов в одном запросе не обслуживается, такой Range игнорируется
+constexpr size_t MAX_RANGES = 16;
+
+// Разбирает заголовок Range вида "bytes=0-99, 200-, -50" для тела размера size.
+// Диапазоны обрезаются по размеру тела, не попадающие в тело отбрасываются,
+// остальные сортируются и сливаются. Если в сумме они длиннее тела, заголовок игнорируется
+ParsedRanges ParseRange(std::string_view header, std::uint64_t size);
+
+// Значение Content-Range для диапазона, например "bytes 0-99/1000"
+std::string ContentRange(const Range& range, std::uint64_t size);
+
+// Тело multipart/byteranges для нескольких диапазонов content
+std::string MakeMultipartBody(std::string_view content, const std::vector<Range>& ranges,
+                              std::string_view content_type, std::string_view boundary);
+
+}  // namespace byte_range
@@ -1,5 +1,11 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLLISION_DETECTOR_X86
+#endif
 
 namespace collision_detector {
 
@@ -22,38 +28,284 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
-std::vector<GatheringEvent> FindGatherEvents(
-    const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> detected_events;
+namespace {
+
+// Параметры пути собирателя, общие для всех проверяемых предметов
+struct GathererPath {
+    double a_x;
+    double a_y;
+    double v_x;
+    double v_y;
+    double v_len2;
+    double width;
+};
+
+void PushEvent(size_t item_id, size_t gatherer_id, double sq_distance, double proj_ratio,
+               std::vector<GatheringEvent>& events) {
+    events.push_back({.item_id = item_id,
+                      .gatherer_id = gatherer_id,
+                      .sq_distance = sq_distance,
+                      .time = proj_ratio});
+}
+
+// Те же вычисления, что и в TryCollectPoint, в том же порядке операций,
+// чтобы все ядра давали одинаковые результаты
+void CollectScalar(const GathererPath& path, size_t gatherer_id, const ItemBatch& items, size_t begin,
+                   std::vector<GatheringEvent>& events) {
+    for (size_t i = begin; i < items.Size(); ++i) {
+        const double u_x = items.xs[i] - path.a_x;
+        const double u_y = items.ys[i] - path.a_y;
+        const double u_dot_v = u_x * path.v_x + u_y * path.v_y;
+        const double u_len2 = u_x * u_x + u_y * u_y;
+        const CollectionResult result{u_len2 - (u_dot_v * u_dot_v) / path.v_len2, u_dot_v / path.v_len2};
+        if (result.IsCollected(path.width + items.widths[i])) {
+            PushEvent(i, gatherer_id, result.sq_distance, result.proj_ratio, events);
+        }
+    }
+}
+
+#ifdef COLLISION_DETECTOR_X86
+
+__attribute__((target("sse2")))
+void CollectSse2(const GathererPath& path, size_t gatherer_id, const ItemBatch& items,
+                 std::vector<GatheringEvent>& events) {
+    const __m128d a_x = _mm_set1_pd(path.a_x);
+    const __m128d a_y = _mm_set1_pd(path.a_y);
+    const __m128d v_x = _mm_set1_pd(path.v_x);
+    const __m128d v_y = _mm_set1_pd(path.v_y);
+    const __m128d v_len2 = _mm_set1_pd(path.v_len2);
+    const __m128d width = _mm_set1_pd(path.width);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+
+    constexpr size_t LANES = 2;
+    const size_t count = items.Size() / LANES * LANES;
+    alignas(16) double sq_distances[LANES];
+    alignas(16) double proj_ratios[LANES];
+    for (size_t i = 0; i < count; i += LANES) {
+        const __m128d u_x = _mm_sub_pd(_mm_loadu_pd(&items.xs[i]), a_x);
+        const __m128d u_y = _mm_sub_pd(_mm_loadu_pd(&items.ys[i]), a_y);
+        const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(u_x, v_x), _mm_mul_pd(u_y, v_y));
+        const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(u_x, u_x), _mm_mul_pd(u_y, u_y));
+        const __m128d proj_ratio = _mm_div_pd(u_dot_v, v_len2);
+        const __m128d sq_distance = _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m128d radius = _mm_add_pd(width, _mm_loadu_pd(&items.widths[i]));
+        const __m128d collected = _mm_and_pd(
+            _mm_and_pd(_mm_cmpge_pd(proj_ratio, zero), _mm_cmple_pd(proj_ratio, one)),
+            _mm_cmple_pd(sq_distance, _mm_mul_pd(radius, radius)));
+        int mask = _mm_movemask_pd(collected);
+        if (mask == 0) {
+            continue;
+        }
+        _mm_store_pd(sq_distances, sq_distance);
+        _mm_store_pd(proj_ratios, proj_ratio);
+        for (; mask != 0; mask &= mask - 1) {
+            const int lane = __builtin_ctz(mask);
+            PushEvent(i + lane, gatherer_id, sq_distances[lane], proj_ratios[lane], events);
+        }
+    }
+    CollectScalar(path, gatherer_id, items, count, events);
+}
 
-    static auto eq_pt = [](geom::Point2D p1, geom::Point2D p2) {
-        return p1.x == p2.x && p1.y == p2.y;
-    };
+__attribute__((target("avx2")))
+void CollectAvx2(const GathererPath& path, size_t gatherer_id, const ItemBatch& items,
+                 std::vector<GatheringEvent>& events) {
+    const __m256d a_x = _mm256_set1_pd(path.a_x);
+    const __m256d a_y = _mm256_set1_pd(path.a_y);
+    const __m256d v_x = _mm256_set1_pd(path.v_x);
+    const __m256d v_y = _mm256_set1_pd(path.v_y);
+    const __m256d v_len2 = _mm256_set1_pd(path.v_len2);
+    const __m256d width = _mm256_set1_pd(path.width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
 
-    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-        Gatherer gatherer = provider.GetGatherer(g);
-        if (eq_pt(gatherer.start_pos, gatherer.end_pos)) {
+    constexpr size_t LANES = 4;
+    const size_t count = items.Size() / LANES * LANES;
+    alignas(32) double sq_distances[LANES];
+    alignas(32) double proj_ratios[LANES];
+    for (size_t i = 0; i < count; i += LANES) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(&items.xs[i]), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(&items.ys[i]), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x), _mm256_mul_pd(u_y, v_y));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len2);
+        const __m256d sq_distance = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m256d radius = _mm256_add_pd(width, _mm256_loadu_pd(&items.widths[i]));
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_distance, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+        int mask = _mm256_movemask_pd(collected);
+        if (mask == 0) {
             continue;
         }
-        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-            Item item = provider.GetItem(i);
-            auto collect_result
-                = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-
-            if (collect_result.IsCollected(gatherer.width + item.width)) {
-                GatheringEvent evt{.item_id = i,
-                                   .gatherer_id = g,
-                                   .sq_distance = collect_result.sq_distance,
-                                   .time = collect_result.proj_ratio};
-                detected_events.push_back(evt);
+        _mm256_store_pd(sq_distances, sq_distance);
+        _mm256_store_pd(proj_ratios, proj_ratio);
+        for (; mask != 0; mask &= mask - 1) {
+            const int lane = __builtin_ctz(mask);
+            PushEvent(i + lane, gatherer_id, sq_distances[lane], proj_ratios[lane], events);
+        }
+    }
+    CollectScalar(path, gatherer_id, items, count, events);
+}
+
+#endif
+
+}  // namespace
+
+bool IsKernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::SCALAR:
+            return true;
+#ifdef COLLISION_DETECTOR_X86
+        case Kernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+Kernel DetectKernel() {
+    static const Kernel kernel = [] {
+        for (Kernel candidate : {Kernel::AVX2, Kernel::SSE2}) {
+            if (IsKernelSupported(candidate)) {
+                return candidate;
             }
         }
+        return Kernel::SCALAR;
+    }();
+    return kernel;
+}
+
+void CollectItems(const Gatherer& gatherer, size_t gatherer_id, const ItemBatch& items,
+                  std::vector<GatheringEvent>& events, Kernel kernel) {
+    if (gatherer.start_pos.x == gatherer.end_pos.x && gatherer.start_pos.y == gatherer.end_pos.y) {
+        return;
     }
+    const double v_x = gatherer.end_pos.x - gatherer.start_pos.x;
+    const double v_y = gatherer.end_pos.y - gatherer.start_pos.y;
+    const GathererPath path{gatherer.start_pos.x, gatherer.start_pos.y, v_x, v_y, v_x * v_x + v_y * v_y, gatherer.width};
+    switch (kernel) {
+#ifdef COLLISION_DETECTOR_X86
+        case Kernel::AVX2:
+            return CollectAvx2(path, gatherer_id, items, events);
+        case Kernel::SSE2:
+            return CollectSse2(path, gatherer_id, items, events);
+#endif
+        default:
+            return CollectScalar(path, gatherer_id, items, 0, events);
+    }
+}
 
-    std::sort(detected_events.begin(), detected_events.end(),
+void SortByTime(std::vector<GatheringEvent>& events) {
+    std::sort(events.begin(), events.end(),
               [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
                   return e_l.time < e_r.time;
               });
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    return FindGatherEvents<ItemGathererProvider>(provider);
+}
+
+void ItemGrid::Insert(ItemId id, Item item) {
+    Erase(id);
+    const CellKey key = MakeKey(ToCell(item.position.x), ToCell(item.position.y));
+    Cell& cell = cells_[key];
+    cell.ids.push_back(id);
+    cell.items.Add(item);
+    id_to_cell_[id] = key;
+    max_item_width_ = std::max(max_item_width_, item.width);
+}
+
+void ItemGrid::Erase(ItemId id) {
+    auto it = id_to_cell_.find(id);
+    if (it == id_to_cell_.end()) {
+        return;
+    }
+    auto cell = cells_.find(it->second);
+    auto& ids = cell->second.ids;
+    const size_t idx = std::find(ids.begin(), ids.end(), id) - ids.begin();
+    ids[idx] = ids.back();
+    ids.pop_back();
+    cell->second.items.SwapRemove(idx);
+    if (ids.empty()) {
+        cells_.erase(cell);
+    }
+    id_to_cell_.erase(it);
+}
+
+void ItemGrid::Clear() {
+    cells_.clear();
+    id_to_cell_.clear();
+    max_item_width_ = 0.0;
+}
+
+void ItemGrid::FindGatherEvents(const std::vector<Gatherer>& gatherers, size_t layer,
+                                std::vector<GatheringEvent>& events) const {
+    if (cells_.empty()) {
+        return;
+    }
+    const Kernel kernel = DetectKernel();
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        const Gatherer& gatherer = gatherers[g];
+        if (gatherer.start_pos.x == gatherer.end_pos.x && gatherer.start_pos.y == gatherer.end_pos.y) {
+            continue;
+        }
+        // Предмет может быть собран, только если он лежит в прямоугольнике,
+        // описанном вокруг пути собирателя и расширенном на сумму радиусов
+        const double margin = gatherer.width + max_item_width_;
+        const std::int64_t min_x = ToCell(std::min(gatherer.start_pos.x, gatherer.end_pos.x) - margin);
+        const std::int64_t max_x = ToCell(std::max(gatherer.start_pos.x, gatherer.end_pos.x) + margin);
+        const std::int64_t min_y = ToCell(std::min(gatherer.start_pos.y, gatherer.end_pos.y) - margin);
+        const std::int64_t max_y = ToCell(std::max(gatherer.start_pos.y, gatherer.end_pos.y) + margin);
+        const double cells_crossed = static_cast<double>(max_x - min_x + 1) * static_cast<double>(max_y - min_y + 1);
+        if (cells_crossed > static_cast<double>(cells_.size())) {
+            // Путь длиннее, чем заполненная часть сетки: дешевле обойти все непустые ячейки
+            for (const auto& [key, cell] : cells_) {
+                CollectFromCell(cell, gatherer, g, layer, kernel, events);
+            }
+            continue;
+        }
+        for (std::int64_t x = min_x; x <= max_x; ++x) {
+            for (std::int64_t y = min_y; y <= max_y; ++y) {
+                if (auto it = cells_.find(MakeKey(x, y)); it != cells_.end()) {
+                    CollectFromCell(it->second, gatherer, g, layer, kernel, events);
+                }
+            }
+        }
+    }
+}
+
+std::int64_t ItemGrid::ToCell(double coord) const {
+    return static_cast<std::int64_t>(std::floor(coord / cell_size_));
+}
+
+ItemGrid::CellKey ItemGrid::MakeKey(std::int64_t cell_x, std::int64_t cell_y) {
+    return (static_cast<CellKey>(cell_x) << 32) ^ static_cast<std::uint32_t>(cell_y);
+}
+
+void ItemGrid::CollectFromCell(const Cell& cell, const Gatherer& gatherer, size_t gatherer_id,
+                               size_t layer, Kernel kernel, std::vector<GatheringEvent>& events) {
+    const size_t first = events.size();
+    CollectItems(gatherer, gatherer_id, cell.items, events, kernel);
+    for (size_t i = first; i < events.size(); ++i) {
+        events[i].item_id = cell.ids[events[i].item_id];
+        events[i].layer = layer;
+    }
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const std::vector<Gatherer>& gatherers,
+                                             std::initializer_list<const ItemGrid*> layers) {
+    std::vector<GatheringEvent> detected_events;
+    size_t layer = 0;
+    for (const ItemGrid* grid : layers) {
+        grid->FindGatherEvents(gatherers, layer++, detected_events);
+    }
+
+    SortByTime(detected_events);
 
     return detected_events;
 }
@@ -3,6 +3,10 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
 #include <vector>
 
 namespace collision_detector {
@@ -34,6 +38,71 @@ struct Gatherer {
     double width;
 };
 
+struct GatheringEvent {
+    size_t item_id;
+    size_t gatherer_id;
+    double sq_distance;
+    double time;
+    // номер слоя ItemGrid, в котором найден предмет
+    size_t layer = 0;
+};
+
+/*
+ *  Предметы в виде структуры массивов: координаты и радиусы лежат в отдельных
+ *  непрерывных массивах, что позволяет проверять сразу несколько предметов
+ *  одной векторной инструкцией.
+ */
+struct ItemBatch {
+    void Reserve(size_t count) {
+        xs.reserve(count);
+        ys.reserve(count);
+        widths.reserve(count);
+    }
+
+    void Add(const Item& item) {
+        xs.push_back(item.position.x);
+        ys.push_back(item.position.y);
+        widths.push_back(item.width);
+    }
+
+    // Удаляет предмет, перемещая на его место последний
+    void SwapRemove(size_t idx) {
+        xs[idx] = xs.back();
+        ys[idx] = ys.back();
+        widths[idx] = widths.back();
+        xs.pop_back();
+        ys.pop_back();
+        widths.pop_back();
+    }
+
+    size_t Size() const {
+        return xs.size();
+    }
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> widths;
+};
+
+// Реализация проверки пачки предметов
+enum class Kernel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+bool IsKernelSupported(Kernel kernel);
+
+// Самое быстрое ядро, поддерживаемое процессором. Определяется один раз при первом вызове.
+Kernel DetectKernel();
+
+// Добавляет в events события сбора предметов items собирателем gatherer.
+// item_id события - индекс предмета в items. Неподвижный собиратель ничего не собирает.
+void CollectItems(const Gatherer& gatherer, size_t gatherer_id, const ItemBatch& items,
+                  std::vector<GatheringEvent>& events, Kernel kernel = DetectKernel());
+
+void SortByTime(std::vector<GatheringEvent>& events);
+
 class ItemGathererProvider {
 protected:
     virtual ~ItemGathererProvider() = default;
@@ -45,12 +114,12 @@ public:
     virtual Gatherer GetGatherer(size_t idx) const = 0;
 };
 
-class VectorItemGathererProvider : public collision_detector::ItemGathererProvider {
+class VectorItemGathererProvider final : public collision_detector::ItemGathererProvider {
 public:
     VectorItemGathererProvider(std::vector<collision_detector::Item> items,
                                std::vector<collision_detector::Gatherer> gatherers)
-        : items_(items)
-        , gatherers_(gatherers) {
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
     }
 
 
@@ -58,13 +127,13 @@ public:
         return items_.size();
     }
     collision_detector::Item GetItem(size_t idx) const override {
-        return items_.at(idx);
+        return items_[idx];
     }
     size_t GatherersCount() const override {
         return gatherers_.size();
     }
     collision_detector::Gatherer GetGatherer(size_t idx) const override {
-        return gatherers_.at(idx);
+        return gatherers_[idx];
     }
 
 private:
@@ -72,13 +141,84 @@ private:
     std::vector<collision_detector::Gatherer> gatherers_;
 };
 
-struct GatheringEvent {
-    size_t item_id;
-    size_t gatherer_id;
-    double sq_distance;
-    double time;
+// Любой тип с интерфейсом ItemGathererProvider, не обязательно наследник
+template <typename Provider>
+concept ItemGathererSource = requires(const Provider& provider, size_t idx) {
+    { provider.ItemsCount() } -> std::convertible_to<size_t>;
+    { provider.GetItem(idx) } -> std::convertible_to<Item>;
+    { provider.GatherersCount() } -> std::convertible_to<size_t>;
+    { provider.GetGatherer(idx) } -> std::convertible_to<Gatherer>;
 };
 
+// Предметы запрашиваются у провайдера один раз и складываются в ItemBatch,
+// после чего каждый собиратель проверяется по всей пачке без виртуальных вызовов
+template <ItemGathererSource Provider>
+std::vector<GatheringEvent> FindGatherEvents(const Provider& provider) {
+    ItemBatch items;
+    items.Reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.Add(provider.GetItem(i));
+    }
+
+    const Kernel kernel = DetectKernel();
+    std::vector<GatheringEvent> detected_events;
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        CollectItems(provider.GetGatherer(g), g, items, detected_events, kernel);
+    }
+    SortByTime(detected_events);
+
+    return detected_events;
+}
+
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+/*
+ *  Пространственная сетка предметов.
+ *  Предметы раскладываются по квадратным ячейкам, и при поиске событий сбора
+ *  проверяются только предметы из ячеек, которые пересекает путь собирателя.
+ *  Сетка обновляется по одному предмету, поэтому её не нужно перестраивать на каждом тике.
+ */
+class ItemGrid {
+public:
+    using ItemId = size_t;
+
+    explicit ItemGrid(double cell_size = 1.0)
+        : cell_size_{cell_size} {
+    }
+
+    void Insert(ItemId id, Item item);
+    void Erase(ItemId id);
+    void Clear();
+
+    size_t ItemsCount() const {
+        return id_to_cell_.size();
+    }
+
+    // Добавляет в events события сбора предметов этой сетки собирателями gatherers
+    void FindGatherEvents(const std::vector<Gatherer>& gatherers, size_t layer,
+                          std::vector<GatheringEvent>& events) const;
+
+private:
+    using CellKey = std::uint64_t;
+
+    struct Cell {
+        std::vector<ItemId> ids;
+        ItemBatch items;
+    };
+
+    std::int64_t ToCell(double coord) const;
+    static CellKey MakeKey(std::int64_t cell_x, std::int64_t cell_y);
+    static void CollectFromCell(const Cell& cell, const Gatherer& gatherer, size_t gatherer_id,
+                                size_t layer, Kernel kernel, std::vector<GatheringEvent>& events);
+
+    double cell_size_;
+    double max_item_width_ = 0.0;
+    std::unordered_map<CellKey, Cell> cells_;
+    std::unordered_map<ItemId, CellKey> id_to_cell_;
+};
+
+// Ищет события сбора во всех слоях. Поле layer события - индекс слоя в layers.
+std::vector<GatheringEvent> FindGatherEvents(const std::vector<Gatherer>& gatherers,
+                                             std::initializer_list<const ItemGrid*> layers);
+
 }  // namespace collision_detector
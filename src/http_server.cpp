@@ -20,7 +20,11 @@ void SessionBase::Run() {
 }
 
 void SessionBase::Read() {
+    // Прошлый запрос отпускает арену, и если обработчики её тоже отпустили, она переиспользуется
     request_ = {};
+    request_arena::Recycle(arena_);
+    const RequestAllocator allocator{arena_};
+    request_ = HttpRequest{std::piecewise_construct, std::make_tuple(allocator), std::make_tuple(allocator)};
     stream_.expires_after(30s);
     http::async_read(stream_, buffer_, request_,
                      beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
@@ -46,6 +50,50 @@ void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std
     Read();
 }
 
+void SessionBase::Write(SendfileResponse&& response) {
+    auto safe_response = std::make_shared<SendfileResponse>(std::move(response));
+    auto serializer = std::make_shared<http::response_serializer<sendfile_body::SendfileBody>>(*safe_response);
+    auto self = GetSharedThis();
+    http::async_write_header(stream_, *serializer,
+                             [safe_response, serializer, self](beast::error_code ec, std::size_t bytes_written) {
+                                 if (ec) {
+                                     return self->OnWrite(true, ec, bytes_written);
+                                 }
+                                 self->SendFile(safe_response, 0);
+                             });
+}
+
+void SessionBase::SendFile(std::shared_ptr<SendfileResponse> response, std::uint64_t offset) {
+    // Сколько отправить, прежде чем уступить поток другим соединениям
+    constexpr std::uint64_t MAX_BYTES_PER_TURN = 16 * sendfile_body::MAX_CHUNK;
+    auto& socket = stream_.socket();
+    beast::error_code ec;
+    if (!socket.native_non_blocking()) {
+        socket.native_non_blocking(true, ec);
+    }
+    const std::uint64_t size = response->body().size();
+    const std::uint64_t turn_end = std::min(size, offset + MAX_BYTES_PER_TURN);
+    while (!ec && offset < turn_end) {
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(turn_end - offset, sendfile_body::MAX_CHUNK));
+        sendfile_body::SendChunk(socket.native_handle(), response->body().file().native_handle(), offset, count, ec);
+    }
+    if (ec == net::error::would_block) {
+        return socket.async_wait(tcp::socket::wait_write,
+                                 [self = GetSharedThis(), response = std::move(response), offset](beast::error_code ec) mutable {
+                                     if (ec) {
+                                         return self->OnWrite(true, ec, 0);
+                                     }
+                                     self->SendFile(std::move(response), offset);
+                                 });
+    }
+    if (!ec && offset < size) {
+        return net::post(stream_.get_executor(), [self = GetSharedThis(), response = std::move(response), offset]() mutable {
+            self->SendFile(std::move(response), offset);
+        });
+    }
+    OnWrite(response->need_eof(), ec, offset);
+}
+
 void SessionBase::Close() {
     beast::error_code ec;
     stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
@@ -54,4 +102,114 @@ void SessionBase::Close() {
     }
 }
 
+void StreamSession::Run(HttpRequest&& request) {
+    request_ = std::move(request);
+    net::dispatch(ws_.get_executor(), [self = shared_from_this()] {
+        self->ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        self->ws_.read_message_max(MAX_STREAM_MESSAGE_SIZE);
+        self->ws_.async_accept(self->request_, beast::bind_front_handler(&StreamSession::OnAccept, self));
+    });
+}
+
+void StreamSession::Push(stream_hub::Frame frame) {
+    net::post(ws_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() mutable {
+        if (self->frames_.Put(std::move(frame)) && self->open_) {
+            self->Write();
+        }
+    });
+}
+
+void StreamSession::OnAccept(beast::error_code ec) {
+    if (ec) {
+        return ReportError(ec, "accept stream"sv);
+    }
+    open_ = true;
+    request_ = {};
+    ws_.text(true);
+    if (close_reason_) {
+        return SendClose();
+    }
+    // Кадры, пришедшие до конца рукопожатия, ждали в очереди
+    if (frames_.Current()) {
+        Write();
+    }
+    Read();
+}
+
+void StreamSession::Read() {
+    ws_.async_read(buffer_, beast::bind_front_handler(&StreamSession::OnRead, shared_from_this()));
+}
+
+void StreamSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (ec) {
+        return Finish(ec);
+    }
+    if (on_message_) {
+        const auto data = buffer_.cdata();
+        on_message_({static_cast<const char*>(data.data()), data.size()});
+    }
+    buffer_.consume(buffer_.size());
+    Read();
+}
+
+void StreamSession::Write() {
+    ws_.async_write(net::buffer(*frames_.Current()), beast::bind_front_handler(&StreamSession::OnWrite, shared_from_this()));
+}
+
+void StreamSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    if (ec) {
+        return Finish(ec);
+    }
+    if (close_reason_ && open_) {
+        return SendClose();
+    }
+    if (frames_.Finish() && open_) {
+        Write();
+    }
+}
+
+void StreamSession::Close(std::string reason) {
+    net::post(ws_.get_executor(), [self = shared_from_this(), reason = std::move(reason)]() mutable {
+        if (self->close_reason_) {
+            return;
+        }
+        self->close_reason_ = std::move(reason);
+        // Начатую запись нельзя прервать: соединение закроется после неё в OnWrite
+        if (self->open_ && !self->frames_.Current()) {
+            self->SendClose();
+        }
+    });
+}
+
+void StreamSession::SendClose() {
+    open_ = false;
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data,
+                    json::value{
+                        {"droppedFrames", frames_.Dropped()},
+                        {"reason", *close_reason_}
+                    })
+                    << "stream closed"sv;
+    ws_.async_close({websocket::close_code::normal, *close_reason_},
+                    [self = shared_from_this()](beast::error_code ec) {
+                        if (ec) {
+                            ReportError(ec, "close stream"sv);
+                        }
+                    });
+}
+
+void StreamSession::Finish(beast::error_code ec) {
+    if (!open_) {
+        return;
+    }
+    open_ = false;
+    if (ec != websocket::error::closed) {
+        ReportError(ec, "stream"sv);
+    }
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data,
+                    json::value{
+                        {"droppedFrames", frames_.Dropped()}
+                    })
+                    << "stream closed"sv;
+}
+
 }  // namespace http_server
@@ -5,8 +5,17 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 
+#include <atomic>
+#include <functional>
+#include <optional>
+
+#include "access_log.h"
 #include "logger.h"
+#include "request_arena.h"
+#include "sendfile_body.h"
+#include "stream_hub.h"
 
 namespace http_server {
     
@@ -15,10 +24,38 @@ using tcp = net::ip::tcp;
 namespace beast = boost::beast;
 namespace sys = boost::system;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 using namespace std::literals;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// Заголовки и тело запроса живут в арене соединения, см. request_arena.h
+using RequestAllocator = request_arena::Allocator<char>;
+using RequestBody = http::basic_string_body<char, std::char_traits<char>, RequestAllocator>;
+using Request = http::request<RequestBody, http::basic_fields<RequestAllocator>>;
+
+// Число открытых соединений для /metrics: член каждого соединения, HTTP и WebSocket
+class ConnectionCount {
+public:
+    ConnectionCount() noexcept {
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~ConnectionCount() {
+        count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    ConnectionCount(const ConnectionCount&) = delete;
+    ConnectionCount& operator=(const ConnectionCount&) = delete;
+
+    static std::int64_t Get() noexcept {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    inline static std::atomic<std::int64_t> count_{0};
+};
+
 class SessionBase {
 public:
     SessionBase(const SessionBase&) = delete;
@@ -26,7 +63,7 @@ public:
 
     void Run();
 protected:
-    using HttpRequest = http::request<http::string_body>;
+    using HttpRequest = Request;
 
     explicit SessionBase(tcp::socket&& socket)
         : stream_(std::move(socket)) {
@@ -43,9 +80,16 @@ protected:
                               self->OnWrite(safe_response->need_eof(), ec, bytes_written);
                           });
     }
+
+    using SendfileResponse = http::response<sendfile_body::SendfileBody>;
+
+    // Заголовок пишет Beast, а файл уходит в сокет через sendfile
+    void Write(SendfileResponse&& response);
 private:
     void Read();
 
+    void SendFile(std::shared_ptr<SendfileResponse> response, std::uint64_t offset);
+
     void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
 
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
@@ -60,16 +104,87 @@ protected:
     beast::tcp_stream stream_;
 private:
     beast::flat_buffer buffer_;
+    std::shared_ptr<request_arena::Arena> arena_;
     HttpRequest request_;
+    ConnectionCount connection_count_;
 };
 
-template <typename RequestHandler>
-class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+/*
+ *  WebSocket-соединение, в которое сервер сам отправляет кадры: оно подписывается
+ *  на stream_hub::Hub. Медленному клиенту уходит только последний кадр, промежуточные
+ *  отбрасываются. Сообщения клиента передаются обработчику в strand соединения.
+ *  Когда хаб отписывает соединение, оно дописывает начатый кадр и закрывается с причиной.
+ */
+class StreamSession : public stream_hub::Subscriber, public std::enable_shared_from_this<StreamSession> {
 public:
-    template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
+    using HttpRequest = Request;
+    using MessageHandler = std::function<void(std::string_view message)>;
+
+    StreamSession(beast::tcp_stream&& stream, MessageHandler on_message = {})
+        : ws_(std::move(stream))
+        , on_message_(std::move(on_message)) {
+    }
+
+    // Завершает рукопожатие по запросу на upgrade и начинает читать сообщения
+    void Run(HttpRequest&& request);
+
+    // Отвечает обычным HTTP-ответом вместо рукопожатия и закрывает соединение
+    template <typename Body, typename Fields>
+    void Reject(http::response<Body, Fields>&& response) {
+        auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
+        safe_response->keep_alive(false);
+        http::async_write(ws_.next_layer(), *safe_response,
+                          [safe_response, self = shared_from_this()](beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+                              if (ec) {
+                                  return ReportError(ec, "write"sv);
+                              }
+                              self->ws_.next_layer().socket().shutdown(tcp::socket::shutdown_send, ec);
+                          });
+    }
+
+    // Можно вызывать из любого потока
+    void Push(stream_hub::Frame frame) override;
+
+    // Можно вызывать из любого потока
+    void Close(std::string reason) override;
+
+private:
+    void OnAccept(beast::error_code ec);
+
+    void Read();
+
+    void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
+
+    void Write();
+
+    void OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+
+    void SendClose();
+
+    void Finish(beast::error_code ec);
+
+    // Сообщения клиента - короткие команды, длиннее не нужно
+    constexpr static std::size_t MAX_STREAM_MESSAGE_SIZE = 4096;
+
+    websocket::stream<beast::tcp_stream> ws_;
+    HttpRequest request_;
+    beast::flat_buffer buffer_;
+    ConnectionCount connection_count_;
+    stream_hub::FrameSlot frames_;
+    MessageHandler on_message_;
+    bool open_ = false;
+    std::optional<std::string> close_reason_;
+};
+
+template <typename RequestHandler, typename UpgradeHandler>
+class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler, UpgradeHandler>> {
+public:
+    template <typename Handler, typename Upgrade>
+    Session(tcp::socket&& socket, access_log::Logger& access_log, Handler&& request_handler, Upgrade&& upgrade_handler)
         : SessionBase(std::move(socket))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , access_log_{access_log}
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::forward<Upgrade>(upgrade_handler)) {
 
     }
 private:
@@ -78,43 +193,69 @@ private:
     } 
 
     void HandleRequest(HttpRequest&& request) override {
-        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, 
-                                json::value{
-                                    {"ip", stream_.socket().remote_endpoint().address().to_string()},
-                                    {"URI", request.target()},
-                                    {"method", request.method_string()}
-                                })
-                                << "request received"sv;
-        std::chrono::system_clock::time_point start_ts = std::chrono::system_clock::now();
-        request_handler_(std::move(request), [start_ts, self = this->shared_from_this()](auto&& response) {
-            std::chrono::system_clock::time_point end_ts = std::chrono::system_clock::now();
-            int code = response.result_int();
-            std::string_view content_type = response.at(http::field::content_type);
-            self->Write(std::move(response));
-            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, 
+        if (websocket::is_upgrade(request)) {
+            // В строке запроса WebSocket может быть токен, поэтому она не попадает в лог
+            const std::string_view target{request.target().data(), request.target().size()};
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data,
                                     json::value{
-                                        {"ip", self->stream_.socket().remote_endpoint().address().to_string()},
-                                        {"response_time", std::chrono::duration_cast<std::chrono::milliseconds>(end_ts - start_ts).count()},
-                                        {"code", code},
-                                        {"content_type", content_type}
+                                        {"ip", RemoteAddress().to_string()},
+                                        {"URI", target.substr(0, target.find('?'))}
                                     })
-                                    << "response sent"sv;
+                                    << "stream requested"sv;
+            // Соединение целиком переходит обработчику WebSocket, HTTP-сессия на этом заканчивается
+            stream_.expires_never();
+            return upgrade_handler_(std::move(stream_), std::move(request));
+        }
+        // Журнал только копирует поля в кольцо потока, JSON собирает поток журнала
+        const bool sampled = access_log_.Sample();
+        if (sampled) {
+            access_log_.LogRequest(RemoteAddress(), {request.target().data(), request.target().size()},
+                                   {request.method_string().data(), request.method_string().size()});
+        }
+        const auto start_ts = std::chrono::steady_clock::now();
+        request_handler_(std::move(request), [start_ts, sampled, self = this->shared_from_this()](auto&& response) {
+            const auto response_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_ts);
+            // Ошибки сервера попадают в журнал и вне выборки
+            if (sampled || response.result_int() >= 500) {
+                const auto content_type = response[http::field::content_type];
+                self->access_log_.LogResponse(self->RemoteAddress(), response_time, response.result_int(),
+                                              {content_type.data(), content_type.size()});
+            }
+            // Ответ может прийти из api_strand или из пула базы в чужом потоке,
+            // а пишется он всегда в потоке соединения
+            net::dispatch(self->stream_.get_executor(), [self, response = std::forward<decltype(response)>(response)]() mutable {
+                self->Write(std::move(response));
+            });
         });
     }
 
+    net::ip::address RemoteAddress() const {
+        sys::error_code ec;
+        return stream_.socket().remote_endpoint(ec).address();
+    }
+
+    access_log::Logger& access_log_;
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
-template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler>
+class Listener : public std::enable_shared_from_this<Listener<RequestHandler, UpgradeHandler>> {
 public:
-    template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    // reuse_port позволяет нескольким Listener слушать один порт, соединения между ними распределяет ядро
+    template <typename Handler, typename Upgrade>
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, access_log::Logger& access_log, Handler&& request_handler, Upgrade&& upgrade_handler,
+             bool reuse_port = false)
         : ioc_{ioc}
         , acceptor_(net::make_strand(ioc))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , access_log_{access_log}
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::forward<Upgrade>(upgrade_handler)) {
         acceptor_.open(endpoint.protocol());
         acceptor_.set_option(net::socket_base::reuse_address(true));
+        if (reuse_port) {
+            acceptor_.set_option(ReusePort(true));
+        }
         acceptor_.bind(endpoint);
         acceptor_.listen(net::socket_base::max_listen_connections);
     }
@@ -123,6 +264,8 @@ public:
         DoAccept();
     }
 private:
+    using ReusePort = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
     void DoAccept() {
         acceptor_.async_accept(
             net::make_strand(ioc_),
@@ -139,18 +282,24 @@ private:
     }
 
     void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+        std::make_shared<Session<RequestHandler, UpgradeHandler>>(std::move(socket), access_log_, request_handler_, upgrade_handler_)->Run();
     }
 
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
+    access_log::Logger& access_log_;
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
-template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
-    using MyListener = Listener<std::decay_t<RequestHandler>>;
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+// upgrade_handler получает соединение и запрос, когда клиент просит перейти на WebSocket.
+// Запросы и ответы пишутся в access_log. С reuse_port порт можно слушать из нескольких io_context
+template <typename RequestHandler, typename UpgradeHandler>
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, access_log::Logger& access_log, RequestHandler&& handler, UpgradeHandler&& upgrade_handler,
+               bool reuse_port = false) {
+    using MyListener = Listener<std::decay_t<RequestHandler>, std::decay_t<UpgradeHandler>>;
+    std::make_shared<MyListener>(ioc, endpoint, access_log, std::forward<RequestHandler>(handler), std::forward<UpgradeHandler>(upgrade_handler),
+                                 reuse_port)->Run();
 }
 
 }  // namespace http_server
@@ -1,4 +1,5 @@
 #include "json_encoder.h"
+#include "json_writer.h"
 
 namespace json_encoder {
 
@@ -80,61 +81,175 @@ json::array OfficesToJson(const model::Map::Offices& offices) {
     return json_offices;
 }
 
+namespace {
+
+// Готовые фрагменты ключей для JsonWriter
+constexpr std::string_view AUTH_TOKEN_KEY = R"("authToken":)";
+constexpr std::string_view PLAYER_ID_KEY = R"("playerId":)";
+constexpr std::string_view NAME_KEY = R"("name":)";
+constexpr std::string_view PLAYERS_KEY = R"("players":)";
+constexpr std::string_view LOST_OBJECTS_KEY = R"("lostObjects":)";
+constexpr std::string_view POS_KEY = R"("pos":)";
+constexpr std::string_view SPEED_KEY = R"("speed":)";
+constexpr std::string_view DIR_KEY = R"("dir":)";
+constexpr std::string_view BAG_KEY = R"("bag":)";
+constexpr std::string_view SCORE_KEY = R"("score":)";
+constexpr std::string_view ID_KEY = R"("id":)";
+constexpr std::string_view TYPE_KEY = R"("type":)";
+constexpr std::string_view PLAY_TIME_KEY = R"("playTime":)";
+constexpr std::string_view RANK_KEY = R"("rank":)";
+constexpr std::string_view TICK_KEY = R"("tick":)";
+constexpr std::string_view FULL_KEY = R"("full":)";
+constexpr std::string_view REMOVED_PLAYERS_KEY = R"("removedPlayers":)";
+constexpr std::string_view REMOVED_LOST_OBJECTS_KEY = R"("removedLostObjects":)";
+
+// Примерный размер JSON одной собаки и одного трофея, чтобы буфер не перевыделялся
+constexpr size_t DOG_JSON_SIZE = 128;
+constexpr size_t LOOT_JSON_SIZE = 48;
+constexpr size_t RECORD_JSON_SIZE = 64;
+constexpr size_t REMOVED_ID_JSON_SIZE = 8;
+constexpr size_t DELTA_HEADER_JSON_SIZE = 128;
+constexpr double MILLISECONDS_IN_SECOND = 1000.0;
+
+void WritePair(json_writer::JsonWriter& writer, double first, double second) {
+    writer.BeginArray().Double(first).Double(second).EndArray();
+}
+
+void WriteDog(json_writer::JsonWriter& writer, const model::SessionSnapshot::DogState& dog) {
+    writer.Key(*dog.id).BeginObject().KeyFragment(POS_KEY);
+    WritePair(writer, dog.x, dog.y);
+    writer.KeyFragment(SPEED_KEY);
+    WritePair(writer, dog.dx, dog.dy);
+    writer.KeyFragment(DIR_KEY).String(dog.dir).KeyFragment(BAG_KEY).BeginArray();
+    for (const auto& [id, type] : dog.bag) {
+        writer.BeginObject().KeyFragment(ID_KEY).Int(id).KeyFragment(TYPE_KEY).Int(type).EndObject();
+    }
+    writer.EndArray().KeyFragment(SCORE_KEY).Int(dog.score).EndObject();
+}
+
+void WriteLoot(json_writer::JsonWriter& writer, const model::SessionSnapshot::LootState& item) {
+    writer.Key(static_cast<std::uint64_t>(item.id)).BeginObject().KeyFragment(TYPE_KEY).Int(item.type).KeyFragment(POS_KEY);
+    WritePair(writer, item.x, item.y);
+    writer.EndObject();
+}
+
+void WriteRecordFields(json_writer::JsonWriter& writer, const leaderboard::Record& record) {
+    writer.KeyFragment(NAME_KEY).String(record.name)
+        .KeyFragment(SCORE_KEY).Int(record.score)
+        .KeyFragment(PLAY_TIME_KEY).Double(record.play_time_ms / MILLISECONDS_IN_SECOND);
+}
+
+}  // namespace
+
 std::string PlayerToString(const model::Player& player) {
-    json::value json_player {
-        {"authToken", *player.GetToken()},
-        {"playerId", *player.GetDog()->GetId()}
-    };
-    std::ostringstream res;
-    res << json_player;
-    return res.str();
+    json_writer::JsonWriter writer;
+    writer.BeginObject()
+        .KeyFragment(AUTH_TOKEN_KEY).String(*player.GetToken())
+        .KeyFragment(PLAYER_ID_KEY).Int(*player.GetDog()->GetId())
+        .EndObject();
+    return writer.Release();
 }
 
-std::string GameSessionToString(const model::GameSession& game_session) {
-    json::object json_game_session;
-    for (const auto& [id, dog] : game_session.GetDogs()) {
-        json_game_session[std::to_string(*id)] = json::object({{"name", dog->GetName()}});
+std::string GameSessionToString(const model::SessionSnapshot& snapshot) {
+    json_writer::JsonWriter writer{snapshot.dogs.size() * DOG_JSON_SIZE / 4};
+    writer.BeginObject();
+    for (const auto& dog : snapshot.dogs) {
+        writer.Key(*dog.id).BeginObject().KeyFragment(NAME_KEY).String(dog.name).EndObject();
     }
-    std::ostringstream res;
-    res << json_game_session;
-    return res.str();
+    writer.EndObject();
+    return writer.Release();
 }
 
-std::string GameStateToString(const model::GameSession& game_session) {
-    json::object json_players;
-    for (const auto& [id, dog] : game_session.GetDogs()) {
-        json_players[std::to_string(*id)] = json::object({
-            {"pos", json::array({dog->x, dog->y})},
-            {"speed", json::array({dog->dx, dog->dy})},
-            {"dir", dog->dir},
-            {"bag", BagToJson(dog->bag_)},
-            {"score", dog->score}
-        });
+std::string GameStateToString(const model::SessionSnapshot& snapshot) {
+    json_writer::JsonWriter writer{snapshot.dogs.size() * DOG_JSON_SIZE + snapshot.lost_objects.size() * LOOT_JSON_SIZE};
+    writer.BeginObject().KeyFragment(PLAYERS_KEY).BeginObject();
+    for (const auto& dog : snapshot.dogs) {
+        WriteDog(writer, dog);
     }
-    json::object json_lost_objects;
-    for (const auto& [id, item] : game_session.GetLostObjects()) {
-        json_lost_objects[std::to_string(id)] = json::object({
-            {"type", item.type},
-            {"pos", json::array({item.x, item.y})}
-        });
+    writer.EndObject().KeyFragment(LOST_OBJECTS_KEY).BeginObject();
+    for (const auto& item : snapshot.lost_objects) {
+        WriteLoot(writer, item);
     }
-    std::ostringstream res;
-    res << json::object({
-        {"players", json_players},
-        {"lostObjects", json_lost_objects}
-    });
-    return res.str();
+    writer.EndObject().EndObject();
+    return writer.Release();
 }
 
-json::array BagToJson(const std::vector<std::pair<int, int>>& bag) {
-    json::array json_bag;
-    for (const auto& item : bag) {
-        json_bag.push_back({
-            {"id", item.first},
-            {"type", item.second}
-        });
+std::string GameStateDeltaToString(const model::SessionSnapshot& snapshot, const model::SessionSnapshot::Delta& delta) {
+    json_writer::JsonWriter writer{delta.dogs.size() * DOG_JSON_SIZE + delta.spawned_loot.size() * LOOT_JSON_SIZE
+        + (delta.removed_dogs.size() + delta.removed_loot.size()) * REMOVED_ID_JSON_SIZE + DELTA_HEADER_JSON_SIZE};
+    writer.BeginObject()
+        .KeyFragment(TICK_KEY).String(snapshot.GetSince().ToString())
+        .KeyFragment(FULL_KEY).Bool(delta.full)
+        .KeyFragment(PLAYERS_KEY).BeginObject();
+    for (const auto* dog : delta.dogs) {
+        WriteDog(writer, *dog);
+    }
+    writer.EndObject().KeyFragment(REMOVED_PLAYERS_KEY).BeginArray();
+    for (const auto& id : delta.removed_dogs) {
+        writer.Int(*id);
+    }
+    writer.EndArray().KeyFragment(LOST_OBJECTS_KEY).BeginObject();
+    for (const auto* item : delta.spawned_loot) {
+        WriteLoot(writer, *item);
+    }
+    writer.EndObject().KeyFragment(REMOVED_LOST_OBJECTS_KEY).BeginArray();
+    for (int id : delta.removed_loot) {
+        writer.Int(id);
+    }
+    writer.EndArray().EndObject();
+    return writer.Release();
+}
+
+std::string RecordsToString(const std::vector<leaderboard::Record>& records) {
+    json_writer::JsonWriter writer{records.size() * RECORD_JSON_SIZE + 2};
+    writer.BeginArray();
+    for (const auto& record : records) {
+        writer.BeginObject();
+        WriteRecordFields(writer, record);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    return writer.Release();
+}
+
+std::string RankToString(const leaderboard::Leaderboard::Rank& rank) {
+    json_writer::JsonWriter writer{RECORD_JSON_SIZE};
+    writer.BeginObject();
+    WriteRecordFields(writer, rank.record);
+    writer.KeyFragment(RANK_KEY).Int(rank.place).EndObject();
+    return writer.Release();
+}
+
+std::optional<std::string_view> TryParseMove(std::string_view body) {
+    using namespace std::literals;
+    const auto skip_spaces = [&body] {
+        while (!body.empty() && (body.front() == ' ' || body.front() == '\t' || body.front() == '\n' || body.front() == '\r')) {
+            body.remove_prefix(1);
+        }
+    };
+    const auto consume = [&body, &skip_spaces](std::string_view token) {
+        skip_spaces();
+        if (!body.starts_with(token)) {
+            return false;
+        }
+        body.remove_prefix(token.size());
+        return true;
+    };
+    if (!consume("{"sv) || !consume(R"("move")"sv) || !consume(":"sv) || !consume("\""sv)) {
+        return std::nullopt;
+    }
+    // Направление - одна буква или пустая строка, экранирование здесь не встречается
+    const size_t size = body.find('"');
+    if (size > 1 || body.substr(0, size).find('\\') != std::string_view::npos) {
+        return std::nullopt;
+    }
+    const std::string_view move = body.substr(0, size);
+    body.remove_prefix(size + 1);
+    if (!consume("}"sv)) {
+        return std::nullopt;
     }
-    return json_bag;
+    skip_spaces();
+    return body.empty() ? std::optional{move} : std::nullopt;
 }
 
 }  // namespace json_encoder
@@ -2,7 +2,11 @@
 
 #include <boost/json.hpp>
 
+#include <optional>
+#include <string_view>
+
 #include "model.h"
+#include "leaderboard.h"
 
 namespace json_encoder {
 
@@ -20,10 +24,19 @@ json::array OfficesToJson(const model::Map::Offices& offices);
 
 std::string PlayerToString(const model::Player& player);
 
-std::string GameSessionToString(const model::GameSession& game_session);
+std::string GameSessionToString(const model::SessionSnapshot& snapshot);
+
+std::string GameStateToString(const model::SessionSnapshot& snapshot);
+
+// Изменения состояния после тика since; since и тик ответа - токены "<сессия>.<версия>" снимков
+std::string GameStateDeltaToString(const model::SessionSnapshot& snapshot, const model::SessionSnapshot::Delta& delta);
+
+std::string RecordsToString(const std::vector<leaderboard::Record>& records);
 
-std::string GameStateToString(const model::GameSession& game_session);
+std::string RankToString(const leaderboard::Leaderboard::Rank& rank);
 
-json::array BagToJson(const std::vector<std::pair<int, int>>& bag);
+// Тело действия ровно вида {"move": "L"} без дерева JSON. nullopt - тело другой формы,
+// его нужно разобрать полным парсером. Направление не проверяется
+std::optional<std::string_view> TryParseMove(std::string_view body);
 
 }  // namespace json_encoder
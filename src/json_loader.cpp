@@ -66,6 +66,7 @@ model::Map MapFromJson(const json::value& json_map) {
     for (const json::value& json_road : json_map.at("roads").as_array()) {
         map.AddRoad(RoadFromJson(json_road));
     }
+    map.BuildRoadIndex();
 
     for (const json::value& json_building : json_map.at("buildings").as_array()) {
         map.AddBuilding(BuildingFromJson(json_building));
@@ -0,0 +1,113 @@
+#include "json_writer.h"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+
+namespace json_writer {
+
+namespace {
+
+using namespace std::literals;
+
+template <typename T>
+void AppendNumber(std::string& buffer, T value) {
+    std::array<char, 32> chars;
+    const auto result = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+    buffer.append(chars.data(), result.ptr);
+}
+
+void AppendEscaped(std::string& buffer, std::string_view value) {
+    constexpr std::string_view HEX = "0123456789abcdef";
+    buffer.push_back('"');
+    size_t plain_start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        const auto c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        buffer.append(value.substr(plain_start, i - plain_start));
+        plain_start = i + 1;
+        switch (c) {
+            case '"':
+                buffer.append("\\\""sv);
+                break;
+            case '\\':
+                buffer.append("\\\\"sv);
+                break;
+            case '\n':
+                buffer.append("\\n"sv);
+                break;
+            case '\r':
+                buffer.append("\\r"sv);
+                break;
+            case '\t':
+                buffer.append("\\t"sv);
+                break;
+            default:
+                buffer.append("\\u00"sv);
+                buffer.push_back(HEX[c >> 4]);
+                buffer.push_back(HEX[c & 0xF]);
+        }
+    }
+    buffer.append(value.substr(plain_start));
+    buffer.push_back('"');
+}
+
+}  // namespace
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    Separate();
+    AppendEscaped(buffer_, key);
+    buffer_.push_back(':');
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::uint64_t key) {
+    Separate();
+    buffer_.push_back('"');
+    AppendNumber(buffer_, key);
+    buffer_.append("\":"sv);
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value) {
+    Separate();
+    AppendEscaped(buffer_, value);
+    return *this;
+}
+
+// Кратчайшая запись, которая читается обратно в то же число; NaN и бесконечности в JSON не бывает
+JsonWriter& JsonWriter::Double(double value) {
+    Separate();
+    if (!std::isfinite(value)) {
+        buffer_.append("null"sv);
+    } else {
+        AppendNumber(buffer_, value);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value) {
+    Separate();
+    buffer_.append(value ? "true"sv : "false"sv);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+    Separate();
+    buffer_.append("null"sv);
+    return *this;
+}
+
+void JsonWriter::AppendInteger(std::int64_t value) {
+    AppendNumber(buffer_, value);
+}
+
+void JsonWriter::AppendInteger(std::uint64_t value) {
+    AppendNumber(buffer_, value);
+}
+
+}  // namespace json_writer
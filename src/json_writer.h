@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace json_writer {
+
+/*
+ *  Пишет JSON прямо в растущий буфер, без промежуточного дерева значений.
+ *  Запятые между элементами расставляет сам. Ключи, известные заранее, передаются
+ *  готовыми фрагментами вида "\"name\":", числа печатаются через std::to_chars.
+ *  Готовую строку забирает Release, после чего буфер можно наполнять заново.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(size_t reserve = 0) {
+        buffer_.reserve(reserve);
+    }
+
+    JsonWriter& BeginObject() {
+        return Open('{');
+    }
+
+    JsonWriter& EndObject() {
+        return Close('}');
+    }
+
+    JsonWriter& BeginArray() {
+        return Open('[');
+    }
+
+    JsonWriter& EndArray() {
+        return Close(']');
+    }
+
+    // fragment - ключ в кавычках с двоеточием, например R"("pos":)"
+    JsonWriter& KeyFragment(std::string_view fragment) {
+        Separate();
+        buffer_.append(fragment);
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter& Key(std::string_view key);
+    JsonWriter& Key(std::uint64_t key);
+
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Double(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& Null();
+
+    template <typename T>
+        requires std::is_integral_v<T> && (!std::is_same_v<T, bool>)
+    JsonWriter& Int(T value) {
+        Separate();
+        AppendInteger(value);
+        return *this;
+    }
+
+    // Уже готовый JSON
+    JsonWriter& Raw(std::string_view json) {
+        Separate();
+        buffer_.append(json);
+        return *this;
+    }
+
+    const std::string& View() const noexcept {
+        return buffer_;
+    }
+
+    std::string Release() {
+        std::string result = std::move(buffer_);
+        buffer_.clear();
+        need_comma_ = false;
+        after_key_ = false;
+        return result;
+    }
+
+private:
+    JsonWriter& Open(char bracket) {
+        Separate();
+        buffer_.push_back(bracket);
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& Close(char bracket) {
+        buffer_.push_back(bracket);
+        need_comma_ = true;
+        return *this;
+    }
+
+    // Запятая нужна перед любым значением или ключом, кроме первого и кроме значения после ключа
+    void Separate() {
+        if (after_key_) {
+            after_key_ = false;
+        } else if (need_comma_) {
+            buffer_.push_back(',');
+        }
+        need_comma_ = true;
+    }
+
+    void AppendInteger(std::int64_t value);
+    void AppendInteger(std::uint64_t value);
+
+    template <typename T>
+    void AppendInteger(T value) {
+        if constexpr (std::is_signed_v<T>) {
+            AppendInteger(static_cast<std::int64_t>(value));
+        } else {
+            AppendInteger(static_cast<std::uint64_t>(value));
+        }
+    }
+
+    std::string buffer_;
+    bool need_comma_ = false;
+    bool after_key_ = false;
+};
+
+}  // namespace json_writer
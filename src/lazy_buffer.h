@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace lazy_buffer {
+
+/*
+ *  Строка, которая вычисляется при первом обращении и дальше раздаётся всем читателям.
+ *  Одновременные первые обращения ждут одного вычисления; если фабрика бросила
+ *  исключение, следующее обращение попробует снова.
+ */
+class LazyBuffer {
+public:
+    using Buffer = std::shared_ptr<const std::string>;
+
+    template <typename Factory>
+    Buffer Get(Factory&& factory) const {
+        std::call_once(once_, [this, &factory] {
+            buffer_ = std::make_shared<const std::string>(factory());
+        });
+        return buffer_;
+    }
+
+private:
+    mutable std::once_flag once_;
+    mutable Buffer buffer_;
+};
+
+}  // namespace lazy_buffer
@@ -0,0 +1,76 @@
+#include "leaderboard.h"
+
+#include <mutex>
+#include <tuple>
+
+namespace leaderboard {
+
+bool Leaderboard::KeyLess::operator()(const Key& l, const Key& r) const {
+    return std::tie(r.score, l.play_time_ms, l.name, l.seq) < std::tie(l.score, r.play_time_ms, r.name, r.seq);
+}
+
+void Leaderboard::Add(Record record) {
+    std::unique_lock lock{mutex_};
+    AddLocked(std::move(record));
+    ++version_;
+}
+
+void Leaderboard::Load(std::vector<Record> records) {
+    std::unique_lock lock{mutex_};
+    for (auto& record : records) {
+        AddLocked(std::move(record));
+    }
+    loaded_ = true;
+    ++version_;
+}
+
+bool Leaderboard::IsLoaded() const {
+    std::shared_lock lock{mutex_};
+    return loaded_;
+}
+
+size_t Leaderboard::Size() const {
+    std::shared_lock lock{mutex_};
+    return tree_.size();
+}
+
+Leaderboard::Page Leaderboard::GetPage(size_t start, size_t max_items) const {
+    std::shared_lock lock{mutex_};
+    Page page{{}, version_};
+    if (start >= tree_.size()) {
+        return page;
+    }
+    page.records.reserve(std::min(max_items, tree_.size() - start));
+    for (auto it = tree_.find_by_order(start); it != tree_.end() && page.records.size() < max_items; ++it) {
+        page.records.push_back(ToRecord(it->first, it->second));
+    }
+    return page;
+}
+
+std::optional<Leaderboard::Rank> Leaderboard::FindBestRank(std::string_view name) const {
+    std::shared_lock lock{mutex_};
+    auto it = best_by_name_.find(std::string{name});
+    if (it == best_by_name_.end()) {
+        return std::nullopt;
+    }
+    const Key& key = it->second;
+    return Rank{tree_.order_of_key(key) + 1, ToRecord(key, tree_.find(key)->second)};
+}
+
+Record Leaderboard::ToRecord(const Key& key, const std::string& id) {
+    return {id, key.name, key.score, key.play_time_ms};
+}
+
+void Leaderboard::AddLocked(Record&& record) {
+    if (!ids_.insert(record.id).second) {
+        return;
+    }
+    Key key{record.score, record.play_time_ms, std::move(record.name), next_seq_++};
+    auto [best, inserted] = best_by_name_.try_emplace(key.name, key);
+    if (!inserted && KeyLess{}(key, best->second)) {
+        best->second = key;
+    }
+    tree_.insert({std::move(key), std::move(record.id)});
+}
+
+}  // namespace leaderboard
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+namespace leaderboard {
+
+struct Record {
+    std::string id;
+    std::string name;
+    int score;
+    int play_time_ms;
+};
+
+/*
+ *  Таблица рекордов ушедших на пенсию игроков в памяти процесса.
+ *  Записи упорядочены так же, как индекс retired_players_idx: по убыванию очков,
+ *  затем по времени игры и имени. Дерево порядковой статистики позволяет получить
+ *  страницу за O(log n + k) и место записи за O(log n).
+ *  Методы потокобезопасны.
+ */
+class Leaderboard {
+public:
+    struct Page {
+        std::vector<Record> records;
+        // меняется при каждом изменении таблицы и различается между запусками процесса
+        std::uint64_t version;
+    };
+
+    struct Rank {
+        // место в таблице, начиная с 1
+        size_t place;
+        Record record;
+    };
+
+    // Запись с уже известным id пропускается
+    void Add(Record record);
+
+    // Добавляет записи, загруженные из базы, и помечает таблицу загруженной
+    void Load(std::vector<Record> records);
+
+    bool IsLoaded() const;
+    size_t Size() const;
+
+    Page GetPage(size_t start, size_t max_items) const;
+
+    // Лучшее место игрока с именем name
+    std::optional<Rank> FindBestRank(std::string_view name) const;
+
+private:
+    struct Key {
+        int score;
+        int play_time_ms;
+        std::string name;
+        // различает записи с одинаковыми очками, временем и именем
+        std::uint64_t seq;
+    };
+
+    struct KeyLess {
+        bool operator()(const Key& l, const Key& r) const;
+    };
+
+    using Tree = __gnu_pbds::tree<Key, std::string, KeyLess, __gnu_pbds::rb_tree_tag,
+                                  __gnu_pbds::tree_order_statistics_node_update>;
+
+    static Record ToRecord(const Key& key, const std::string& id);
+    void AddLocked(Record&& record);
+
+    mutable std::shared_mutex mutex_;
+    // ключ -> id записи
+    Tree tree_;
+    std::unordered_set<std::string> ids_;
+    // лучший ключ для каждого имени
+    std::unordered_map<std::string, Key> best_by_name_;
+    std::uint64_t next_seq_ = 0;
+    // Версии начинаются с момента запуска процесса: ETag, полученный клиентом
+    // от прошлого запуска сервера, не совпадёт с версией новой таблицы
+    std::uint64_t version_ = FIRST_VERSION;
+    inline static const std::uint64_t FIRST_VERSION = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    bool loaded_ = false;
+};
+
+}  // namespace leaderboard
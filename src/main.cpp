@@ -1,12 +1,20 @@
 #include "sdk.h"
 //
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/log/core/core.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/program_options.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <pqxx/pqxx>
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
 #include <iostream>
+#include <numeric>
 #include <thread>
 #include <string_view>
 #include <fstream>
@@ -19,12 +27,16 @@
 #include "logger.h"
 #include "ticker.h"
 #include "loot_generator.h"
+#include "retirement_sink.h"
+#include "postgres.h"
+#include "leaderboard.h"
+#include "access_log.h"
+#include "metrics.h"
+#include "tick_profiler.h"
 
 using namespace std::literals;
 namespace net = boost::asio;
 namespace sys = boost::system;
-using InputArchive = boost::archive::text_iarchive;
-using OutputArchive = boost::archive::text_oarchive;
 
 namespace {
 
@@ -41,6 +53,42 @@ void RunThreads(unsigned num_threads, const Fn& fn) {
     fn();
 }
 
+// Ядра, на которых процессу разрешено работать (taskset, cgroup cpuset).
+// Их номера не обязаны идти подряд с нуля
+std::vector<unsigned> GetAvailableCpus() {
+    std::vector<unsigned> result;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpus)) {
+                result.push_back(cpu);
+            }
+        }
+    }
+    if (result.empty()) {
+        result.resize(std::max(1u, std::thread::hardware_concurrency()));
+        std::iota(result.begin(), result.end(), 0u);
+    }
+    return result;
+}
+
+// Закрепляет текущий поток за ядром cpu. Если не вышло, поток работает незакреплённым
+void PinThreadToCpu(unsigned cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); error != 0) {
+        BOOST_LOG_TRIVIAL(error) << logging::add_value(additional_data,
+                            json::value{
+                                {"cpu", cpu},
+                                {"code", error},
+                                {"text", std::strerror(error)}
+                            })
+                            << "failed to pin thread"sv;
+    }
+}
+
 void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& strm) {
     strm << json::value{
         {"timestamp", to_iso_extended_string(*rec[timestamp])},
@@ -49,6 +97,22 @@ void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& s
     };;
 }
 
+// Сообщения Boost.Log форматируются в вызывающем потоке, а выводит их поток журнала
+// запросов: так строки обоих журналов не перемешиваются в stdout
+class AccessLogBackend : public logging::sinks::basic_formatted_sink_backend<char, logging::sinks::concurrent_feeding> {
+public:
+    explicit AccessLogBackend(access_log::Logger& access_log)
+        : access_log_{access_log} {
+    }
+
+    void consume(const logging::record_view&, const string_type& line) {
+        access_log_.WriteLine(line);
+    }
+
+private:
+    access_log::Logger& access_log_;
+};
+
 struct Args {
     int tick_period = 0;
     std::string config_file;
@@ -58,6 +122,14 @@ struct Args {
     bool randomize_spawn_points = false;
     bool contains_state_file = false;
     bool contains_save_state_period = false;
+    std::uint32_t log_sample_rate = 1;
+    bool thread_per_core = false;
+    unsigned game_threads = 1;
+    http_handler::OverloadOptions overload;
+    int shed_wait = 50;
+    std::string metrics_path = "/metrics"s;
+    bool tick_profile = false;
+    std::string retirement_spill_dir;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -73,7 +145,18 @@ struct Args {
         ("www-root,w", po::value(&args.www_root)->value_name("dir"s), "set static files root")
         ("randomize-spawn-points", "spawn dogs at random positions")
         ("state-file", po::value(&args.state_file)->value_name("file"s), "set state file")
-        ("save-state-period", po::value(&args.save_state_period)->value_name("milliseconds"s), "set save state period");
+        ("save-state-period", po::value(&args.save_state_period)->value_name("milliseconds"s), "set save state period")
+        ("log-sample-rate", po::value(&args.log_sample_rate)->value_name("n"s), "log every n-th request and response, 1 by default")
+        ("thread-per-core", "serve connections with one pinned io_context per core")
+        ("game-threads", po::value(&args.game_threads)->value_name("n"s), "run the game on n threads in thread-per-core mode, 1 by default")
+        ("shed-queue-depth", po::value(&args.overload.admission.shed_depth)->value_name("n"s), "reject state and records requests with 503 when n tasks wait for the game, 64 by default")
+        ("shed-wait", po::value(&args.shed_wait)->value_name("milliseconds"s), "reject state and records requests with 503 when game tasks wait longer, 50 by default")
+        ("max-queue-depth", po::value(&args.overload.admission.max_depth)->value_name("n"s), "reject joins with 503 when n tasks wait for the game, 1024 by default")
+        ("token-rate", po::value(&args.overload.rate_limit.rate)->value_name("rps"s), "limit requests per second for each player token, unlimited by default")
+        ("token-burst", po::value(&args.overload.rate_limit.burst)->value_name("n"s), "allow bursts of n requests over the token rate, 1 by default")
+        ("metrics-path", po::value(&args.metrics_path)->value_name("path"s), "serve Prometheus metrics at path, /metrics by default")
+        ("tick-profile", "time tick phases and serve them at /admin/tick-profile")
+        ("retirement-spill-dir", po::value(&args.retirement_spill_dir)->value_name("dir"s), "keep retired players on disk while the database is down, in memory by default");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -104,10 +187,23 @@ struct Args {
         args.contains_save_state_period = true;
     }
 
+    if (vm.contains("thread-per-core")) {
+        args.thread_per_core = true;
+    }
+
+    if (vm.contains("tick-profile")) {
+        args.tick_profile = true;
+    }
+
+    args.overload.admission.shed_wait = std::chrono::milliseconds{args.shed_wait};
+
     return args;
 }
 
 constexpr const char DB_URL_ENV_NAME[]{"GAME_DB_URL"};
+constexpr size_t DB_POOL_SIZE = 4;
+constexpr std::chrono::milliseconds LEADERBOARD_MIN_RETRY_DELAY{500};
+constexpr std::chrono::milliseconds LEADERBOARD_MAX_RETRY_DELAY{30000};
 
 std::string GetUrlFromEnv() {
     std::string db_url;
@@ -119,18 +215,103 @@ std::string GetUrlFromEnv() {
     return db_url;
 }
 
+// Пишет пачку ушедших на пенсию игроков одним INSERT через постоянное соединение.
+// Повтор пачки, чей commit дошёл до базы без подтверждения, не дублирует записи благодаря ON CONFLICT
+retirement_sink::RetirementSink::BatchWriter MakeRetiredPlayersWriter(const std::string& db_url, metrics::Registry& registry) {
+    auto conn = std::make_shared<std::optional<pqxx::connection>>();
+    return [db_url, conn, &registry](const std::vector<retirement_sink::RetiredPlayer>& batch) {
+        const auto started = metrics::Clock::now();
+        try {
+            if (!*conn) {
+                conn->emplace(db_url);
+            }
+            pqxx::work work{**conn};
+            std::string query = "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES "s;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                query += (i == 0 ? "("s : ", ("s) + work.quote(batch[i].id) + ", "s + work.quote(batch[i].name)
+                    + ", "s + std::to_string(batch[i].score) + ", "s + std::to_string(batch[i].play_time_ms) + ")"s;
+            }
+            query += " ON CONFLICT (id) DO NOTHING"s;
+            work.exec(query);
+            work.commit();
+            registry.db_write_duration.Record(metrics::Clock::now() - started);
+        } catch (const std::exception& ex) {
+            registry.db_write_errors.Add();
+            // Повторять имеет смысл только после потери соединения или подтверждения commit
+            const bool retryable = dynamic_cast<const pqxx::broken_connection*>(&ex)
+                || dynamic_cast<const pqxx::in_doubt_error*>(&ex);
+            if (retryable) {
+                conn->reset();
+            }
+            BOOST_LOG_TRIVIAL(error) << logging::add_value(additional_data,
+                            json::value{
+                                {"records", batch.size()},
+                                {"exception", ex.what()},
+                                {"retryable", retryable}
+                            })
+                            << "retired players write failed"sv;
+            if (retryable) {
+                throw retirement_sink::RetryableError{ex.what()};
+            }
+            throw;
+        }
+    };
+}
+
+// Загружает таблицу рекордов в память. Записи, добавленные до окончания загрузки,
+// не задваиваются: таблица пропускает уже известные ей id.
+// Пока база недоступна, запрос повторяется с нарастающей задержкой
+void LoadLeaderboard(net::io_context& ioc, postgres::ConnectionPool& db_pool, leaderboard::Leaderboard& records,
+                     std::chrono::milliseconds retry_delay = LEADERBOARD_MIN_RETRY_DELAY, int attempt = 1) {
+    db_pool.AsyncQuery("SELECT id, name, score, play_time_ms FROM retired_players;", {},
+        [&ioc, &db_pool, &records, retry_delay, attempt](std::exception_ptr error, postgres::Rows rows) {
+            try {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                std::vector<leaderboard::Record> loaded;
+                loaded.reserve(rows.size());
+                for (auto& row : rows) {
+                    loaded.push_back({std::move(row.at(0)), std::move(row.at(1)), std::stoi(row.at(2)), std::stoi(row.at(3))});
+                }
+                records.Load(std::move(loaded));
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data,
+                                json::value{
+                                    {"records", records.Size()},
+                                    {"attempt", attempt}
+                                })
+                                << "records loaded"sv;
+                return;
+            } catch (const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(error) << logging::add_value(additional_data,
+                                json::value{
+                                    {"exception", ex.what()},
+                                    {"attempt", attempt},
+                                    {"retryInMs", retry_delay.count()}
+                                })
+                                << "records load failed"sv;
+            }
+            auto timer = std::make_shared<net::steady_timer>(ioc, retry_delay);
+            timer->async_wait([timer, &ioc, &db_pool, &records, retry_delay, attempt](const sys::error_code& ec) {
+                if (ec) {
+                    return;
+                }
+                LoadLeaderboard(ioc, db_pool, records, std::min(retry_delay * 2, LEADERBOARD_MAX_RETRY_DELAY), attempt + 1);
+            });
+        });
+}
 
 }  // namespace
 
 int main(int argc, const char* argv[]) {
     logging::add_common_attributes();
-    logging::add_console_log( 
-        std::cout,
-        keywords::format = &MyFormatter,
-        keywords::auto_flush = true
-    ); 
+    access_log::Logger access_log{std::cout};
+    auto log_sink = boost::make_shared<logging::sinks::synchronous_sink<AccessLogBackend>>(boost::make_shared<AccessLogBackend>(access_log));
+    log_sink->set_formatter(&MyFormatter);
+    logging::core::get()->add_sink(log_sink);
     try {
         if (auto args = ParseCommandLine(argc, argv)) {
+            access_log.SetSampleRate(args->log_sample_rate);
 
             // 1. Загружаем карту из файла и построить модель игры
             model::Game game = json_loader::LoadGame(args->config_file);
@@ -150,42 +331,38 @@ int main(int argc, const char* argv[]) {
             }
 
             if (args->contains_state_file) {
-                std::ifstream in(args->state_file);
-                if (in.good()) {
-                    InputArchive input_archive{in};
-                    model::Players players;
-                    input_archive >> players;
-                    input_archive >> game;
-
-                    for (auto& [map_id, game_sessions] : game.game_sessions_on_map_) {
-                        for (auto& game_session : game_sessions) {
-                            game_session->map_ = game.FindMap(map_id);
-                            for (auto& [dog_id, dog] : game_session->dogs_) {
-                                std::shared_ptr<model::Player> player = players.FindByDogIdAndMapId(dog_id, map_id);
-                                player->GetSession() = game_session;
-                                dog = player->GetDog();
-                            }
-                        }
-                    }
-                }
+                model::LoadState(game, args->state_file);
             }
 
             game.db_url = GetUrlFromEnv();
 
             // 2. Инициализируем io_context
-            const unsigned num_threads = std::thread::hardware_concurrency();
+            // В режиме --thread-per-core ядра заняты соединениями, игре остаётся game_threads потоков
+            const auto cpus = GetAvailableCpus();
+            const unsigned num_threads = args->thread_per_core ? std::max(1u, args->game_threads)
+                                                               : static_cast<unsigned>(cpus.size());
             net::io_context ioc(num_threads);
 
             // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
+            // В режиме --thread-per-core соединения обслуживают свои io_context, по одному на ядро
+            std::vector<std::unique_ptr<net::io_context>> connection_contexts;
             net::signal_set signals(ioc, SIGINT, SIGTERM);
-            signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+            signals.async_wait([&ioc, &connection_contexts](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
                 if (!ec) {
                     ioc.stop();
+                    for (auto& context : connection_contexts) {
+                        context->stop();
+                    }
                 }
             });
 
             auto api_strand = net::make_strand(ioc);
 
+            // Сессии тикают на свободных потоках io_context, пока api_strand ждёт их завершения
+            game.SetTaskPoster([&ioc](std::function<void()> task) {
+                net::post(ioc, std::move(task));
+            }, num_threads - 1);
+
             loot_gen::LootGenerator loot_generator{std::chrono::duration_cast<loot_gen::LootGenerator::TimeInterval>(std::chrono::duration<double>{game.period}), game.probability};
 
             pqxx::connection conn{game.db_url};
@@ -204,12 +381,36 @@ int main(int argc, const char* argv[]) {
             )");
             work.commit();
 
+            // Метрики пишут тики, обработчик запросов и поток записи в базу, читает /metrics
+            metrics::Registry metrics_registry;
+            tick_profiler::Profiler tick_profiler;
+            if (args->tick_profile) {
+                game.SetTickProfiler(&tick_profiler);
+            }
+
+            // Ушедшие на пенсию игроки записываются в базу отдельным потоком
+            retirement_sink::RetirementSink retirement_sink{MakeRetiredPlayersWriter(game.db_url, metrics_registry),
+                                                            4096, 256, args->retirement_spill_dir};
+            game.SetRetirementSink(&retirement_sink);
+            leaderboard::Leaderboard records;
+            game.SetLeaderboard(&records);
+
             // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-            http_handler::RequestHandler handler{game, args->www_root, api_strand, static_cast<bool>(args->tick_period), loot_generator, game.db_url};
+            // Таблица рекордов читается через пул асинхронных соединений
+            auto db_pool = std::make_shared<postgres::ConnectionPool>(ioc, game.db_url, DB_POOL_SIZE);
+            db_pool->Start();
+            LoadLeaderboard(ioc, *db_pool, records);
+
+            http_handler::RequestHandler handler{game, args->www_root, api_strand, static_cast<bool>(args->tick_period), loot_generator, db_pool, records, metrics_registry, args->metrics_path, args->overload};
+            if (args->tick_profile) {
+                handler.SetTickProfiler(&tick_profiler);
+            }
 
             if (static_cast<bool>(args->tick_period)) {
                 auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds(args->tick_period),
-                    [&game, &loot_generator](std::chrono::milliseconds delta) { game.Tick(delta.count(), loot_generator); }
+                    [&handler](std::chrono::milliseconds delta) {
+                        handler.Tick(delta);
+                    }
                 );
                 ticker->Start();
             }
@@ -217,9 +418,30 @@ int main(int argc, const char* argv[]) {
             // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
             const auto address = net::ip::make_address("0.0.0.0");
             constexpr net::ip::port_type port = 8080;
-            http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, auto&& send) {
-                handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-            });
+            const auto serve_http = [&](net::io_context& context, bool reuse_port) {
+                http_server::ServeHttp(context, {address, port}, access_log, [&handler](auto&& req, auto&& send) {
+                    handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+                }, [&handler](auto&& stream, auto&& req) {
+                    handler.HandleUpgrade(std::forward<decltype(stream)>(stream), std::forward<decltype(req)>(req));
+                }, reuse_port);
+            };
+            // Каждое ядро принимает соединения своим acceptor с SO_REUSEPORT и обслуживает их
+            // в своём io_context без общих блокировок. С игрой эти потоки общаются только
+            // сообщениями: изменяющие запросы уходят в api_strand, ответы возвращаются в поток соединения
+            std::vector<std::jthread> connection_threads;
+            if (args->thread_per_core) {
+                for (size_t i = 0; i < cpus.size(); ++i) {
+                    serve_http(*connection_contexts.emplace_back(std::make_unique<net::io_context>(1)), true);
+                }
+                for (size_t i = 0; i < cpus.size(); ++i) {
+                    connection_threads.emplace_back([&context = *connection_contexts[i], cpu = cpus[i]] {
+                        PinThreadToCpu(cpu);
+                        context.run();
+                    });
+                }
+            } else {
+                serve_http(ioc, false);
+            }
 
             // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
             //std::cout << "Server has started..."sv << std::endl;
@@ -231,18 +453,26 @@ int main(int argc, const char* argv[]) {
                                     << "server started"sv;
 
             // 6. Запускаем обработку асинхронных операций
-            RunThreads(std::max(1u, num_threads), [&ioc] {
+            RunThreads(num_threads, [&ioc] {
                 ioc.run();
             });
+            connection_threads.clear();
+
+            retirement_sink.Stop();
+            const auto sink_stats = retirement_sink.GetStats();
+            BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data,
+                                    json::value{
+                                        {"written", sink_stats.written},
+                                        {"dropped", sink_stats.dropped},
+                                        {"failedAttempts", sink_stats.failed_attempts},
+                                        {"spilled", sink_stats.spilled},
+                                        {"spillFiles", sink_stats.spill_files},
+                                        {"maxQueueSize", sink_stats.max_queue_size}
+                                    })
+                                    << "retired players flushed"sv;
 
             if (args->contains_state_file) {
-                //std::ofstream out(args->state_file);
-                std::ofstream out(args->state_file + "_temp.txt");
-                OutputArchive output_archive{out};
-                model::Players players;
-                output_archive << players;
-                output_archive << game;
-                std::filesystem::rename(args->state_file + "_temp.txt", args->state_file);
+                model::SaveState(game, args->state_file);
             }
 
         }
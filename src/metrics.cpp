@@ -0,0 +1,175 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
+namespace metrics {
+
+using namespace std::literals;
+
+namespace detail {
+
+size_t ThreadShard() noexcept {
+    static std::atomic<size_t> next_shard{0};
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+}  // namespace detail
+
+namespace {
+
+// Границы le в выводе: от 64 мкс до 2^25 мкс (около 33 с), все интервалы гистограммы между ними
+constexpr std::uint64_t EXPORT_FROM_MICROS = 64;
+constexpr std::uint64_t EXPORT_TO_MICROS = std::uint64_t{1} << 25;
+
+void AppendNumber(std::string& out, double value) {
+    char buffer[32];
+    const auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    out.append(buffer, end);
+}
+
+void AppendName(std::string& out, std::string_view name, std::string_view suffix, std::string_view labels) {
+    out.append(name).append(suffix);
+    if (!labels.empty()) {
+        out.append("{"sv).append(labels).append("}"sv);
+    }
+}
+
+}  // namespace
+
+std::uint64_t Counter::Value() const noexcept {
+    std::uint64_t value = 0;
+    for (const auto& shard : shards_) {
+        value += shard.value.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+size_t Histogram::BucketIndex(std::uint64_t micros) noexcept {
+    if (micros < SUB_BUCKETS) {
+        return static_cast<size_t>(micros);
+    }
+    micros = std::min(micros, (std::uint64_t{1} << MAX_BITS) - 1);
+    const unsigned exponent = static_cast<unsigned>(std::bit_width(micros)) - 1;
+    const unsigned shift = exponent - SUB_BUCKET_BITS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS + ((micros >> shift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t Histogram::BucketLimit(size_t index) noexcept {
+    if (index < SUB_BUCKETS) {
+        return index + 1;
+    }
+    const size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    const std::uint64_t sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub_bucket + 1) << shift;
+}
+
+Histogram::Snapshot Histogram::Collect() const noexcept {
+    Snapshot snapshot;
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            const auto count = shard.buckets[i].load(std::memory_order_relaxed);
+            snapshot.buckets[i] += count;
+            snapshot.count += count;
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+HistogramTable::HistogramTable(std::string label, std::vector<std::string> rows)
+    : label_{std::move(label)}
+    , rows_{std::move(rows)}
+    , cells_{std::make_unique<std::atomic<Histogram*>[]>(rows_.size() * CODES)} {
+}
+
+HistogramTable::~HistogramTable() {
+    for (size_t i = 0; i < rows_.size() * CODES; ++i) {
+        delete cells_[i].load(std::memory_order_relaxed);
+    }
+}
+
+void HistogramTable::Record(size_t row, unsigned code, Clock::duration duration) {
+    if (code < MIN_CODE || code > MAX_CODE) {
+        code = MAX_CODE;
+    }
+    auto& cell = cells_[row * CODES + (code - MIN_CODE)];
+    Histogram* histogram = cell.load(std::memory_order_acquire);
+    if (!histogram) {
+        auto created = std::make_unique<Histogram>();
+        if (cell.compare_exchange_strong(histogram, created.get(), std::memory_order_acq_rel)) {
+            histogram = created.release();
+        }
+    }
+    histogram->Record(duration);
+}
+
+void HistogramTable::Write(std::string& out, std::string_view name, std::string_view help) const {
+    WriteHeader(out, name, "histogram"sv, help);
+    std::string labels;
+    for (size_t row = 0; row < rows_.size(); ++row) {
+        for (size_t code = 0; code < CODES; ++code) {
+            const Histogram* histogram = cells_[row * CODES + code].load(std::memory_order_acquire);
+            if (!histogram) {
+                continue;
+            }
+            labels.assign(label_).append("=\""sv).append(rows_[row]).append("\",code=\""sv)
+                .append(std::to_string(MIN_CODE + code)).append("\""sv);
+            WriteHistogram(out, name, labels, histogram->Collect());
+        }
+    }
+}
+
+void WriteHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+    out.append("# HELP "sv).append(name).append(" "sv).append(help).append("\n"sv);
+    out.append("# TYPE "sv).append(name).append(" "sv).append(type).append("\n"sv);
+}
+
+void WriteSample(std::string& out, std::string_view name, std::string_view labels, double value) {
+    AppendName(out, name, ""sv, labels);
+    out.append(" "sv);
+    AppendNumber(out, value);
+    out.append("\n"sv);
+}
+
+void WriteHistogram(std::string& out, std::string_view name, std::string_view labels, const Histogram::Snapshot& snapshot) {
+    const std::string separator = labels.empty() ? ""s : ","s;
+    std::uint64_t cumulative = 0;
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+        cumulative += snapshot.buckets[i];
+        const auto limit = Histogram::BucketLimit(i);
+        if (limit < EXPORT_FROM_MICROS || limit > EXPORT_TO_MICROS) {
+            continue;
+        }
+        out.append(name).append("_bucket{"sv).append(labels).append(separator).append("le=\""sv);
+        AppendNumber(out, static_cast<double>(limit) / 1e6);
+        out.append("\"} "sv).append(std::to_string(cumulative)).append("\n"sv);
+    }
+    out.append(name).append("_bucket{"sv).append(labels).append(separator).append("le=\"+Inf\"} "sv)
+        .append(std::to_string(snapshot.count)).append("\n"sv);
+    AppendName(out, name, "_sum"sv, labels);
+    out.append(" "sv);
+    AppendNumber(out, static_cast<double>(snapshot.sum) / 1e6);
+    out.append("\n"sv);
+    AppendName(out, name, "_count"sv, labels);
+    out.append(" "sv).append(std::to_string(snapshot.count)).append("\n"sv);
+}
+
+void Registry::Write(std::string& out) const {
+    WriteHeader(out, "dog_story_tick_duration_seconds"sv, "histogram"sv, "Game tick duration"sv);
+    WriteHistogram(out, "dog_story_tick_duration_seconds"sv, ""sv, tick_duration.Collect());
+    WriteHeader(out, "dog_story_db_write_duration_seconds"sv, "histogram"sv, "Retired players batch write duration"sv);
+    WriteHistogram(out, "dog_story_db_write_duration_seconds"sv, ""sv, db_write_duration.Collect());
+    WriteHeader(out, "dog_story_db_write_errors_total"sv, "counter"sv, "Failed retired players batch writes"sv);
+    WriteSample(out, "dog_story_db_write_errors_total"sv, ""sv, static_cast<double>(db_write_errors.Value()));
+    WriteHeader(out, "dog_story_sessions"sv, "gauge"sv, "Game sessions"sv);
+    WriteSample(out, "dog_story_sessions"sv, ""sv, static_cast<double>(sessions.Value()));
+    WriteHeader(out, "dog_story_dogs"sv, "gauge"sv, "Dogs in all sessions"sv);
+    WriteSample(out, "dog_story_dogs"sv, ""sv, static_cast<double>(dogs.Value()));
+    WriteHeader(out, "dog_story_lost_objects"sv, "gauge"sv, "Lost objects on all maps"sv);
+    WriteSample(out, "dog_story_lost_objects"sv, ""sv, static_cast<double>(lost_objects.Value()));
+}
+
+}  // namespace metrics
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace metrics {
+
+using Clock = std::chrono::steady_clock;
+
+namespace detail {
+
+// Счётчики разбиты на шарды, и каждый поток пишет в свой: запись - атомарное
+// сложение без борьбы потоков за кеш-линию, а чтение складывает шарды
+constexpr size_t SHARDS = 8;
+
+size_t ThreadShard() noexcept;
+
+}  // namespace detail
+
+class Counter {
+public:
+    void Add(std::uint64_t value = 1) noexcept {
+        shards_[detail::ThreadShard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::array<Shard, detail::SHARDS> shards_;
+};
+
+class Gauge {
+public:
+    void Set(std::int64_t value) noexcept {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void Add(std::int64_t delta) noexcept {
+        value_.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    std::int64_t Value() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> value_{0};
+};
+
+/*
+ *  Гистограмма длительностей в микросекундах в духе HDR Histogram: интервалы растут
+ *  вдвое, и каждый делится на SUB_BUCKETS равных частей. Номер интервала считается
+ *  по старшим битам значения, без поиска по границам.
+ */
+class Histogram {
+public:
+    constexpr static unsigned SUB_BUCKET_BITS = 1;
+    constexpr static std::uint64_t SUB_BUCKETS = std::uint64_t{1} << SUB_BUCKET_BITS;
+    // Больше 2^40 мкс (около 12 суток) значения не различаются
+    constexpr static unsigned MAX_BITS = 40;
+    constexpr static size_t BUCKETS = SUB_BUCKETS + (MAX_BITS - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static size_t BucketIndex(std::uint64_t micros) noexcept;
+    // Значения интервала index меньше этой границы
+    static std::uint64_t BucketLimit(size_t index) noexcept;
+
+    void Record(std::uint64_t micros) noexcept {
+        Shard& shard = shards_[detail::ThreadShard()];
+        shard.buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    void Record(Clock::duration duration) noexcept {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        Record(static_cast<std::uint64_t>(micros > 0 ? micros : 0));
+    }
+
+    struct Snapshot {
+        std::array<std::uint64_t, BUCKETS> buckets{};
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+    };
+
+    Snapshot Collect() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+        std::atomic<std::uint64_t> sum{0};
+    };
+
+    std::array<Shard, detail::SHARDS> shards_;
+};
+
+/*
+ *  Гистограммы по значению метки (строке таблицы) и коду ответа HTTP.
+ *  Гистограмма создаётся при первой записи и публикуется через CAS, без блокировок.
+ */
+class HistogramTable {
+public:
+    constexpr static unsigned MIN_CODE = 100;
+    constexpr static unsigned MAX_CODE = 599;
+
+    HistogramTable(std::string label, std::vector<std::string> rows);
+    ~HistogramTable();
+
+    HistogramTable(const HistogramTable&) = delete;
+    HistogramTable& operator=(const HistogramTable&) = delete;
+
+    // Коды вне [MIN_CODE, MAX_CODE] учитываются как MAX_CODE
+    void Record(size_t row, unsigned code, Clock::duration duration);
+
+    void Write(std::string& out, std::string_view name, std::string_view help) const;
+
+private:
+    constexpr static size_t CODES = MAX_CODE - MIN_CODE + 1;
+
+    std::string label_;
+    std::vector<std::string> rows_;
+    std::unique_ptr<std::atomic<Histogram*>[]> cells_;
+};
+
+// Текстовый формат Prometheus
+void WriteHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help);
+void WriteSample(std::string& out, std::string_view name, std::string_view labels, double value);
+void WriteHistogram(std::string& out, std::string_view name, std::string_view labels, const Histogram::Snapshot& snapshot);
+
+// Метрики игры и базы данных; HTTP-метрики собирает обработчик запросов
+struct Registry {
+    Histogram tick_duration;
+    Histogram db_write_duration;
+    Counter db_write_errors;
+    Gauge sessions;
+    Gauge dogs;
+    Gauge lost_objects;
+
+    void Write(std::string& out) const;
+};
+
+}  // namespace metrics
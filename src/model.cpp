@@ -1,10 +1,23 @@
 #include "model.h"
 
+#include <boost/archive/text_iarchive.hpp>
+#include <charconv>
 #include <stdexcept>
 
+#include "snapshot.h"
+
 namespace model {
 using namespace std::literals;
 
+void Map::AddRoad(const Road& road) {
+    roads_.emplace_back(road);
+    if (road.IsHorizontal()) {
+        road_index_.AddHorizontal(road.GetStart().y, road.GetStart().x, road.GetEnd().x);
+    } else {
+        road_index_.AddVertical(road.GetStart().x, road.GetStart().y, road.GetEnd().y);
+    }
+}
+
 void Map::AddOffice(const Office& office) {
     if (warehouse_id_to_index_.contains(office.GetId())) {
         throw std::invalid_argument("Duplicate warehouse");
@@ -19,6 +32,7 @@ void Map::AddOffice(const Office& office) {
         offices_.pop_back();
         throw;
     }
+    offices_grid_.Insert(index, {{static_cast<double>(o.GetPosition().x), static_cast<double>(o.GetPosition().y)}, Office::WIDTH / 2});
 }
 
 void Game::AddMap(const Map& map) {
@@ -37,10 +51,184 @@ void Game::AddMap(const Map& map) {
 
 std::uint64_t Dog::next_dog_id_{0};
 
-std::map<Player::Token, std::shared_ptr<Player>> Players::token_to_player_;
+void SaveState(const Game& game, const std::string& path) {
+    snapshot::BinaryOArchive output_archive;
+    output_archive << game.GetPlayers();
+    output_archive << game;
+    const std::string temp_path = path + "_temp"s;
+    output_archive.SaveToFile(temp_path);
+    std::filesystem::rename(temp_path, path);
+}
+
+namespace {
+
+bool DogStateChanged(const SessionSnapshot::DogState& lhs, const SessionSnapshot::DogState& rhs) {
+    return lhs.x != rhs.x || lhs.y != rhs.y || lhs.dx != rhs.dx || lhs.dy != rhs.dy
+        || lhs.dir != rhs.dir || lhs.bag != rhs.bag || lhs.score != rhs.score;
+}
+
+// Объединяет упорядоченные списки id без повторов
+template <typename Id>
+void MergeIds(std::vector<Id>& ids, const std::vector<Id>& more) {
+    const size_t middle = ids.size();
+    ids.insert(ids.end(), more.begin(), more.end());
+    std::inplace_merge(ids.begin(), ids.begin() + middle, ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+template <typename State, typename Id>
+const State* FindById(const std::vector<State>& states, const Id& id) {
+    auto it = std::lower_bound(states.begin(), states.end(), id, [](const State& state, const Id& id) {
+        return state.id < id;
+    });
+    return it != states.end() && it->id == id ? &*it : nullptr;
+}
+
+}  // namespace
 
-void DeletePlayer(const Dog::Id& dog_id, const Map::Id& map_id) {
-    Players::EraseByToken(Players::FindByDogIdAndMapId(dog_id, map_id)->GetToken());
+SessionSnapshot::Change DiffSnapshots(const SessionSnapshot& previous, const SessionSnapshot& current) {
+    SessionSnapshot::Change change;
+    change.version = current.version;
+    // Собаки и трофеи в снимках упорядочены по id, поэтому хватает одного прохода слиянием
+    auto old_dog = previous.dogs.begin();
+    for (const auto& dog : current.dogs) {
+        for (; old_dog != previous.dogs.end() && old_dog->id < dog.id; ++old_dog) {
+            change.removed_dogs.push_back(old_dog->id);
+        }
+        if (old_dog != previous.dogs.end() && old_dog->id == dog.id) {
+            if (DogStateChanged(*old_dog, dog)) {
+                change.changed_dogs.push_back(dog.id);
+            }
+            ++old_dog;
+        } else {
+            change.changed_dogs.push_back(dog.id);
+        }
+    }
+    for (; old_dog != previous.dogs.end(); ++old_dog) {
+        change.removed_dogs.push_back(old_dog->id);
+    }
+
+    auto old_loot = previous.lost_objects.begin();
+    for (const auto& loot : current.lost_objects) {
+        for (; old_loot != previous.lost_objects.end() && old_loot->id < loot.id; ++old_loot) {
+            change.removed_loot.push_back(old_loot->id);
+        }
+        if (old_loot != previous.lost_objects.end() && old_loot->id == loot.id) {
+            ++old_loot;
+        } else {
+            change.spawned_loot.push_back(loot.id);
+        }
+    }
+    for (; old_loot != previous.lost_objects.end(); ++old_loot) {
+        change.removed_loot.push_back(old_loot->id);
+    }
+    return change;
+}
+
+std::optional<SessionSnapshot::Since> SessionSnapshot::Since::Parse(std::string_view token) {
+    Since since;
+    const char* const end = token.data() + token.size();
+    const auto serial = std::from_chars(token.data(), end, since.session_serial);
+    if (serial.ec != std::errc{} || serial.ptr == end || *serial.ptr != '.') {
+        return std::nullopt;
+    }
+    const auto version = std::from_chars(serial.ptr + 1, end, since.version);
+    if (version.ec != std::errc{} || version.ptr != end) {
+        return std::nullopt;
+    }
+    return since;
+}
+
+std::string SessionSnapshot::Since::ToString() const {
+    return std::to_string(session_serial) + "." + std::to_string(version);
+}
+
+SessionSnapshot::Delta SessionSnapshot::GetDelta(const Since& since_token) const {
+    Delta delta;
+    const std::uint64_t since = since_token.version;
+    // Изменения снимков с версиями от since + 1 до version должны быть в кольце целиком
+    const bool covered = since_token.session_serial == session_serial && since <= version
+        && (since == version || (!changes.empty() && changes.front()->version <= since + 1));
+    if (!covered) {
+        delta.full = true;
+        delta.dogs.reserve(dogs.size());
+        for (const auto& dog : dogs) {
+            delta.dogs.push_back(&dog);
+        }
+        delta.spawned_loot.reserve(lost_objects.size());
+        for (const auto& loot : lost_objects) {
+            delta.spawned_loot.push_back(&loot);
+        }
+        return delta;
+    }
+
+    std::vector<Dog::Id> changed_dogs;
+    std::vector<Dog::Id> removed_dogs;
+    std::vector<int> spawned_loot;
+    std::vector<int> removed_loot;
+    for (const auto& change : changes) {
+        if (change->version <= since) {
+            continue;
+        }
+        MergeIds(changed_dogs, change->changed_dogs);
+        MergeIds(removed_dogs, change->removed_dogs);
+        MergeIds(spawned_loot, change->spawned_loot);
+        MergeIds(removed_loot, change->removed_loot);
+    }
+    // Id встречается в обоих списках, если объект появился и исчез после since:
+    // клиенту достаточно узнать, что его нет
+    for (const auto& id : changed_dogs) {
+        if (const DogState* dog = FindById(dogs, id)) {
+            delta.dogs.push_back(dog);
+        }
+    }
+    for (const auto& id : removed_dogs) {
+        if (!FindById(dogs, id)) {
+            delta.removed_dogs.push_back(id);
+        }
+    }
+    for (int id : spawned_loot) {
+        if (const LootState* loot = FindById(lost_objects, id)) {
+            delta.spawned_loot.push_back(loot);
+        }
+    }
+    for (int id : removed_loot) {
+        if (!FindById(lost_objects, id)) {
+            delta.removed_loot.push_back(id);
+        }
+    }
+    return delta;
+}
+
+bool LoadState(Game& game, const std::string& path) {
+    if (!std::filesystem::exists(path)) {
+        return false;
+    }
+    Players& players = game.GetPlayers();
+    if (snapshot::IsSnapshotFile(path)) {
+        snapshot::MappedFile file{path};
+        snapshot::BinaryIArchive input_archive{file.Data()};
+        input_archive >> players;
+        input_archive >> game;
+    } else {
+        std::ifstream in(path);
+        boost::archive::text_iarchive input_archive{in};
+        input_archive >> players;
+        input_archive >> game;
+    }
+
+    for (auto& [map_id, game_sessions] : game.game_sessions_on_map_) {
+        for (auto& game_session : game_sessions) {
+            game_session->map_ = game.FindMap(map_id);
+            for (auto& [dog_id, dog] : game_session->dogs_) {
+                std::shared_ptr<Player> player = players.FindByDogIdAndMapId(dog_id, map_id);
+                player->GetSession() = game_session;
+                dog = player->GetDog();
+            }
+            game_session->PublishSnapshot();
+        }
+    }
+    return true;
 }
 
 }  // namespace model
@@ -11,20 +11,30 @@
 #include <chrono>
 #include <fstream>
 #include <filesystem>
+#include <optional>
+#include <string_view>
+#include <algorithm>
+#include <mutex>
 
 #include <boost/json.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/signals2.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <pqxx/pqxx>
 #include <iostream>
 
 #include "tagged.h"
 #include "loot_generator.h"
 #include "collision_detector.h"
+#include "road_index.h"
 #include "tagged_uuid.h"
+#include "parallel_for.h"
+#include "retirement_sink.h"
+#include "leaderboard.h"
+#include "token_table.h"
+#include "lazy_buffer.h"
+#include "tick_profiler.h"
 
 namespace model {
 
@@ -35,7 +45,6 @@ namespace json = boost::json;
 namespace sig = boost::signals2;
 using milliseconds = std::chrono::milliseconds;
 using namespace std::literals;
-using OutputArchive = boost::archive::text_oarchive;
 
 struct Point {
     Coord x, y;
@@ -79,6 +88,7 @@ class Road {
 public:
     constexpr static HorizontalTag HORIZONTAL{};
     constexpr static VerticalTag VERTICAL{};
+    constexpr static double WIDTH = 0.8;
 
     Road(HorizontalTag, Point start, Coord end_x) noexcept
         : start_{start}
@@ -129,6 +139,8 @@ class Office {
 public:
     using Id = util::Tagged<std::string, Office>;
 
+    constexpr static double WIDTH = 0.5;
+
     Office(Id id, Point position, Offset offset) noexcept
         : id_{std::move(id)}
         , position_{position}
@@ -189,8 +201,19 @@ public:
         return loot_types_;
     }
 
-    void AddRoad(const Road& road) {
-        roads_.emplace_back(road);
+    const road_index::RoadIndex& GetRoadIndex() const noexcept {
+        return road_index_;
+    }
+
+    const collision_detector::ItemGrid& GetOfficesGrid() const noexcept {
+        return offices_grid_;
+    }
+
+    void AddRoad(const Road& road);
+
+    // Вызывается после загрузки всех дорог карты
+    void BuildRoadIndex() {
+        road_index_.Build();
     }
 
     void AddBuilding(const Building& building) {
@@ -211,11 +234,13 @@ private:
     Id id_;
     std::string name_;
     Roads roads_;
+    road_index::RoadIndex road_index_{Road::WIDTH};
     Buildings buildings_;
     json::array loot_types_;
 
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
+    collision_detector::ItemGrid offices_grid_;
 };
 
 class Dog {
@@ -306,16 +331,95 @@ private:
     std::string name_;
 };
 
-void DeletePlayer(const Dog::Id& dog_id, const Map::Id& map_id);
+// Неизменяемый снимок сессии. Его публикует api_strand после каждого изменения сессии,
+// а обработчики чтения берут из любого потока, не заходя в api_strand
+struct SessionSnapshot {
+    struct DogState {
+        Dog::Id id;
+        std::string name;
+        double x, y;
+        double dx, dy;
+        std::string dir;
+        std::vector<std::pair<int, int>> bag;
+        int score;
+    };
+
+    struct LootState {
+        int id;
+        int type;
+        double x, y;
+    };
+
+    // упорядочены по id, как в сессии
+    std::vector<DogState> dogs;
+    std::vector<LootState> lost_objects;
+    // номер сессии в процессе и номер снимка в сессии, вместе - ETag состояния
+    // и токен since, по которому клиент получает только изменения
+    std::uint64_t session_serial = 0;
+    std::uint64_t version = 0;
+    // JSON состояния кодируется один раз, при первом чтении снимка; двоичное состояние так же
+    lazy_buffer::LazyBuffer encoded_state;
+    lazy_buffer::LazyBuffer encoded_binary_state;
+
+    // Отличия снимка от предыдущего. Id в каждом списке упорядочены
+    struct Change {
+        std::uint64_t version = 0;
+        std::vector<Dog::Id> changed_dogs;
+        std::vector<Dog::Id> removed_dogs;
+        std::vector<int> spawned_loot;
+        std::vector<int> removed_loot;
+    };
+    // Кольцо изменений последних снимков, от старых к новым; последнее - изменение этого снимка.
+    // Изменения не ссылаются на снимки, поэтому старые снимки не удерживаются в памяти
+    std::vector<std::shared_ptr<const Change>> changes;
+    constexpr static size_t MAX_CHANGES = 64;
+
+    // Токен "<session_serial>.<version>" из поля tick ответа, который клиент присылает в ?since=.
+    // Версии всех сессий начинаются с времени запуска процесса, поэтому без номера сессии
+    // версия чужой сессии сошла бы за свою
+    struct Since {
+        std::uint64_t session_serial = 0;
+        std::uint64_t version = 0;
+
+        static std::optional<Since> Parse(std::string_view token);
+        std::string ToString() const;
+    };
+
+    Since GetSince() const {
+        return {session_serial, version};
+    }
+
+    struct Delta {
+        // true, если since от другой сессии или старше кольца изменений: тогда в дельте всё состояние
+        bool full = false;
+        std::vector<const DogState*> dogs;
+        std::vector<Dog::Id> removed_dogs;
+        std::vector<const LootState*> spawned_loot;
+        std::vector<int> removed_loot;
+    };
+    // Собаки и трофеи, изменившиеся после снимка since
+    Delta GetDelta(const Since& since) const;
+};
+
+// Считает, что изменилось в current по сравнению с previous
+SessionSnapshot::Change DiffSnapshots(const SessionSnapshot& previous, const SessionSnapshot& current);
+
+class Game;
+
+// Сохраняет игроков и игровые сессии в двоичном формате snapshot
+void SaveState(const Game& game, const std::string& path);
+
+// Восстанавливает состояние из двоичного файла или из текстового архива Boost прежних версий.
+// Возвращает false, если файла нет
+bool LoadState(Game& game, const std::string& path);
 
 class GameSession {
 public:
-    GameSession(const Map* map, double game_dog_speed, int game_bag_capacity, double dog_retirement_time, std::string db_url)
+    GameSession(const Map* map, double game_dog_speed, int game_bag_capacity, double dog_retirement_time)
         : map_{map}
         , dog_speed_{map->map_dog_speed_ < 0 ? game_dog_speed : map->map_dog_speed_}
         , bag_capacity_{map->map_bag_capacity_ < 0 ? game_bag_capacity : map->map_bag_capacity_}
-        , dog_retirement_time_{dog_retirement_time}
-        , db_url_{db_url} {
+        , dog_retirement_time_{dog_retirement_time} {
     }
 
     GameSession() {}
@@ -324,6 +428,10 @@ public:
         return map_->GetId();
     }
 
+    std::uint64_t GetSerial() const {
+        return serial_;
+    }
+
     const std::map<Dog::Id, std::shared_ptr<Dog>>& GetDogs() const {
         return dogs_;
     }
@@ -344,30 +452,60 @@ public:
         }
         dog->s = dog_speed_;
         dog->cap = bag_capacity_;
+        PublishSnapshot();
+    }
+
+    std::shared_ptr<const SessionSnapshot> GetSnapshot() const {
+        return std::atomic_load(&snapshot_);
     }
 
-    void Tick(int time_delta, loot_gen::LootGenerator& loot_generator) {
+    // Отмечает изменение собак вне тика, например смену направления. Снимок с ним
+    // публикует ближайший Tick, так что частые действия игроков не копируют сессию каждый раз
+    void MarkChanged() {
+        snapshot_dirty_ = true;
+    }
+
+    // Вызывается в api_strand после изменения собак или трофеев сессии
+    void PublishSnapshot() {
+        snapshot_dirty_ = false;
+        auto snapshot = std::make_shared<SessionSnapshot>();
+        snapshot->dogs.reserve(dogs_.size());
+        for (const auto& [id, dog] : dogs_) {
+            snapshot->dogs.push_back({id, dog->GetName(), dog->x, dog->y, dog->dx, dog->dy, dog->dir, dog->bag_, dog->score});
+        }
+        snapshot->lost_objects.reserve(lost_objects_.size());
+        for (const auto& [id, loot] : lost_objects_) {
+            snapshot->lost_objects.push_back({id, loot.type, loot.x, loot.y});
+        }
+        snapshot->session_serial = serial_;
+        snapshot->version = ++snapshot_version_;
+        const auto& previous = *snapshot_;
+        const size_t kept = std::min(previous.changes.size(), SessionSnapshot::MAX_CHANGES - 1);
+        snapshot->changes.reserve(kept + 1);
+        snapshot->changes.assign(previous.changes.end() - kept, previous.changes.end());
+        snapshot->changes.push_back(std::make_shared<const SessionSnapshot::Change>(DiffSnapshots(previous, *snapshot)));
+        std::atomic_store(&snapshot_, std::shared_ptr<const SessionSnapshot>{std::move(snapshot)});
+    }
+
+    // Сессии тикают параллельно, поэтому сессия не трогает общих для игры данных.
+    // Возвращает собак, ушедших на пенсию: их игроков удаляет и записывает в базу вызывающий.
+    // loot_generator - образец, с которого сессия копирует собственный генератор трофеев.
+    // В trace, если он есть, записывается время фаз тика
+    std::vector<std::shared_ptr<Dog>> Tick(int time_delta, const loot_gen::LootGenerator& loot_generator, tick_profiler::Trace* trace = nullptr) {
+        tick_profiler::Stopwatch stopwatch{trace};
         std::vector<collision_detector::Gatherer> gatherers;
         std::vector<int> gatherer_to_dog;
+        // Тик без движения, сбора, ухода на пенсию и новых трофеев не меняет снимок
+        bool changed = snapshot_dirty_;
         for (auto& [id, dog] : dogs_) {
+            changed = changed || dog->dx != 0 || dog->dy != 0;
             gatherers.push_back({{dog->x, dog->y}, {0, 0}, DOG_WIDTH / 2});
             gatherer_to_dog.push_back(*dog->GetId());
-            double minimum_x = 1e9;
-            double maximum_x = -1e9;
-            double minimum_y = 1e9;
-            double maximum_y = -1e9;
-            for (const auto& road : map_->GetRoads()) {
-                double min_x = std::min(road.GetStart().x, road.GetEnd().x) - ROAD_WIDTH / 2;
-                double max_x = std::max(road.GetStart().x, road.GetEnd().x) + ROAD_WIDTH / 2;
-                double min_y = std::min(road.GetStart().y, road.GetEnd().y) - ROAD_WIDTH / 2;
-                double max_y = std::max(road.GetStart().y, road.GetEnd().y) + ROAD_WIDTH / 2;
-                if (min_x <= dog->x && dog->x <= max_x && min_y <= dog->y && dog->y <= max_y) {
-                    minimum_x = std::min(minimum_x, min_x);
-                    maximum_x = std::max(maximum_x, max_x);
-                    minimum_y = std::min(minimum_y, min_y);
-                    maximum_y = std::max(maximum_y, max_y);
-                }
-            }
+            const road_index::Area area = map_->GetRoadIndex().FindArea(dog->x, dog->y);
+            const double minimum_x = area.min_x;
+            const double maximum_x = area.max_x;
+            const double minimum_y = area.min_y;
+            const double maximum_y = area.max_y;
             dog->x += dog->dx * time_delta / MILLISECONDS_IN_SECOND;
             dog->y += dog->dy * time_delta / MILLISECONDS_IN_SECOND;
             if (dog->x < minimum_x) {
@@ -400,24 +538,16 @@ public:
             }
             gatherers.back().end_pos = {dog->x, dog->y};
         }
-        std::vector<collision_detector::Item> items;
-        std::vector<int> item_to_object;
-        for (const auto& [id, item] : lost_objects_) {
-            items.push_back({{item.x, item.y}, ITEM_WIDTH / 2});
-            item_to_object.push_back(id);
-        }
-        int item_count = items.size();
-        for (const auto& office : map_->GetOffices()) {
-            items.push_back({{static_cast<double>(office.GetPosition().x), static_cast<double>(office.GetPosition().y)}, OFFICE_WIDTH / 2});
-        }
-        collision_detector::VectorItemGathererProvider provider{items, gatherers};
-        std::vector<collision_detector::GatheringEvent> events = collision_detector::FindGatherEvents(provider);
+        stopwatch.Lap(tick_profiler::Phase::MOVE);
+        std::vector<collision_detector::GatheringEvent> events = collision_detector::FindGatherEvents(gatherers, {&lost_objects_grid_, &map_->GetOfficesGrid()});
+        changed = changed || !events.empty();
         for (const auto& event : events) {
             auto& dog = dogs_[Dog::Id(gatherer_to_dog[event.gatherer_id])];
-            if (event.item_id < item_count) {
-                if (dog->bag_.size() < dog->cap && lost_objects_.count(item_to_object[event.item_id])) {
-                    dog->bag_.push_back({item_to_object[event.item_id], lost_objects_[item_to_object[event.item_id]].type});
-                    lost_objects_.erase(item_to_object[event.item_id]);
+            if (event.layer == LOOT_LAYER) {
+                const int loot_id = static_cast<int>(event.item_id);
+                if (dog->bag_.size() < dog->cap && lost_objects_.count(loot_id)) {
+                    dog->bag_.push_back({loot_id, lost_objects_[loot_id].type});
+                    EraseLoot(loot_id);
                 }
             } else {
                 for (const auto& [id, type] : dog->bag_) {
@@ -426,7 +556,8 @@ public:
                 dog->bag_.clear();
             }
         }
-        std::vector<Dog::Id> dogs_to_remove;
+        stopwatch.Lap(tick_profiler::Phase::GATHER);
+        std::vector<std::shared_ptr<Dog>> dogs_to_remove;
         for (auto& [id, dog] : dogs_) {
             if (dog->already_stopped) {
                 dog->time_playing += time_delta;
@@ -436,16 +567,7 @@ public:
             if (dog->dx == 0 && dog->dy == 0) {
                 if ((dog->time_standing + time_delta) / MILLISECONDS_IN_SECOND >= dog_retirement_time_) {
                     dog->time_playing += dog_retirement_time_ * MILLISECONDS_IN_SECOND - dog->time_standing;
-                    pqxx::connection conn{db_url_};
-                    pqxx::work work{conn};
-                    work.exec_params(R"(
-                        INSERT INTO retired_players (id, name, score, play_time_ms) VALUES (gen_random_uuid(), $1, $2, $3);
-                    )",
-                        dog->GetName(),
-                        dog->score,
-                        dog->time_playing);
-                    work.commit();
-                    dogs_to_remove.push_back(id);
+                    dogs_to_remove.push_back(dog);
                 } else {
                     dog->time_standing += time_delta;
                     dog->time_playing += time_delta;
@@ -455,37 +577,65 @@ public:
                 dog->time_playing += time_delta;
             }
         }
-        for (const auto& id : dogs_to_remove) {
-            DeletePlayer(id, map_->GetId());
-            dogs_.erase(id);
+        for (const auto& dog : dogs_to_remove) {
+            dogs_.erase(dog->GetId());
+        }
+        stopwatch.Lap(tick_profiler::Phase::RETIRE);
+        if (!loot_generator_) {
+            loot_generator_.emplace(loot_generator);
         }
-        int n = loot_generator.Generate(std::chrono::duration_cast<loot_gen::LootGenerator::TimeInterval>(std::chrono::duration<double>{time_delta}), lost_objects_.size(), dogs_.size());
-        while (n--) {
+        const int n_generated = loot_generator_->Generate(std::chrono::duration_cast<loot_gen::LootGenerator::TimeInterval>(std::chrono::duration<double>{time_delta}), lost_objects_.size(), dogs_.size());
+        for (int n = n_generated; n > 0; --n) {
             int type = GenerateRandomLootType();
             auto position = GenerateRandomPosition();
-            lost_objects_[next_loot_id_++] = {type, position.first, position.second};
+            AddLoot(next_loot_id_++, {type, position.first, position.second});
+        }
+        stopwatch.Lap(tick_profiler::Phase::LOOT);
+        if (changed || !dogs_to_remove.empty() || n_generated > 0) {
+            PublishSnapshot();
         }
+        stopwatch.Lap(tick_profiler::Phase::PUBLISH);
+        return dogs_to_remove;
     }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
         ar& dog_speed_;
         ar& bag_capacity_;
         ar& dogs_;
         ar& lost_objects_;
         ar& next_loot_id_;
         ar& dog_retirement_time_;
-        ar& db_url_;
+        if (version == 0) {
+            // Текстовые архивы Boost хранили строку подключения к базе в каждой сессии
+            std::string db_url;
+            ar& db_url;
+        }
+        if constexpr (Archive::is_loading::value) {
+            lost_objects_grid_.Clear();
+            for (const auto& [id, loot] : lost_objects_) {
+                lost_objects_grid_.Insert(id, {{loot.x, loot.y}, ITEM_WIDTH / 2});
+            }
+        }
     }
 
     double dog_speed_;
     int bag_capacity_;
     double dog_retirement_time_;
-    std::string db_url_;
 private:
+    void AddLoot(int id, const Loot& loot) {
+        lost_objects_[id] = loot;
+        lost_objects_grid_.Insert(id, {{loot.x, loot.y}, ITEM_WIDTH / 2});
+    }
+
+    void EraseLoot(int id) {
+        lost_objects_.erase(id);
+        lost_objects_grid_.Erase(id);
+    }
+
     std::pair<double, double> GenerateRandomPosition() {
-        static std::random_device random_device_;
-        static std::mt19937_64 generator_{[] {
+        thread_local std::random_device random_device_;
+        thread_local std::mt19937_64 generator_{[] {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
             return dist(random_device_);
         }()};
@@ -494,7 +644,7 @@ private:
         double max_x = std::max(road.GetStart().x, road.GetEnd().x) + ROAD_WIDTH / 2;
         double min_y = std::min(road.GetStart().y, road.GetEnd().y) - ROAD_WIDTH / 2;
         double max_y = std::max(road.GetStart().y, road.GetEnd().y) + ROAD_WIDTH / 2;
-        static std::default_random_engine re;
+        thread_local std::default_random_engine re;
         std::uniform_real_distribution<double> unif_x(min_x,max_x);
         double x = unif_x(re);
         std::uniform_real_distribution<double> unif_y(min_y,max_y);
@@ -503,8 +653,8 @@ private:
     }
 
     int GenerateRandomLootType() {
-        static std::random_device random_device_;
-        static std::mt19937_64 generator_{[] {
+        thread_local std::random_device random_device_;
+        thread_local std::mt19937_64 generator_{[] {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
             return dist(random_device_);
         }()};
@@ -516,14 +666,27 @@ public:
     const Map* map_;
 private:
     std::map<int, Loot> lost_objects_;
+    // Слой сетки с трофеями; офисы лежат в статическом слое карты
+    collision_detector::ItemGrid lost_objects_grid_;
+    std::optional<loot_gen::LootGenerator> loot_generator_;
+    // читается и заменяется атомарно
+    std::shared_ptr<const SessionSnapshot> snapshot_ = std::make_shared<const SessionSnapshot>();
+    std::uint64_t serial_ = ++next_serial_;
+    // Версии начинаются с момента запуска процесса, чтобы since от клиента,
+    // заставшего прошлый запуск сервера, не совпал с версией нового состояния
+    std::uint64_t snapshot_version_ = FIRST_SNAPSHOT_VERSION;
+    bool snapshot_dirty_ = false;
+    inline static std::atomic<std::uint64_t> next_serial_{0};
+    inline static const std::uint64_t FIRST_SNAPSHOT_VERSION = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
 
     int next_loot_id_ = 0;
     
     constexpr static int MILLISECONDS_IN_SECOND = 1000;
-    constexpr static double ROAD_WIDTH = 0.8;
+    constexpr static double ROAD_WIDTH = Road::WIDTH;
     constexpr static double ITEM_WIDTH = 0.0;
     constexpr static double DOG_WIDTH = 0.6;
-    constexpr static double OFFICE_WIDTH = 0.5;
+    constexpr static size_t LOOT_LAYER = 0;
 };
 
 namespace detail {
@@ -571,44 +734,119 @@ private:
     std::shared_ptr<GameSession> session_ = nullptr;
 };
 
+/*
+ *  Реестр игроков. Поиск по токену идёт по его 128-битному значению в шардированной
+ *  хеш-таблице, поиск по собаке - по обратному индексу (карта, собака) -> игрок.
+ *  Методы потокобезопасны.
+ */
 class Players {
 public:
-    static bool ContainsToken(const Player::Token& token) {
-        return token_to_player_.contains(token);
+    Players()
+        : dog_shards_{std::make_unique<DogShard[]>(DOG_SHARD_COUNT)} {
     }
 
-    static std::shared_ptr<Player> FindByToken(const Player::Token& token) {
-        return token_to_player_.at(token);
+    // Возвращает nullptr, если токен не разбирается или игрока нет
+    std::shared_ptr<Player> FindByToken(std::string_view token) const {
+        if (auto key = token_table::ParseToken(token)) {
+            return by_token_.Find(*key).value_or(nullptr);
+        }
+        return nullptr;
     }
 
-    static std::shared_ptr<Player> FindByDogIdAndMapId(const Dog::Id dog_id, const Map::Id& map_id) {
-        for (const auto& [token, player] : token_to_player_) {
-            if (player->GetDog()->GetId() == dog_id && player->map_id_ == map_id) {
-                return player;
-            }
+    std::shared_ptr<Player> FindByDogIdAndMapId(const Dog::Id dog_id, const Map::Id& map_id) const {
+        const DogShard& shard = GetDogShard(dog_id);
+        std::lock_guard lock{shard.mutex};
+        if (auto it = shard.players.find({dog_id, map_id}); it != shard.players.end()) {
+            return it->second;
         }
         return nullptr;
     }
 
-    static std::shared_ptr<Player> CreatePlayer(const std::string& name) {
-        Player::Token token = GenerateToken();
-        *token += std::string(32 - (*token).size(), '0');
-        token_to_player_[token] =  std::make_shared<Player>(name, token);
-        return token_to_player_[token];
-        // maybe change to one line return
+    // Создаёт игрока с новым токеном. Игрок попадает в обратный индекс в AddPlayer,
+    // когда у него появится карта
+    std::shared_ptr<Player> CreatePlayer(const std::string& name) const {
+        return std::make_shared<Player>(name, GenerateToken());
+    }
+
+    // Игроки с неразбираемыми или повторяющимися токенами не добавляются
+    bool AddPlayer(std::shared_ptr<Player> player) {
+        const auto key = token_table::ParseToken(*player->GetToken());
+        if (!key || !by_token_.Insert(*key, player)) {
+            return false;
+        }
+        DogShard& shard = GetDogShard(player->GetDog()->GetId());
+        std::lock_guard lock{shard.mutex};
+        shard.players[{player->GetDog()->GetId(), player->map_id_}] = std::move(player);
+        return true;
+    }
+
+    void ErasePlayer(const Player& player) {
+        if (const auto key = token_table::ParseToken(*player.GetToken())) {
+            by_token_.Erase(*key);
+        }
+        DogShard& shard = GetDogShard(player.GetDog()->GetId());
+        std::lock_guard lock{shard.mutex};
+        shard.players.erase({player.GetDog()->GetId(), player.map_id_});
     }
 
-    static void EraseByToken(const Player::Token& token) {
-        token_to_player_.erase(token);
+    size_t Size() const {
+        return by_token_.Size();
     }
 
+    // Формат архива прежний: отображение токена в игрока
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
-        ar& token_to_player_;
+        std::map<Player::Token, std::shared_ptr<Player>> token_to_player;
+        if constexpr (!Archive::is_loading::value) {
+            by_token_.ForEach([&token_to_player](token_table::TokenKey, const std::shared_ptr<Player>& player) {
+                token_to_player.emplace(player->GetToken(), player);
+            });
+        }
+        ar& token_to_player;
+        if constexpr (Archive::is_loading::value) {
+            Clear();
+            for (auto& [token, player] : token_to_player) {
+                AddPlayer(std::move(player));
+            }
+        }
     }
 
 private:
-    static Player::Token GenerateToken() {
+    struct DogKey {
+        Dog::Id dog_id;
+        Map::Id map_id;
+
+        bool operator==(const DogKey&) const = default;
+    };
+
+    struct DogKeyHasher {
+        size_t operator()(const DogKey& key) const {
+            return std::hash<std::uint64_t>{}(*key.dog_id) ^ (std::hash<std::string>{}(*key.map_id) << 1);
+        }
+    };
+
+    struct DogShard {
+        mutable std::mutex mutex;
+        std::unordered_map<DogKey, std::shared_ptr<Player>, DogKeyHasher> players;
+    };
+
+    void Clear() {
+        by_token_.Clear();
+        for (size_t i = 0; i < DOG_SHARD_COUNT; ++i) {
+            std::lock_guard lock{dog_shards_[i].mutex};
+            dog_shards_[i].players.clear();
+        }
+    }
+
+    DogShard& GetDogShard(const Dog::Id& dog_id) {
+        return dog_shards_[*dog_id % DOG_SHARD_COUNT];
+    }
+
+    const DogShard& GetDogShard(const Dog::Id& dog_id) const {
+        return dog_shards_[*dog_id % DOG_SHARD_COUNT];
+    }
+
+    Player::Token GenerateToken() const {
         static std::random_device random_device_;
         static std::mt19937_64 generator1_{[] {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
@@ -618,13 +856,19 @@ private:
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
             return dist(random_device_);
         }()};
-        std::ostringstream oss;
-        oss << std::hex << generator1_() << generator2_();
-        return Player::Token{oss.str()};
+        static std::mutex mutex;
+        std::lock_guard lock{mutex};
+        token_table::TokenKey key{generator1_(), generator2_()};
+        while (by_token_.Find(key)) {
+            key = {generator1_(), generator2_()};
+        }
+        return Player::Token{token_table::FormatToken(key)};
     }
 
-public:
-    static std::map<Player::Token, std::shared_ptr<Player>> token_to_player_;
+    constexpr static size_t DOG_SHARD_COUNT = 16;
+
+    token_table::TokenTable<std::shared_ptr<Player>> by_token_;
+    std::unique_ptr<DogShard[]> dog_shards_;
 };
 
 class Application {
@@ -659,39 +903,105 @@ public:
         return nullptr;
     }
 
+    Players& GetPlayers() noexcept {
+        return players_;
+    }
+
+    const Players& GetPlayers() const noexcept {
+        return players_;
+    }
+
     void JoinMap(const Map* map, std::shared_ptr<Player> player) {
         for (const auto& game_session : game_sessions_on_map_[map->GetId()]) {
             if (game_session->GetDogs().size() < MAX_DOGS_IN_SESSION) {
                 return JoinSession(game_session, player);
             }
         }
-        game_sessions_on_map_[map->GetId()].emplace_back(std::make_shared<GameSession>(map, game_dog_speed_, game_bag_capacity_, dog_retirement_time, db_url));
+        game_sessions_on_map_[map->GetId()].emplace_back(std::make_shared<GameSession>(map, game_dog_speed_, game_bag_capacity_, dog_retirement_time));
         JoinSession(game_sessions_on_map_[map->GetId()].back(), player);
     }
 
-    void Tick(int time_delta, loot_gen::LootGenerator& loot_generator) {
+    // Возвращает игроков, ушедших на пенсию в этом тике; их токены уже недействительны
+    std::vector<std::shared_ptr<Player>> Tick(int time_delta, loot_gen::LootGenerator& loot_generator) {
         static Application app;
         static sig::scoped_connection conn = app.DoOnTick([this, sum = 0ms](milliseconds delta) mutable {
             sum += delta;
             if (sum >= milliseconds(this->save_state_period)) {
-                //std::ofstream out(this->state_file);
-                std::ofstream out(this->state_file + "_temp.txt");
-                OutputArchive output_archive{out};
-                model::Players players;
-                output_archive << players;
-                output_archive << this;
-                std::filesystem::rename(this->state_file + "_temp.txt", this->state_file);
+                SaveState(*this, this->state_file);
                 sum -= milliseconds(this->save_state_period);
             }
         });
+        std::vector<GameSession*> sessions;
         for (auto& [map_id, game_sessions] : game_sessions_on_map_) {
             for (auto& game_session : game_sessions) {
-                game_session->Tick(time_delta, loot_generator);
+                sessions.push_back(game_session.get());
+            }
+        }
+        // Без профилировщика трасс нет, и секундомеры фаз ничего не делают
+        std::optional<tick_profiler::TickTrace> trace;
+        if (tick_profiler_) {
+            trace.emplace();
+            trace->tick.start = tick_profiler::Clock::now();
+            trace->sessions.resize(sessions.size());
+            for (size_t i = 0; i < sessions.size(); ++i) {
+                trace->sessions[i].session = sessions[i]->GetSerial();
+                trace->sessions[i].map = *sessions[i]->GetMapId();
+                trace->sessions[i].dogs = sessions[i]->GetDogs().size();
+            }
+        }
+        tick_profiler::Stopwatch stopwatch{trace ? &trace->game : nullptr};
+        std::vector<std::vector<std::shared_ptr<Dog>>> retired_dogs(sessions.size());
+        util::ParallelFor(sessions.size(), [&](size_t i) {
+            retired_dogs[i] = sessions[i]->Tick(time_delta, loot_generator, trace ? &trace->sessions[i] : nullptr);
+        }, task_poster_, tick_helpers_);
+        stopwatch.Lap(tick_profiler::Phase::SESSIONS);
+        std::vector<std::shared_ptr<Player>> retired_players;
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            for (const auto& dog : retired_dogs[i]) {
+                if (auto player = players_.FindByDogIdAndMapId(dog->GetId(), sessions[i]->GetMapId())) {
+                    players_.ErasePlayer(*player);
+                    retired_players.push_back(std::move(player));
+                }
+                retirement_sink::RetiredPlayer retired{dog->GetName(), dog->score, dog->time_playing, Dog::UUID::New().ToString()};
+                if (leaderboard_) {
+                    leaderboard_->Add({retired.id, retired.name, retired.score, retired.play_time_ms});
+                }
+                if (retirement_sink_) {
+                    retirement_sink_->Push(std::move(retired));
+                }
             }
         }
+        stopwatch.Lap(tick_profiler::Phase::RETIRE_PLAYERS);
         if (contains_state_file && contains_save_state_period) {
             app.Tick(std::chrono::duration_cast<milliseconds>(std::chrono::duration<double>{time_delta}));
         }
+        stopwatch.Lap(tick_profiler::Phase::SAVE_STATE);
+        if (trace) {
+            trace->tick.duration = tick_profiler::Clock::now() - trace->tick.start;
+            tick_profiler_->Record(std::move(*trace));
+        }
+        return retired_players;
+    }
+
+    // Позволяет тикать сессии параллельно на helpers дополнительных потоках
+    void SetTaskPoster(util::TaskPoster task_poster, unsigned helpers) {
+        task_poster_ = std::move(task_poster);
+        tick_helpers_ = helpers;
+    }
+
+    // Сюда попадают записи об ушедших на пенсию игроках
+    void SetRetirementSink(retirement_sink::RetirementSink* sink) {
+        retirement_sink_ = sink;
+    }
+
+    // Таблица рекордов в памяти, в которую сразу попадают ушедшие на пенсию игроки
+    void SetLeaderboard(leaderboard::Leaderboard* leaderboard) {
+        leaderboard_ = leaderboard;
+    }
+
+    // Профилировщик фаз тика; nullptr выключает замеры
+    void SetTickProfiler(tick_profiler::Profiler* profiler) {
+        tick_profiler_ = profiler;
     }
 
     template <typename Archive>
@@ -715,6 +1025,7 @@ private:
         game_session->AddDog(player->GetDog(), randomize_spawn_points);
         player->GetSession() = game_session;
         player->map_id_ = game_session->GetMapId();
+        players_.AddPlayer(std::move(player));
     }
 
     using MapIdHasher = util::TaggedHasher<Map::Id>;
@@ -722,6 +1033,12 @@ private:
 
     std::vector<Map> maps_;
     MapIdToIndex map_id_to_index_;
+    util::TaskPoster task_poster_;
+    unsigned tick_helpers_ = 0;
+    retirement_sink::RetirementSink* retirement_sink_ = nullptr;
+    Players players_;
+    leaderboard::Leaderboard* leaderboard_ = nullptr;
+    tick_profiler::Profiler* tick_profiler_ = nullptr;
 
 public:
     std::map<Map::Id, std::vector<std::shared_ptr<GameSession>>> game_sessions_on_map_;
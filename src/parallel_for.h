@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace util {
+
+// Ставит задачу в очередь пула потоков (например, io_context)
+using TaskPoster = std::function<void(std::function<void()>)>;
+
+/*
+ *  Выполняет fn(i) для всех i из [0, count), распределяя индексы между вызывающим
+ *  потоком и helpers вспомогательными задачами, поставленными через post.
+ *  Вызывающий поток сам забирает оставшиеся индексы, поэтому функция завершается,
+ *  даже если ни одна вспомогательная задача так и не начала выполняться.
+ *  Возвращает управление, когда выполнены все fn(i). Первое выброшенное fn исключение
+ *  пробрасывается вызывающему.
+ */
+template <typename Fn>
+void ParallelFor(size_t count, const Fn& fn, const TaskPoster& post, unsigned helpers) {
+    if (count == 0) {
+        return;
+    }
+    if (!post || helpers == 0 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // Общее состояние живёт, пока существует хотя бы одна опоздавшая задача
+    struct State {
+        explicit State(size_t count)
+            : count{count} {
+        }
+
+        const size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>(count);
+
+    // fn используется только после успешного захвата индекса, то есть до завершения ParallelFor
+    const auto work = [state, &fn] {
+        for (size_t i; (i = state->next.fetch_add(1)) < state->count;) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard lock{state->exception_mutex};
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+            if (state->done.fetch_add(1) + 1 == state->count) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    helpers = static_cast<unsigned>(std::min<size_t>(helpers, count - 1));
+    for (unsigned i = 0; i < helpers; ++i) {
+        post(work);
+    }
+    work();
+
+    for (size_t done = state->done.load(); done < count; done = state->done.load()) {
+        state->done.wait(done);
+    }
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+}  // namespace util
@@ -0,0 +1,267 @@
+#include "postgres.h"
+
+#include <stdexcept>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace postgres {
+
+using namespace std::literals;
+
+/*
+ *  Одно соединение с базой. Все методы вызываются внутри strand пула.
+ *  Сокет libpq оборачивается в stream_descriptor только для ожидания готовности,
+ *  закрывает его сама libpq.
+ */
+class ConnectionPool::Connection : public std::enable_shared_from_this<Connection> {
+public:
+    using ReadyHandler = std::function<void(std::exception_ptr error)>;
+
+    explicit Connection(Strand strand)
+        : strand_{strand}
+        , socket_{strand} {
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    ~Connection() {
+        Finish();
+    }
+
+    void Connect(const std::string& conninfo, ReadyHandler handler) {
+        Finish();
+        conn_ = PQconnectStart(conninfo.c_str());
+        if (!conn_ || PQstatus(conn_) == CONNECTION_BAD) {
+            return handler(MakeError("connection failed"sv));
+        }
+        PollConnect(PGRES_POLLING_WRITING, std::move(handler));
+    }
+
+    void Execute(Query& query, ReadyHandler handler) {
+        std::vector<const char*> values;
+        values.reserve(query.params.size());
+        for (const auto& param : query.params) {
+            values.push_back(param.c_str());
+        }
+        if (!PQsendQueryParams(conn_, query.sql.c_str(), static_cast<int>(values.size()), nullptr,
+                               values.data(), nullptr, nullptr, 0)) {
+            return handler(MakeError("query send failed"sv));
+        }
+        rows_.clear();
+        error_ = nullptr;
+        Flush(std::move(handler));
+    }
+
+    // Строки результата последнего выполненного запроса
+    Rows TakeRows() {
+        return std::move(rows_);
+    }
+
+    // Ошибка SQL, после которой соединение остаётся рабочим
+    std::exception_ptr TakeQueryError() {
+        return std::exchange(error_, nullptr);
+    }
+
+private:
+    void PollConnect(PostgresPollingStatusType status, ReadyHandler handler) {
+        if (status == PGRES_POLLING_OK) {
+            if (PQsetnonblocking(conn_, 1) != 0) {
+                return handler(MakeError("can't switch connection to nonblocking mode"sv));
+            }
+            return handler(nullptr);
+        }
+        if (status == PGRES_POLLING_FAILED) {
+            return handler(MakeError("connection failed"sv));
+        }
+        // Во время подключения libpq может сменить сокет
+        AssignSocket();
+        const auto wait_type = status == PGRES_POLLING_READING ? net::posix::descriptor_base::wait_read
+                                                               : net::posix::descriptor_base::wait_write;
+        socket_.async_wait(wait_type, [self = shared_from_this(), handler = std::move(handler)](sys::error_code ec) mutable {
+            if (ec) {
+                return handler(self->MakeError("connection interrupted"sv));
+            }
+            self->PollConnect(PQconnectPoll(self->conn_), std::move(handler));
+        });
+    }
+
+    void Flush(ReadyHandler handler) {
+        const int status = PQflush(conn_);
+        if (status < 0) {
+            return handler(MakeError("query send failed"sv));
+        }
+        if (status > 0) {
+            return socket_.async_wait(net::posix::descriptor_base::wait_write,
+                [self = shared_from_this(), handler = std::move(handler)](sys::error_code ec) mutable {
+                    if (ec) {
+                        return handler(self->MakeError("query interrupted"sv));
+                    }
+                    self->Flush(std::move(handler));
+                });
+        }
+        WaitResult(std::move(handler));
+    }
+
+    void WaitResult(ReadyHandler handler) {
+        socket_.async_wait(net::posix::descriptor_base::wait_read,
+            [self = shared_from_this(), handler = std::move(handler)](sys::error_code ec) mutable {
+                if (ec) {
+                    return handler(self->MakeError("query interrupted"sv));
+                }
+                self->ReadResult(std::move(handler));
+            });
+    }
+
+    void ReadResult(ReadyHandler handler) {
+        if (!PQconsumeInput(conn_)) {
+            return handler(MakeError("connection lost"sv));
+        }
+        while (!PQisBusy(conn_)) {
+            PGresult* result = PQgetResult(conn_);
+            if (!result) {
+                return handler(nullptr);
+            }
+            const ExecStatusType status = PQresultStatus(result);
+            if (status == PGRES_TUPLES_OK) {
+                const int fields = PQnfields(result);
+                for (int row = 0; row < PQntuples(result); ++row) {
+                    Row& values = rows_.emplace_back();
+                    values.reserve(fields);
+                    for (int field = 0; field < fields; ++field) {
+                        values.emplace_back(PQgetvalue(result, row, field), PQgetlength(result, row, field));
+                    }
+                }
+            } else if (status != PGRES_COMMAND_OK && !error_) {
+                error_ = std::make_exception_ptr(std::runtime_error(PQresultErrorMessage(result)));
+            }
+            PQclear(result);
+        }
+        WaitResult(std::move(handler));
+    }
+
+    void AssignSocket() {
+        const int fd = PQsocket(conn_);
+        if (socket_.is_open() && socket_.native_handle() == fd) {
+            return;
+        }
+        if (socket_.is_open()) {
+            socket_.release();
+        }
+        if (fd >= 0) {
+            socket_.assign(fd);
+        }
+    }
+
+    void Finish() {
+        if (socket_.is_open()) {
+            socket_.cancel();
+            socket_.release();
+        }
+        if (conn_) {
+            PQfinish(conn_);
+            conn_ = nullptr;
+        }
+    }
+
+    std::exception_ptr MakeError(std::string_view what) const {
+        std::string message{what};
+        if (conn_) {
+            message += ": "s + PQerrorMessage(conn_);
+        }
+        return std::make_exception_ptr(std::runtime_error(message));
+    }
+
+    Strand strand_;
+    net::posix::stream_descriptor socket_;
+    PGconn* conn_ = nullptr;
+    Rows rows_;
+    std::exception_ptr error_;
+};
+
+ConnectionPool::ConnectionPool(net::io_context& ioc, std::string conninfo, size_t size,
+                               std::chrono::milliseconds reconnect_delay)
+    : strand_{net::make_strand(ioc)}
+    , conninfo_{std::move(conninfo)}
+    , size_{std::max<size_t>(1, size)}
+    , reconnect_delay_{reconnect_delay} {
+}
+
+void ConnectionPool::Start() {
+    net::dispatch(strand_, [self = shared_from_this()] {
+        for (size_t i = 0; i < self->size_; ++i) {
+            self->Connect(std::make_shared<Connection>(self->strand_));
+        }
+    });
+}
+
+void ConnectionPool::AsyncQuery(std::string sql, std::vector<std::string> params, QueryHandler handler) {
+    net::dispatch(strand_, [self = shared_from_this(), query = Query{std::move(sql), std::move(params), std::move(handler)}]() mutable {
+        if (self->alive_ == 0 && self->connecting_ == 0) {
+            return query.handler(std::make_exception_ptr(std::runtime_error("no database connection")), {});
+        }
+        self->pending_.push_back(std::move(query));
+        if (!self->idle_.empty()) {
+            auto connection = std::move(self->idle_.back());
+            self->idle_.pop_back();
+            self->OnConnectionReady(std::move(connection));
+        }
+    });
+}
+
+void ConnectionPool::Connect(std::shared_ptr<Connection> connection) {
+    ++connecting_;
+    connection->Connect(conninfo_, [self = shared_from_this(), connection](std::exception_ptr error) {
+        --self->connecting_;
+        if (error) {
+            return self->OnConnectionLost(connection, false);
+        }
+        ++self->alive_;
+        self->OnConnectionReady(connection);
+    });
+}
+
+void ConnectionPool::OnConnectionReady(std::shared_ptr<Connection> connection) {
+    if (pending_.empty()) {
+        idle_.push_back(std::move(connection));
+        return;
+    }
+    auto query = std::make_shared<Query>(std::move(pending_.front()));
+    pending_.pop_front();
+    connection->Execute(*query, [self = shared_from_this(), connection, query](std::exception_ptr error) {
+        if (error) {
+            // Соединение сломано: запрос завершается ошибкой, соединение переподключается
+            query->handler(error, {});
+            return self->OnConnectionLost(connection, true);
+        }
+        if (auto query_error = connection->TakeQueryError()) {
+            query->handler(query_error, {});
+        } else {
+            query->handler(nullptr, connection->TakeRows());
+        }
+        self->OnConnectionReady(connection);
+    });
+}
+
+void ConnectionPool::OnConnectionLost(std::shared_ptr<Connection> connection, bool was_alive) {
+    if (was_alive) {
+        --alive_;
+    }
+    if (alive_ == 0 && connecting_ == 0) {
+        // Ни одного живого соединения: не держим запросы до переподключения
+        auto error = std::make_exception_ptr(std::runtime_error("no database connection"));
+        for (auto& query : std::exchange(pending_, {})) {
+            query.handler(error, {});
+        }
+    }
+    auto timer = std::make_shared<net::steady_timer>(strand_, reconnect_delay_);
+    timer->async_wait([self = shared_from_this(), connection, timer](sys::error_code ec) {
+        if (!ec) {
+            self->Connect(connection);
+        }
+    });
+}
+
+}  // namespace postgres
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/strand.hpp>
+#include <libpq-fe.h>
+
+namespace postgres {
+
+namespace net = boost::asio;
+namespace sys = boost::system;
+
+// Значения полей строки результата в текстовом формате
+using Row = std::vector<std::string>;
+using Rows = std::vector<Row>;
+
+// error пуст, если запрос выполнен успешно
+using QueryHandler = std::function<void(std::exception_ptr error, Rows rows)>;
+
+/*
+ *  Пул постоянных соединений с Postgres, работающих через асинхронный API libpq.
+ *  Сокеты соединений ожидаются средствами io_context, поэтому поток не блокируется
+ *  на время сетевого обмена с базой. Запросы, пришедшие, когда все соединения заняты,
+ *  ждут в очереди. Оборвавшееся соединение переподключается через reconnect_delay.
+ *  Все обработчики вызываются внутри strand пула.
+ *  Пул создаётся через std::make_shared, после чего нужно вызвать Start.
+ */
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool> {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+
+    ConnectionPool(net::io_context& ioc, std::string conninfo, size_t size,
+                   std::chrono::milliseconds reconnect_delay = std::chrono::seconds{1});
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Начинает подключение всех соединений пула
+    void Start();
+
+    // Выполняет запрос с параметрами $1, $2, ..., переданными в текстовом виде
+    void AsyncQuery(std::string sql, std::vector<std::string> params, QueryHandler handler);
+
+private:
+    class Connection;
+
+    struct Query {
+        std::string sql;
+        std::vector<std::string> params;
+        QueryHandler handler;
+    };
+
+    void Connect(std::shared_ptr<Connection> connection);
+    void OnConnectionReady(std::shared_ptr<Connection> connection);
+    void OnConnectionLost(std::shared_ptr<Connection> connection, bool was_alive);
+
+    Strand strand_;
+    std::string conninfo_;
+    size_t size_;
+    std::chrono::milliseconds reconnect_delay_;
+    std::vector<std::shared_ptr<Connection>> idle_;
+    std::deque<Query> pending_;
+    // число подключённых соединений, свободных и занятых
+    size_t alive_ = 0;
+    size_t connecting_ = 0;
+};
+
+}  // namespace postgres
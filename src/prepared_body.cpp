@@ -0,0 +1,252 @@
+#include "prepared_body.h"
+
+#include <zlib.h>
+
+#include <cctype>
+#include <optional>
+#include <stdexcept>
+
+namespace prepared_body {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr int GZIP_WINDOW_BITS = 15 + 16;
+constexpr int ZLIB_WINDOW_BITS = 15;
+constexpr int RAW_WINDOW_BITS = -15;
+constexpr int MEMORY_LEVEL = 8;
+
+// FNV-1a: ETag должен быть одинаковым от запуска к запуску
+std::string MakeETag(std::string_view data, std::string_view suffix) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    constexpr std::string_view DIGITS = "0123456789abcdef";
+    std::string etag = "\""s;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        etag += DIGITS[(hash >> shift) & 0xF];
+    }
+    etag += suffix;
+    etag += '"';
+    return etag;
+}
+
+std::string_view Trim(std::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+bool EqualsIgnoreCase(std::string_view l, std::string_view r) {
+    if (l.size() != r.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < l.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(l[i])) != std::tolower(static_cast<unsigned char>(r[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Вызывает fn для каждого элемента списка через запятую
+template <typename Fn>
+void ForEachListItem(std::string_view list, Fn&& fn) {
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        fn(Trim(list.substr(0, comma)));
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+}
+
+// Делит элемент списка вида "gzip;q=0.5" на значение и его q; без q оно равно 1
+std::pair<std::string_view, double> SplitQuality(std::string_view item) {
+    size_t semicolon = item.find(';');
+    const std::string_view name = Trim(item.substr(0, semicolon));
+    double q = 1.0;
+    while (semicolon != std::string_view::npos) {
+        item.remove_prefix(semicolon + 1);
+        semicolon = item.find(';');
+        const std::string_view param = Trim(item.substr(0, semicolon));
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            try {
+                q = std::stod(std::string{param.substr(2)});
+            } catch (...) {
+                q = 0.0;
+            }
+        }
+    }
+    return {name, q};
+}
+
+std::string Deflate(std::string_view data, int window_bits) {
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, window_bits, MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib");
+    }
+    std::string result(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+    const int status = deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        throw std::runtime_error("Failed to compress");
+    }
+    return result;
+}
+
+void AppendUint32(std::string& out, std::uint32_t value, bool big_endian) {
+    for (int i = 0; i < 4; ++i) {
+        const int shift = big_endian ? (3 - i) * 8 : i * 8;
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+// gzip и zlib - одни и те же сжатые данные в разных обёртках, поэтому данные сжимаются
+// один раз, а обёртки дописываются вокруг них
+std::string WrapGzip(std::string_view raw, std::string_view data) {
+    // Заголовок без имени файла и времени; 2 - максимальное сжатие, 3 - Unix
+    constexpr std::string_view HEADER{"\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03", 10};
+    std::string result;
+    result.reserve(HEADER.size() + raw.size() + 8);
+    result.append(HEADER).append(raw);
+    AppendUint32(result, static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()))), false);
+    AppendUint32(result, static_cast<std::uint32_t>(data.size()), false);
+    return result;
+}
+
+std::string WrapZlib(std::string_view raw, std::string_view data) {
+    // Окно 32 КБ и максимальное сжатие, как у deflateInit2 с ZLIB_WINDOW_BITS
+    constexpr std::string_view HEADER{"\x78\xda", 2};
+    std::string result;
+    result.reserve(HEADER.size() + raw.size() + 4);
+    result.append(HEADER).append(raw);
+    AppendUint32(result, static_cast<std::uint32_t>(adler32(1, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()))), true);
+    return result;
+}
+
+}  // namespace
+
+PreparedBody::PreparedBody(std::string content, bool compress)
+    : identity_{std::move(content)}
+    , etag_{MakeETag(identity_, ""sv)} {
+    if (!compress) {
+        return;
+    }
+    const std::string raw = Deflate(identity_, RAW_WINDOW_BITS);
+    gzip_ = WrapGzip(raw, identity_);
+    if (gzip_.size() >= identity_.size()) {
+        gzip_ = {};
+        return;
+    }
+    deflate_ = WrapZlib(raw, identity_);
+    gzip_etag_ = MakeETag(identity_, "-gzip"sv);
+    deflate_etag_ = MakeETag(identity_, "-deflate"sv);
+    compressed_ = true;
+}
+
+const std::string& PreparedBody::Get(Encoding encoding) const noexcept {
+    if (!HasEncoding(encoding)) {
+        return identity_;
+    }
+    switch (encoding) {
+        case Encoding::GZIP:
+            return gzip_;
+        case Encoding::DEFLATE:
+            return deflate_;
+        default:
+            return identity_;
+    }
+}
+
+const std::string& PreparedBody::GetETag(Encoding encoding) const noexcept {
+    if (!HasEncoding(encoding)) {
+        return etag_;
+    }
+    switch (encoding) {
+        case Encoding::GZIP:
+            return gzip_etag_;
+        case Encoding::DEFLATE:
+            return deflate_etag_;
+        default:
+            return etag_;
+    }
+}
+
+// В HTTP "deflate" означает поток в формате zlib
+std::string Compress(std::string_view data, Encoding encoding) {
+    if (encoding == Encoding::IDENTITY) {
+        return std::string{data};
+    }
+    return Deflate(data, encoding == Encoding::GZIP ? GZIP_WINDOW_BITS : ZLIB_WINDOW_BITS);
+}
+
+Encoding ChooseEncoding(std::string_view accept_encoding) {
+    std::optional<double> gzip_q;
+    std::optional<double> deflate_q;
+    std::optional<double> any_q;
+    ForEachListItem(accept_encoding, [&](std::string_view item) {
+        const auto [coding, q] = SplitQuality(item);
+        if (EqualsIgnoreCase(coding, "gzip"sv) || EqualsIgnoreCase(coding, "x-gzip"sv)) {
+            gzip_q = q;
+        } else if (EqualsIgnoreCase(coding, "deflate"sv)) {
+            deflate_q = q;
+        } else if (coding == "*"sv) {
+            any_q = q;
+        }
+    });
+    // Явно названное кодирование важнее "*"
+    const double gzip = gzip_q.value_or(any_q.value_or(0.0));
+    const double deflate = deflate_q.value_or(any_q.value_or(0.0));
+    if (gzip > 0.0 && gzip >= deflate) {
+        return Encoding::GZIP;
+    }
+    if (deflate > 0.0) {
+        return Encoding::DEFLATE;
+    }
+    return Encoding::IDENTITY;
+}
+
+std::optional<double> FindQuality(std::string_view list, std::string_view value) {
+    std::optional<double> result;
+    ForEachListItem(list, [&](std::string_view item) {
+        const auto [name, q] = SplitQuality(item);
+        if (EqualsIgnoreCase(name, value)) {
+            result = q;
+        }
+    });
+    return result;
+}
+
+std::string_view EncodingName(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::GZIP:
+            return "gzip"sv;
+        case Encoding::DEFLATE:
+            return "deflate"sv;
+        default:
+            return "identity"sv;
+    }
+}
+
+bool MatchesETag(std::string_view if_none_match, std::string_view etag) {
+    bool matches = false;
+    ForEachListItem(if_none_match, [&](std::string_view item) {
+        if (item.starts_with("W/"sv)) {
+            item.remove_prefix(2);
+        }
+        matches = matches || item == "*"sv || item == etag;
+    });
+    return matches;
+}
+
+}  // namespace prepared_body
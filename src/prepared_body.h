@@ -0,0 +1,104 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace prepared_body {
+
+enum class Encoding {
+    IDENTITY,
+    GZIP,
+    DEFLATE
+};
+
+/*
+ *  Неизменяемое тело ответа, подготовленное один раз: исходные байты, их gzip- и
+ *  deflate-варианты и сильные ETag для каждого варианта.
+ *  Сжатые варианты хранятся, только если сжатие уменьшило размер.
+ *  Ответы ссылаются на эти байты через shared_ptr и ничего не копируют.
+ */
+class PreparedBody {
+public:
+    // compress = false для заведомо сжатых данных, например картинок
+    explicit PreparedBody(std::string content, bool compress = true);
+
+    // Для отсутствующего варианта возвращает исходные байты
+    const std::string& Get(Encoding encoding) const noexcept;
+    const std::string& GetETag(Encoding encoding) const noexcept;
+
+    bool HasEncoding(Encoding encoding) const noexcept {
+        return encoding == Encoding::IDENTITY || compressed_;
+    }
+
+private:
+    std::string identity_;
+    std::string gzip_;
+    std::string deflate_;
+    std::string etag_;
+    std::string gzip_etag_;
+    std::string deflate_etag_;
+    bool compressed_ = false;
+};
+
+std::string Compress(std::string_view data, Encoding encoding);
+
+// Выбирает кодирование по Accept-Encoding с учётом q-значений; gzip предпочтительнее deflate
+Encoding ChooseEncoding(std::string_view accept_encoding);
+
+// q-значение value в списке вида Accept или Accept-Encoding; nullopt, если value там нет
+std::optional<double> FindQuality(std::string_view list, std::string_view value);
+
+std::string_view EncodingName(Encoding encoding);
+
+// Слабое сравнение ETag из If-None-Match, включая списки и "*"
+bool MatchesETag(std::string_view if_none_match, std::string_view etag);
+
+// Тело Beast, которое пишет в сокет разделяемую строку без копирования
+struct SharedBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const boost::beast::http::header<isRequest, Fields>&, const value_type& body)
+            : body_{body} {
+        }
+
+        void init(boost::beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec) {
+            ec = {};
+            if (!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return {{boost::asio::const_buffer{body_->data(), body_->size()}, false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+// Ссылка на один вариант подготовленного тела, продлевающая жизнь всему телу
+inline SharedBody::value_type Share(const std::shared_ptr<const PreparedBody>& body, Encoding encoding) {
+    return {body, &body->Get(encoding)};
+}
+
+}  // namespace prepared_body
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace request_arena {
+
+/*
+ *  Память одного HTTP-запроса: заголовки и тело запроса выделяются подряд из буфера
+ *  соединения и освобождаются разом, когда соединение читает следующий запрос.
+ *  Что не поместилось в буфер, берётся из кучи блоками и тоже освобождается разом.
+ */
+class Arena {
+public:
+    constexpr static std::size_t BUFFER_SIZE = 8 << 10;
+
+    // upstream - откуда брать память, когда буфер закончился
+    explicit Arena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : resource_{buffer_.data(), buffer_.size(), upstream} {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(std::size_t bytes, std::size_t alignment) {
+        return resource_.allocate(bytes, alignment);
+    }
+
+    // Вызывается, только когда ни один запрос больше не ссылается на арену
+    void Reset() noexcept {
+        resource_.release();
+    }
+
+private:
+    alignas(std::max_align_t) std::array<std::byte, BUFFER_SIZE> buffer_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+/*
+ *  Аллокатор для полей и тела запроса. Держит арену через shared_ptr, поэтому запрос,
+ *  переданный в другой поток или в асинхронный обработчик, не теряет свою память.
+ *  Аллокатор без арены работает как std::allocator.
+ */
+template <typename T>
+class Allocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    Allocator() noexcept = default;
+
+    explicit Allocator(std::shared_ptr<Arena> arena) noexcept
+        : arena_{std::move(arena)} {
+    }
+
+    // Перемещение не должно менять исходный аллокатор, поэтому оно копирует
+    Allocator(const Allocator&) noexcept = default;
+    Allocator& operator=(const Allocator&) noexcept = default;
+
+    template <typename U>
+    Allocator(const Allocator<U>& other) noexcept
+        : arena_{other.GetArena()} {
+    }
+
+    T* allocate(std::size_t n) {
+        if (arena_) {
+            return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+        }
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        // Память арены освобождается только целиком
+        if (!arena_) {
+            std::allocator<T>{}.deallocate(p, n);
+        }
+    }
+
+    const std::shared_ptr<Arena>& GetArena() const noexcept {
+        return arena_;
+    }
+
+    template <typename U>
+    bool operator==(const Allocator<U>& other) const noexcept {
+        return arena_ == other.GetArena();
+    }
+
+private:
+    std::shared_ptr<Arena> arena_;
+};
+
+// Арена соединения: переиспользуется, если прошлый запрос уже отпустил её, иначе заменяется новой
+inline void Recycle(std::shared_ptr<Arena>& arena) {
+    if (arena && arena.use_count() == 1) {
+        arena->Reset();
+    } else {
+        arena = std::make_shared<Arena>();
+    }
+}
+
+}  // namespace request_arena
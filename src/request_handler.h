@@ -1,7 +1,9 @@
 #pragma once
 
+#include <charconv>
 #include <filesystem>
 #include <iostream>
+#include <map>
 #include <variant>
 #include <optional>
 #include <string>
@@ -12,7 +14,17 @@
 #include "http_server.h"
 #include "model.h"
 #include "json_encoder.h"
+#include "binary_encoder.h"
 #include "loot_generator.h"
+#include "postgres.h"
+#include "leaderboard.h"
+#include "prepared_body.h"
+#include "stream_hub.h"
+#include "static_cache.h"
+#include "api_router.h"
+#include "admission.h"
+#include "metrics.h"
+#include "tick_profiler.h"
 
 namespace http_handler {
 namespace net = boost::asio;
@@ -22,9 +34,10 @@ namespace fs = std::filesystem;
 namespace json = boost::json;
 using namespace std::literals;
 
-using StringRequest = http::request<http::string_body>;
+using StringRequest = http_server::Request;
 using StringResponse = http::response<http::string_body>;
-using FileResponse = http::response<http::file_body>;
+using FileResponse = http::response<sendfile_body::SendfileBody>;
+using PreparedResponse = http::response<prepared_body::SharedBody>;
 
 struct ContentType {
     ContentType() = delete;
@@ -43,6 +56,9 @@ struct ContentType {
     constexpr static std::string_view SVG_XML = "image/svg+xml"sv;
     constexpr static std::string_view MP3 = "audio/mpeg"sv;
     constexpr static std::string_view OCTET_STREAM = "application/octet-stream"sv;
+    // Двоичное состояние сессии, формат описан в binary_encoder.h
+    constexpr static std::string_view STATE_BINARY = "application/vnd.dogstory.state"sv;
+    constexpr static std::string_view METRICS = "text/plain; version=0.0.4"sv;
 };
 
 struct ApiPath {
@@ -54,8 +70,35 @@ struct ApiPath {
     constexpr static std::string_view ACTION = "/api/v1/game/player/action"sv;
     constexpr static std::string_view TICK = "/api/v1/game/tick"sv;
     constexpr static std::string_view RECORDS = "/api/v1/game/records"sv;
+    constexpr static std::string_view RECORDS_RANK = "/api/v1/game/records/rank"sv;
+    constexpr static std::string_view STREAM = "/api/v1/game/stream"sv;
 };
 
+enum class ApiEndpoint {
+    MAPS,
+    JOIN,
+    PLAYERS,
+    STATE,
+    ACTION,
+    TICK,
+    RECORDS,
+    RECORDS_RANK,
+    STREAM
+};
+
+// Маршруты API и допустимые методы; ответ 405 и заголовок Allow строятся по этой таблице
+inline constexpr api_router::Router API_ROUTER{std::array{
+    api_router::Route<ApiEndpoint>{ApiPath::MAPS, ApiEndpoint::MAPS, "GET, HEAD"sv, true},
+    api_router::Route<ApiEndpoint>{ApiPath::JOIN, ApiEndpoint::JOIN, "POST"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::PLAYERS, ApiEndpoint::PLAYERS, "GET, HEAD"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::STATE, ApiEndpoint::STATE, "GET, HEAD"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::ACTION, ApiEndpoint::ACTION, "POST"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::TICK, ApiEndpoint::TICK, "POST"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::RECORDS, ApiEndpoint::RECORDS, "GET, HEAD"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::RECORDS_RANK, ApiEndpoint::RECORDS_RANK, "GET, HEAD"sv},
+    api_router::Route<ApiEndpoint>{ApiPath::STREAM, ApiEndpoint::STREAM, "GET"sv}
+}};
+
 struct Response {
     Response() = delete;
     constexpr static std::string_view INVALID_CONTENT_TYPE = R"({"code": "invalidArgument", "message": "Invalid content type"})"sv;
@@ -68,6 +111,19 @@ struct Response {
     constexpr static std::string_view PLAYER_TOKEN_NOT_FOUND = R"({"code": "unknownToken", "message": "Player token has not been found"})"sv;
     constexpr static std::string_view MAP_NOT_FOUND = R"({"code": "mapNotFound", "message": "Map not found"})"sv;
     constexpr static std::string_view INVALID_METHOD = R"({"code": "invalidMethod", "message": "Invalid method"})"sv;
+    constexpr static std::string_view RECORD_NOT_FOUND = R"({"code": "recordNotFound", "message": "Player has no records"})"sv;
+    constexpr static std::string_view INVALID_SINCE = R"({"code": "invalidArgument", "message": "Invalid since parameter"})"sv;
+    constexpr static std::string_view RECORDS_NOT_LOADED = R"({"code": "recordsNotLoaded", "message": "Records are not loaded yet"})"sv;
+    constexpr static std::string_view SERVER_OVERLOADED = R"({"code": "serverOverloaded", "message": "Server is overloaded, retry later"})"sv;
+    constexpr static std::string_view TOO_MANY_REQUESTS = R"({"code": "tooManyRequests", "message": "Too many requests for this token"})"sv;
+    // Причина закрытия WebSocket: не JSON, потому что кадр закрытия вмещает не больше 123 байт
+    constexpr static std::string_view PLAYER_RETIRED = "playerRetired"sv;
+};
+
+// Защита api_strand от перегрузки: отбрасывание запросов и ограничение частоты по токену
+struct OverloadOptions {
+    admission::AdmissionControl::Options admission;
+    admission::RateLimiter::Options rate_limit;
 };
 
 std::string UrlDecode(std::string_view url);
@@ -93,280 +149,608 @@ class RequestHandler {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
 
-    explicit RequestHandler(model::Game& game, fs::path base_path, Strand api_strand, bool is_ticking, loot_gen::LootGenerator& loot_generator, std::string db_url)
+    explicit RequestHandler(model::Game& game, fs::path base_path, Strand api_strand, bool is_ticking, loot_gen::LootGenerator& loot_generator, std::shared_ptr<postgres::ConnectionPool> db_pool, const leaderboard::Leaderboard& leaderboard, metrics::Registry& metrics, std::string metrics_path = "/metrics"s, const OverloadOptions& overload = {})
         : game_{game}
         , base_path_{fs::weakly_canonical(base_path)} 
         , api_strand_{api_strand}
         , is_ticking_{is_ticking}
         , loot_generator_{loot_generator}
-        , db_url_{db_url} {
+        , db_pool_{std::move(db_pool)}
+        , leaderboard_{leaderboard}
+        , maps_catalog_{std::make_shared<const prepared_body::PreparedBody>(json_encoder::GameToString(game))}
+        , map_bodies_{PrepareMaps(game)}
+        , static_files_{base_path_, [](const fs::path& path) {
+            return GetContentType(path.extension().string());
+        }}
+        , admission_{api_queue_, overload.admission}
+        , rate_limiter_{overload.rate_limit}
+        , metrics_{metrics}
+        , metrics_path_{std::move(metrics_path)}
+        , request_durations_{"route"s, MakeRouteLabels()} {
     }
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
 
-    template <typename Body, typename Allocator, typename Send>
-    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        if (req.target().rfind("/api/"sv, 0) == 0) {
-            return net::dispatch(api_strand_,
-                    [this, send, req = std::forward<decltype(req)>(req)] {
-                        try {
-                            return send(this->HandleApiRequest(req));
-                        } catch(...) {
-                            return send(this->ReportServerError(req));
-                        }
-                    });
+    // Время обработки каждого запроса попадает в гистограмму его маршрута и кода ответа
+    template <typename Send>
+    void operator()(StringRequest&& req, Send&& send) {
+        const std::string_view target{req.target().data(), req.target().size()};
+        const auto [path, query] = api_router::SplitTarget(target);
+        if (path == metrics_path_) {
+            return send(HandleMetricsRequest(req));
         }
-        return std::visit(
-                [&send](auto&& result) {
-                    send(std::forward<decltype(result)>(result));
-                },
-                HandleFileRequest(req));
+        if (path == TICK_PROFILE_PATH) {
+            return send(HandleTickProfileRequest(req, query));
+        }
+        const bool is_api = target.starts_with("/api/"sv);
+        const auto match = is_api ? API_ROUTER.Find(target) : std::nullopt;
+        const size_t route = !is_api ? STATIC_ROUTE : match ? static_cast<size_t>(match->route->endpoint) : UNKNOWN_ROUTE;
+        HandleRequest(std::move(req), match,
+                [this, route, started = metrics::Clock::now(), send = std::forward<Send>(send)](auto&& response) {
+                    request_durations_.Record(route, response.result_int(), metrics::Clock::now() - started);
+                    send(std::forward<decltype(response)>(response));
+                });
     }
 
-private:
-    using FileRequestResult = std::variant<FileResponse, StringResponse>;
-
-    StringResponse HandleApiRequest(const StringRequest& req) {
-        const auto json_response = [&req](http::status status, std::string_view text) {
-            return MakeResponse<StringResponse>(status, text, req.version(), req.keep_alive(), ContentType::JSON);
+    // Запрос на WebSocket /api/v1/game/stream?token=<токен>. Браузер не может передать
+    // заголовок Authorization при открытии WebSocket, поэтому токен можно передать в запросе.
+    // После рукопожатия клиент получает состояние своей сессии после каждого тика
+    // и может присылать в то же соединение действия вида {"move": "L"}
+    void HandleUpgrade(beast::tcp_stream&& stream, StringRequest&& req) {
+        const auto [target, query] = api_router::SplitTarget({req.target().data(), req.target().size()});
+        const auto reject = [&stream, &req](http::status status, std::string_view text) {
+            std::make_shared<http_server::StreamSession>(std::move(stream))->Reject(MakeApiResponse(req, status, text));
         };
-        const auto api_response = [&json_response, &req](http::status status, std::string_view text) {
-            auto res = json_response(status, text);
-            res.set(http::field::cache_control, "no-cache");
-            return res;
-        };
-        const auto try_extract_token = [](const StringRequest& req) -> std::optional<std::string> {
-            try {
-                std::string authorization_token = std::string(req["Authorization"]).substr(7);
-                if (req["Authorization"].substr(0, 6) != "Bearer"sv || req["Authorization"].size() != "Bearer "s.size() + 32) {
-                    return std::nullopt;
+        if (target != ApiPath::STREAM) {
+            return reject(http::status::bad_request, Response::BAD_REQUEST);
+        }
+        auto token = api_router::QueryParams{query}.Find("token"sv);
+        if (!token) {
+            token = TryExtractToken(req);
+        }
+        if (!token) {
+            return reject(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
+        }
+        const auto player = TryGetPlayerByToken(*token);
+        if (!player) {
+            return reject(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
+        }
+        const auto game_session = (*player)->GetSession();
+        auto stream_session = std::make_shared<http_server::StreamSession>(std::move(stream),
+                [this, token = std::string{*token}](std::string_view message) {
+                    HandleStreamMessage(token, message);
+                });
+        stream_hub_.Subscribe(game_session.get(), std::string{*token}, stream_session);
+        // Первый кадр не ждёт тика
+        stream_session->Push(EncodeState(*game_session->GetSnapshot()));
+        stream_session->Run(std::move(req));
+    }
+
+    // Сводка и трасса фаз тика отдаются, только если профилировщик задан
+    void SetTickProfiler(const tick_profiler::Profiler* profiler) {
+        tick_profiler_ = profiler;
+    }
+
+    // Тик игры в api_strand: по таймеру или по запросу /api/v1/game/tick
+    void Tick(std::chrono::milliseconds delta) {
+        const auto started = metrics::Clock::now();
+        const auto retired_players = game_.Tick(static_cast<int>(delta.count()), loot_generator_);
+        metrics_.tick_duration.Record(metrics::Clock::now() - started);
+        UpdateGameMetrics();
+        // Действия ушедших на пенсию игроков больше не принимаются, поэтому их потоки закрываются
+        for (const auto& player : retired_players) {
+            stream_hub_.Close(player->GetSession().get(), *player->GetToken(), Response::PLAYER_RETIRED);
+        }
+        PublishStreams();
+    }
+
+    // Рассылает подписчикам состояние их сессий. Вызывается в api_strand после тика;
+    // кодирование и отправка идут вне api_strand
+    void PublishStreams() {
+        for (const auto& [map_id, game_sessions] : game_.game_sessions_on_map_) {
+            for (const auto& game_session : game_sessions) {
+                if (stream_hub_.CountSubscribers(game_session.get()) == 0) {
+                    continue;
                 }
-                return authorization_token;
-            } catch(...) {
-                return std::nullopt;
-            }
-        };
-        const auto try_get_player_by_token = [](const std::string& token) -> std::optional<std::shared_ptr<model::Player>> {
-            if (model::Players::ContainsToken(model::Player::Token{token})) {
-                return model::Players::FindByToken(model::Player::Token{token});
-            }
-            return std::nullopt;
-        };
-        const auto assert_content_type_is_json = [](const StringRequest& req) {
-            try {
-                return req["Content-Type"] == ContentType::JSON;
-            } catch(...) {
-                return false;
+                net::post(api_strand_.get_inner_executor(), [this, topic = game_session.get(), snapshot = game_session->GetSnapshot()] {
+                    stream_hub_.Publish(topic, [&snapshot] {
+                        return EncodeState(*snapshot);
+                    });
+                });
             }
+        }
+    }
+
+private:
+    using FileRequestResult = std::variant<FileResponse, StringResponse, PreparedResponse>;
+    using SharedRequestResult = std::variant<PreparedResponse, StringResponse>;
+    using PreparedMaps = std::map<std::string, std::shared_ptr<const prepared_body::PreparedBody>, std::less<>>;
+
+    // Строки гистограммы запросов: конечные точки API по порядку ApiEndpoint, затем статика и неизвестные пути
+    constexpr static size_t STATIC_ROUTE = static_cast<size_t>(ApiEndpoint::STREAM) + 1;
+    constexpr static size_t UNKNOWN_ROUTE = STATIC_ROUTE + 1;
+
+    static std::vector<std::string> MakeRouteLabels() {
+        std::vector<std::string> labels(UNKNOWN_ROUTE + 1);
+        for (const auto& route : API_ROUTER.Routes()) {
+            labels[static_cast<size_t>(route.endpoint)] = route.path;
+        }
+        labels[STATIC_ROUTE] = "static"s;
+        labels[UNKNOWN_ROUTE] = "unknown"s;
+        return labels;
+    }
+
+    template <typename Send>
+    void HandleRequest(StringRequest&& req, const std::optional<api_router::Match<ApiEndpoint>>& match, Send&& send) {
+        const auto send_result = [&send](auto&& result) {
+            std::visit(
+                    [&send](auto&& response) {
+                        send(std::forward<decltype(response)>(response));
+                    },
+                    std::forward<decltype(result)>(result));
         };
-        std::string target = std::string(req.target());
-        if (target.back() == '/') {
-            target.pop_back();
+        const std::string_view target{req.target().data(), req.target().size()};
+        if (!target.starts_with("/api/"sv)) {
+            return send_result(HandleFileRequest(req));
         }
-        if (target == ApiPath::MAPS) {
-            if (req.method_string() == "GET"sv || req.method_string() == "HEAD"sv) {
-                return api_response(http::status::ok, json_encoder::GameToString(game_));
-            }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "GET, HEAD");
-            return res;
+        if (!match || (match->route->endpoint == ApiEndpoint::TICK && is_ticking_)) {
+            return send(MakeApiResponse(req, http::status::bad_request, Response::BAD_REQUEST));
         }
-        if (target.rfind(ApiPath::MAPS, 0) == 0) {
-            if (req.method_string() == "GET"sv || req.method_string() == "HEAD"sv) {
-                std::string id = std::string(target).substr(ApiPath::MAPS.size() + "/"s.size());
-                const model::Map* map = game_.FindMap(model::Map::Id(id));
-                if (!map) {
-                    return api_response(http::status::not_found, Response::MAP_NOT_FOUND);
-                }
-                return api_response(http::status::ok, json_encoder::MapToString(*map));
-            }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "GET, HEAD");
-            return res;
+        if (!match->Allows({req.method_string().data(), req.method_string().size()})) {
+            auto res = MakeApiResponse(req, http::status::method_not_allowed, Response::INVALID_METHOD);
+            res.set(http::field::allow, match->route->allow);
+            return send(std::move(res));
         }
-        if (target == ApiPath::JOIN) {
-            if (req.method_string() == "POST"sv) {
-                if (!assert_content_type_is_json(req)) {
-                    return api_response(http::status::bad_request, Response::INVALID_CONTENT_TYPE);
-                }
+        // Лишние запросы отбрасываются до того, как встанут в очередь api_strand
+        if (!admission_.Admit(GetPriority(match->route->endpoint))) {
+            return send(MakeRetryResponse(req, http::status::service_unavailable, Response::SERVER_OVERLOADED));
+        }
+        if (const auto token = TryExtractToken(req); token && !rate_limiter_.TryAcquire(*token)) {
+            return send(MakeRetryResponse(req, http::status::too_many_requests, Response::TOO_MANY_REQUESTS));
+        }
+        switch (match->route->endpoint) {
+            case ApiEndpoint::RECORDS:
+            case ApiEndpoint::RECORDS_RANK:
+                // Рекорды отдаются из памяти или из базы асинхронно и не занимают api_strand
+                return HandleRecordsRequest(std::move(req), *match, std::forward<Send>(send));
+            case ApiEndpoint::MAPS:
+                return send_result(HandleMapsRequest(req, match->parameter));
+            case ApiEndpoint::PLAYERS:
+            case ApiEndpoint::STATE: {
+                SharedRequestResult result;
                 try {
-                    json::value req_body = json::parse(req.body());
-                    std::string user_name = json::value_to<std::string>(req_body.at("userName"));
-                    std::string map_id = json::value_to<std::string>(req_body.at("mapId"));
-                    if (user_name.empty()) {
-                        return api_response(http::status::bad_request, Response::INVALID_NAME);
-                    }
-                    const model::Map* map = game_.FindMap(model::Map::Id(map_id));
-                    if (!map) {
-                        return api_response(http::status::not_found, Response::MAP_NOT_FOUND);
-                    }
-                    auto player = model::Players::CreatePlayer(user_name);
-                    game_.JoinMap(map, player);
-                    return api_response(http::status::ok, json_encoder::PlayerToString(*player));
+                    result = HandleReadOnlyApiRequest(req, *match);
                 } catch(...) {
-                    return api_response(http::status::bad_request, Response::JOIN_GAME_REQUEST_PARSE_ERROR);
+                    return send(ReportServerError(req));
                 }
+                return send_result(std::move(result));
             }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "POST");
+            case ApiEndpoint::JOIN:
+            case ApiEndpoint::ACTION:
+            case ApiEndpoint::TICK:
+                return DispatchToApiStrand(
+                        [this, send, endpoint = match->route->endpoint, req = std::forward<decltype(req)>(req)] {
+                            try {
+                                return send(this->HandleApiRequest(req, endpoint));
+                            } catch(...) {
+                                return send(this->ReportServerError(req));
+                            }
+                        });
+            case ApiEndpoint::STREAM:
+                // Поток открывается только запросом на upgrade, см. HandleUpgrade
+                break;
+        }
+        return send(MakeApiResponse(req, http::status::bad_request, Response::BAD_REQUEST));
+    }
+
+    // Карты не меняются после загрузки, поэтому их JSON и его сжатые варианты готовятся один раз
+    static PreparedMaps PrepareMaps(const model::Game& game) {
+        PreparedMaps result;
+        for (const auto& map : game.GetMaps()) {
+            result.emplace(*map.GetId(), std::make_shared<const prepared_body::PreparedBody>(json_encoder::MapToString(map)));
+        }
+        return result;
+    }
+
+    // id - пустой для списка карт
+    SharedRequestResult HandleMapsRequest(const StringRequest& req, std::string_view id) const {
+        if (id.empty()) {
+            return MakePreparedResponse(req, maps_catalog_);
+        }
+        if (auto it = map_bodies_.find(id); it != map_bodies_.end()) {
+            return MakePreparedResponse(req, it->second);
+        }
+        return MakeApiResponse(req, http::status::not_found, Response::MAP_NOT_FOUND);
+    }
+
+    static PreparedResponse MakePreparedResponse(const StringRequest& req, const std::shared_ptr<const prepared_body::PreparedBody>& body) {
+        const auto accept_encoding = req[http::field::accept_encoding];
+        auto encoding = prepared_body::ChooseEncoding({accept_encoding.data(), accept_encoding.size()});
+        if (!body->HasEncoding(encoding)) {
+            encoding = prepared_body::Encoding::IDENTITY;
+        }
+        auto res = MakeSharedResponse(req, body->GetETag(encoding));
+        res.set(http::field::vary, "Accept-Encoding");
+        if (res.result() == http::status::not_modified) {
             return res;
         }
-        if (target == ApiPath::PLAYERS) {
-            if (req.method_string() == "GET"sv || req.method_string() == "HEAD"sv) {
-                if (auto token = try_extract_token(req)) {
-                    if (auto player = try_get_player_by_token(*token)) {
-                        return api_response(http::status::ok, json_encoder::GameSessionToString(*(*player)->GetSession()));
-                    }
-                    return api_response(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
-                }
-                return api_response(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
-            }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "GET, HEAD");
+        if (encoding != prepared_body::Encoding::IDENTITY) {
+            const auto name = prepared_body::EncodingName(encoding);
+            res.set(http::field::content_encoding, {name.data(), name.size()});
+        }
+        res.body() = prepared_body::Share(body, encoding);
+        res.prepare_payload();
+        return res;
+    }
+
+    // Ответ 304, если у клиента уже есть версия etag, иначе 200 без тела: его добавляет вызывающий
+    static PreparedResponse MakeSharedResponse(const StringRequest& req, std::string_view etag) {
+        PreparedResponse res;
+        res.version(req.version());
+        res.keep_alive(req.keep_alive());
+        res.set(http::field::content_type, ContentType::JSON);
+        res.set(http::field::cache_control, "no-cache");
+        res.set(http::field::etag, {etag.data(), etag.size()});
+        const auto if_none_match = req[http::field::if_none_match];
+        res.result(prepared_body::MatchesETag({if_none_match.data(), if_none_match.size()}, etag)
+                   ? http::status::not_modified : http::status::ok);
+        return res;
+    }
+
+    // Состояние сессии кодируется один раз на снимок, а все опрашивающие его игроки
+    // получают один и тот же буфер. ETag - номер сессии и снимка.
+    // Клиент, указавший в Accept ContentType::STATE_BINARY, получает двоичное состояние
+    static PreparedResponse MakeStateResponse(const StringRequest& req, const model::SessionSnapshot& snapshot) {
+        const auto accept = req[http::field::accept];
+        const bool binary = prepared_body::FindQuality({accept.data(), accept.size()}, ContentType::STATE_BINARY).value_or(0.0) > 0.0;
+        const std::string etag = "\""s + std::to_string(snapshot.session_serial) + "-"s + std::to_string(snapshot.version)
+            + (binary ? "-bin"s : ""s) + "\""s;
+        auto res = MakeSharedResponse(req, etag);
+        res.set(http::field::vary, "Accept");
+        if (res.result() == http::status::not_modified) {
             return res;
         }
-        if (target == ApiPath::STATE) {
-            if (req.method_string() == "GET"sv || req.method_string() == "HEAD"sv) {
-                if (auto token = try_extract_token(req)) {
-                    if (auto player = try_get_player_by_token(*token)) {
-                        return api_response(http::status::ok, json_encoder::GameStateToString(*(*player)->GetSession()));
-                    }
-                    return api_response(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
-                }
-                return api_response(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
+        if (binary) {
+            res.set(http::field::content_type, ContentType::STATE_BINARY);
+            res.body() = snapshot.encoded_binary_state.Get([&snapshot] {
+                return binary_encoder::GameStateToBinary(snapshot);
+            });
+        } else {
+            res.body() = EncodeState(snapshot);
+        }
+        res.prepare_payload();
+        return res;
+    }
+
+    static lazy_buffer::LazyBuffer::Buffer EncodeState(const model::SessionSnapshot& snapshot) {
+        return snapshot.encoded_state.Get([&snapshot] {
+            return json_encoder::GameStateToString(snapshot);
+        });
+    }
+
+    // Изменение попадает в снимок в конце ближайшего тика. Без автоматических тиков следующий
+    // придёт только с /tick, поэтому снимок публикуется сразу
+    void OnSessionChanged(model::GameSession& game_session) {
+        game_session.MarkChanged();
+        if (!is_ticking_) {
+            game_session.PublishSnapshot();
+        }
+    }
+
+    // Действие из WebSocket. Неверные сообщения молча пропускаются: ответа на них клиент не ждёт
+    void HandleStreamMessage(const std::string& token, std::string_view message) {
+        const auto move = ParseMove(message);
+        if (!move || !rate_limiter_.TryAcquire(token)) {
+            return;
+        }
+        DispatchToApiStrand([this, token, move = *move] {
+            if (auto player = TryGetPlayerByToken(token)) {
+                (*player)->GetDog()->ChangeDirection(std::string{move});
+                OnSessionChanged(*(*player)->GetSession());
             }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "GET, HEAD");
-            return res;
+        });
+    }
+
+    // Очередь api_strand измеряется: сколько задач ждёт и как долго
+    template <typename Handler>
+    void DispatchToApiStrand(Handler&& handler) {
+        net::dispatch(api_strand_, [this, enqueued = api_queue_.Enqueue(), handler = std::forward<Handler>(handler)]() mutable {
+            api_queue_.Start(enqueued);
+            handler();
+        });
+    }
+
+    static admission::Priority GetPriority(ApiEndpoint endpoint) {
+        switch (endpoint) {
+            case ApiEndpoint::ACTION:
+            case ApiEndpoint::TICK:
+            case ApiEndpoint::STREAM:
+                return admission::Priority::CRITICAL;
+            case ApiEndpoint::MAPS:
+            case ApiEndpoint::JOIN:
+                return admission::Priority::NORMAL;
+            default:
+                return admission::Priority::LOW;
         }
-        if (target == ApiPath::ACTION) {
-            if (req.method_string() == "POST"sv) {
-                if (!assert_content_type_is_json(req)) {
-                    return api_response(http::status::bad_request, Response::INVALID_CONTENT_TYPE);
-                }
-                if (auto token = try_extract_token(req)) {
-                    if (auto player = try_get_player_by_token(*token)) {
-                        try {
-                            json::value req_body = json::parse(req.body());
-                            std::string move = json::value_to<std::string>(req_body.at("move"));
-                            if (move != "U" && move != "R" && move != "D" && move != "L" && move != "") {
-                                return api_response(http::status::bad_request, Response::ACTION_REQUEST_PARSE_ERROR);
-                            }
-                            (*player)->GetDog()->ChangeDirection(move);
-                            return api_response(http::status::ok, "{}");
-                        } catch(...) {
-                            return api_response(http::status::bad_request, Response::ACTION_REQUEST_PARSE_ERROR);
-                        }
-                    }
-                    return api_response(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
-                }
-                return api_response(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
+    }
+
+    StringResponse MakeRetryResponse(const StringRequest& req, http::status status, std::string_view text) const {
+        auto res = MakeApiResponse(req, status, text);
+        res.set(http::field::retry_after, std::to_string(admission_.GetOptions().retry_after.count()));
+        return res;
+    }
+
+    StringResponse HandleApiRequest(const StringRequest& req, ApiEndpoint endpoint) {
+        if (req[http::field::content_type] != ContentType::JSON) {
+            return MakeApiResponse(req, http::status::bad_request, Response::INVALID_CONTENT_TYPE);
+        }
+        switch (endpoint) {
+            case ApiEndpoint::JOIN:
+                return HandleJoinRequest(req);
+            case ApiEndpoint::ACTION:
+                return HandleActionRequest(req);
+            case ApiEndpoint::TICK:
+                return HandleTickRequest(req);
+            default:
+                return MakeApiResponse(req, http::status::bad_request, Response::BAD_REQUEST);
+        }
+    }
+
+    // Дерево JSON нужно только до конца обработчика, поэтому оно строится в буфере на стеке
+    constexpr static size_t JSON_BUFFER_SIZE = 1024;
+    // Типичный вывод /metrics помещается без перевыделений
+    constexpr static size_t METRICS_BUFFER_SIZE = 64 * 1024;
+    constexpr static std::string_view TICK_PROFILE_PATH = "/admin/tick-profile"sv;
+
+    StringResponse HandleJoinRequest(const StringRequest& req) {
+        const auto api_response = [&req](http::status status, std::string_view text) {
+            return MakeApiResponse(req, status, text);
+        };
+        try {
+            unsigned char buffer[JSON_BUFFER_SIZE];
+            json::monotonic_resource resource{buffer};
+            const json::value req_body = json::parse(std::string_view{req.body()}, &resource);
+            std::string user_name = json::value_to<std::string>(req_body.at("userName"));
+            std::string map_id = json::value_to<std::string>(req_body.at("mapId"));
+            if (user_name.empty()) {
+                return api_response(http::status::bad_request, Response::INVALID_NAME);
             }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "POST");
-            return res;
+            const model::Map* map = game_.FindMap(model::Map::Id(map_id));
+            if (!map) {
+                return api_response(http::status::not_found, Response::MAP_NOT_FOUND);
+            }
+            auto player = game_.GetPlayers().CreatePlayer(user_name);
+            game_.JoinMap(map, player);
+            return MakeApiResponse(req, http::status::ok, json_encoder::PlayerToString(*player));
+        } catch(...) {
+            return api_response(http::status::bad_request, Response::JOIN_GAME_REQUEST_PARSE_ERROR);
         }
-        if (!is_ticking_ && target == ApiPath::TICK) {
-            if (req.method_string() == "POST"sv) {
-                if (!assert_content_type_is_json(req)) {
-                    return api_response(http::status::bad_request, Response::INVALID_CONTENT_TYPE);
-                }
-                try {
-                    json::value req_body = json::parse(req.body());
-                    int time_delta = req_body.at("timeDelta").as_int64();
-                    game_.Tick(time_delta, loot_generator_);
-                    return api_response(http::status::ok, "{}");
-                } catch(...) {
-                    return api_response(http::status::bad_request, Response::TICK_REQUEST_PARSE_ERROR);
-                }
+    }
+
+    StringResponse HandleActionRequest(const StringRequest& req) {
+        const auto api_response = [&req](http::status status, std::string_view text) {
+            return MakeApiResponse(req, status, text);
+        };
+        const auto token = TryExtractToken(req);
+        if (!token) {
+            return api_response(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
+        }
+        const auto player = TryGetPlayerByToken(*token);
+        if (!player) {
+            return api_response(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
+        }
+        const auto move = ParseMove(req.body());
+        if (!move) {
+            return api_response(http::status::bad_request, Response::ACTION_REQUEST_PARSE_ERROR);
+        }
+        (*player)->GetDog()->ChangeDirection(std::string{*move});
+        OnSessionChanged(*(*player)->GetSession());
+        return api_response(http::status::ok, "{}");
+    }
+
+    StringResponse HandleTickRequest(const StringRequest& req) {
+        try {
+            unsigned char buffer[JSON_BUFFER_SIZE];
+            json::monotonic_resource resource{buffer};
+            const json::value req_body = json::parse(std::string_view{req.body()}, &resource);
+            int time_delta = req_body.at("timeDelta").as_int64();
+            Tick(std::chrono::milliseconds{time_delta});
+            return MakeApiResponse(req, http::status::ok, "{}"sv);
+        } catch(...) {
+            return MakeApiResponse(req, http::status::bad_request, Response::TICK_REQUEST_PARSE_ERROR);
+        }
+    }
+
+    // Направление из тела действия; nullopt, если тело не разбирается или направление неверное.
+    // Обычное тело {"move": "L"} разбирается без дерева JSON, остальные - полным парсером
+    static std::optional<std::string_view> ParseMove(std::string_view body) {
+        if (auto move = json_encoder::TryParseMove(body)) {
+            return ValidateMove(*move);
+        }
+        try {
+            unsigned char buffer[JSON_BUFFER_SIZE];
+            json::monotonic_resource resource{buffer};
+            const json::value value = json::parse(body, &resource);
+            const auto& move = value.at("move").as_string();
+            return ValidateMove({move.data(), move.size()});
+        } catch(...) {
+            return std::nullopt;
+        }
+    }
+
+    // Возвращает строку-константу, которая не зависит от времени жизни move
+    static std::optional<std::string_view> ValidateMove(std::string_view move) {
+        for (const auto valid : {"U"sv, "R"sv, "D"sv, "L"sv, ""sv}) {
+            if (move == valid) {
+                return valid;
             }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "POST");
-            return res;
         }
-        if (target.rfind(ApiPath::RECORDS, 0) == 0) {
-            if (req.method_string() == "GET"sv || req.method_string() == "HEAD"sv) {
-                int start = 0;
-                int maxItems = 100;
-                if (target != ApiPath::RECORDS) {
-                    std::string query = target.substr(target.find('?') + 1);
-                    if (query.find('&') != std::string::npos) {
-                        if (query.substr(0, 5) == "start") {
-                            query = query.substr(6);
-                            int i = 0;
-                            while ('0' <= query[i] && query[i] <= '9') {
-                                ++i;
-                            }
-                            std::string start_str = query.substr(0, i);
-                            query = query.substr(i);
-                            query = query.substr(10);
-                            std::string maxItems_str = query;
-                            start = std::stoi(start_str);
-                            maxItems = std::stoi(maxItems_str);
-
-                        } else if (query.substr(0, 8) == "maxItems") {
-                            query = query.substr(9);
-                            int i = 0;
-                            while ('0' <= query[i] && query[i] <= '9') {
-                                ++i;
-                            }
-                            std::string maxItems_str = query.substr(0, i);
-                            query = query.substr(i);
-                            query = query.substr(7);
-                            std::string start_str = query;
-                            start = std::stoi(start_str);
-                            maxItems = std::stoi(maxItems_str);
-                        } else {
-                            if (query.substr(0, 5) == "start") {
-                                query = query.substr(6);
-                                int i = 0;
-                                while ('0' <= query[i] && query[i] <= '9') {
-                                    ++i;
-                                }
-                                std::string start_str = query.substr(0, i);
-                                start = std::stoi(start_str);
-                            } else if (query.substr(0, 8) == "maxItems") {
-                                query = query.substr(9);
-                                int i = 0;
-                                while ('0' <= query[i] && query[i] <= '9') {
-                                    ++i;
-                                }
-                                std::string maxItems_str = query.substr(0, i);
-                                maxItems = std::stoi(maxItems_str);
-                            }
-                        }
-                    }
-                }
-                if (maxItems > 100) {
-                    return api_response(http::status::bad_request, Response::BAD_REQUEST);
-                }
-                pqxx::connection conn{db_url_};
-                pqxx::work work{conn};
-                json::array res;
-                for (auto& [name, score, play_time_ms] : work.query<std::string, int, int>("SELECT name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT '" + std::to_string(maxItems) + "' OFFSET '" + std::to_string(start) + "';")) {
-                    res.push_back({
-                        {"name", name},
-                        {"score", score},
-                        {"playTime", play_time_ms / 1000.0}
-                    });
+        return std::nullopt;
+    }
+
+    // Игроки и состояние читаются из опубликованных снимков сессий,
+    // поэтому эти запросы обрабатываются в любом потоке без api_strand
+    SharedRequestResult HandleReadOnlyApiRequest(const StringRequest& req, const api_router::Match<ApiEndpoint>& match) const {
+        const auto api_response = [&req](http::status status, std::string_view text) {
+            return MakeApiResponse(req, status, text);
+        };
+        const auto token = TryExtractToken(req);
+        if (!token) {
+            return api_response(http::status::unauthorized, Response::AUTHORIZATION_HEADER_MISSING);
+        }
+        const auto player = TryGetPlayerByToken(*token);
+        if (!player) {
+            return api_response(http::status::unauthorized, Response::PLAYER_TOKEN_NOT_FOUND);
+        }
+        const auto snapshot = (*player)->GetSession()->GetSnapshot();
+        if (match.route->endpoint == ApiEndpoint::PLAYERS) {
+            return MakeApiResponse(req, http::status::ok, json_encoder::GameSessionToString(*snapshot));
+        }
+        if (auto since_param = api_router::QueryParams{match.query}.Find("since"sv)) {
+            const auto since = model::SessionSnapshot::Since::Parse(*since_param);
+            if (!since) {
+                return api_response(http::status::bad_request, Response::INVALID_SINCE);
+            }
+            return MakeApiResponse(req, http::status::ok,
+                    json_encoder::GameStateDeltaToString(*snapshot, snapshot->GetDelta(*since)));
+        }
+        return MakeStateResponse(req, *snapshot);
+    }
+
+    // Токен смотрит прямо в заголовок запроса, без копирования
+    static std::optional<std::string_view> TryExtractToken(const StringRequest& req) {
+        const auto authorization = req[http::field::authorization];
+        const std::string_view header{authorization.data(), authorization.size()};
+        if (!header.starts_with("Bearer "sv) || header.size() != "Bearer "sv.size() + token_table::TOKEN_LENGTH) {
+            return std::nullopt;
+        }
+        return header.substr("Bearer "sv.size());
+    }
+
+    std::optional<std::shared_ptr<model::Player>> TryGetPlayerByToken(std::string_view token) const {
+        if (auto player = game_.GetPlayers().FindByToken(token)) {
+            return player;
+        }
+        return std::nullopt;
+    }
+
+    static StringResponse MakeApiResponse(const StringRequest& req, http::status status, std::string_view text) {
+        auto res = MakeResponse<StringResponse>(status, text, req.version(), req.keep_alive(), ContentType::JSON);
+        res.set(http::field::cache_control, "no-cache");
+        return res;
+    }
+
+    // Готовый JSON переносится в тело ответа без копирования
+    static StringResponse MakeApiResponse(const StringRequest& req, http::status status, std::string&& text) {
+        auto res = MakeResponse<StringResponse>(status, std::move(text), req.version(), req.keep_alive(), ContentType::JSON);
+        res.set(http::field::cache_control, "no-cache");
+        return res;
+    }
+
+    template <typename Send>
+    void HandleRecordsRequest(StringRequest&& req, const api_router::Match<ApiEndpoint>& match, Send&& send) {
+        const auto api_response = [&req](http::status status, std::string_view text) {
+            return MakeApiResponse(req, status, text);
+        };
+        if (match.route->endpoint == ApiEndpoint::RECORDS_RANK) {
+            return send(HandleRecordRankRequest(req, match.query));
+        }
+        try {
+            const api_router::QueryParams params{match.query};
+            const auto start = FindCountParameter(params, "start"sv, 0);
+            const auto maxItems = FindCountParameter(params, "maxItems"sv, MAX_RECORDS_PAGE);
+            if (!start || !maxItems || *maxItems > MAX_RECORDS_PAGE) {
+                return send(api_response(http::status::bad_request, Response::BAD_REQUEST));
+            }
+            if (leaderboard_.IsLoaded()) {
+                // Версия таблицы меняется с каждой новой записью и с перезапуском, поэтому годится как ETag
+                auto page = leaderboard_.GetPage(*start, *maxItems);
+                const std::string etag = "\""s + std::to_string(page.version) + "\""s;
+                const auto if_none_match = req[http::field::if_none_match];
+                if (prepared_body::MatchesETag({if_none_match.data(), if_none_match.size()}, etag)) {
+                    auto res = api_response(http::status::not_modified, ""sv);
+                    res.set(http::field::etag, etag);
+                    return send(std::move(res));
                 }
-                std::ostringstream oss;
-                oss << res;
-                return api_response(http::status::ok, oss.str());
+                auto response = MakeApiResponse(req, http::status::ok, json_encoder::RecordsToString(page.records));
+                response.set(http::field::etag, etag);
+                return send(std::move(response));
             }
-            auto res = api_response(http::status::method_not_allowed, Response::INVALID_METHOD);
-            res.set(http::field::allow, "GET, HEAD");
-            return res;
+            // Пока таблица в памяти не загружена, рекорды читаются из базы
+            db_pool_->AsyncQuery(
+                "SELECT name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT $1 OFFSET $2;",
+                {std::to_string(*maxItems), std::to_string(*start)},
+                [this, req = std::move(req), send = std::forward<Send>(send)](std::exception_ptr error, postgres::Rows rows) {
+                    try {
+                        if (error) {
+                            std::rethrow_exception(error);
+                        }
+                        std::vector<leaderboard::Record> records;
+                        records.reserve(rows.size());
+                        for (auto& row : rows) {
+                            records.push_back({{}, std::move(row.at(0)), std::stoi(row.at(1)), std::stoi(row.at(2))});
+                        }
+                        send(MakeApiResponse(req, http::status::ok, json_encoder::RecordsToString(records)));
+                    } catch (...) {
+                        send(this->ReportServerError(req));
+                    }
+                });
+        } catch (...) {
+            send(ReportServerError(req));
+        }
+    }
+
+    constexpr static int MAX_RECORDS_PAGE = 100;
+
+    // Неотрицательное целое значение параметра или default_value, если параметра нет;
+    // nullopt, если значение не число
+    static std::optional<int> FindCountParameter(const api_router::QueryParams& params, std::string_view name, int default_value) {
+        const auto value = params.Find(name);
+        if (!value) {
+            return default_value;
+        }
+        int result = 0;
+        const auto [end, error] = std::from_chars(value->data(), value->data() + value->size(), result);
+        if (error != std::errc{} || end != value->data() + value->size() || result < 0) {
+            return std::nullopt;
         }
-        return api_response(http::status::bad_request, Response::BAD_REQUEST);
+        return result;
+    }
+
+    // Лучшее место игрока в таблице рекордов: GET /api/v1/game/records/rank?name=<имя>
+    StringResponse HandleRecordRankRequest(const StringRequest& req, std::string_view query) const {
+        const auto api_response = [&req](http::status status, std::string_view text) {
+            return MakeApiResponse(req, status, text);
+        };
+        if (query.empty()) {
+            return api_response(http::status::bad_request, Response::BAD_REQUEST);
+        }
+        std::optional<std::string> name;
+        if (const auto encoded = api_router::QueryParams{query}.Find("name"sv)) {
+            name = UrlDecode(*encoded);
+        }
+        if (!name || name->empty()) {
+            return api_response(http::status::bad_request, Response::INVALID_NAME);
+        }
+        if (!leaderboard_.IsLoaded()) {
+            return api_response(http::status::service_unavailable, Response::RECORDS_NOT_LOADED);
+        }
+        const auto rank = leaderboard_.FindBestRank(*name);
+        if (!rank) {
+            return api_response(http::status::not_found, Response::RECORD_NOT_FOUND);
+        }
+        return MakeApiResponse(req, http::status::ok, json_encoder::RankToString(*rank));
     }
 
     FileRequestResult HandleFileRequest(const StringRequest& req) {
+        if (auto res = TryMakeCachedFileResponse(req)) {
+            return std::move(*res);
+        }
         const auto text_response = [&req](http::status status, std::string_view text) {
             return MakeResponse<StringResponse>(status, text, req.version(), req.keep_alive(), ContentType::TEXT_PLAIN);
         };
-        const auto file_response = [&req](http::status status, http::file_body::value_type&& file, std::string_view content_type = ContentType::TEXT_HTML) {
+        const auto file_response = [&req](http::status status, sendfile_body::SendfileBody::value_type&& file, std::string_view content_type = ContentType::TEXT_HTML) {
             return MakeResponse<FileResponse>(status, std::move(file), req.version(), req.keep_alive(), content_type);
         };
         fs::path rel_path{UrlDecode(req.target().substr(1))};
@@ -375,7 +759,7 @@ private:
         }
         fs::path abs_path = fs::weakly_canonical(base_path_ / rel_path);
         if (IsSubPath(abs_path, base_path_)) {
-            http::file_body::value_type file;
+            sendfile_body::SendfileBody::value_type file;
             if (boost::system::error_code ec; file.open(abs_path.string().c_str(), beast::file_mode::read, ec), ec) {
                 return text_response(http::status::not_found, "Not found"sv);
             }
@@ -384,6 +768,135 @@ private:
         return text_response(http::status::bad_request, "Bad Request"sv);
     }
 
+    // Файл из кэша статики: без обращений к диску и, если клиент согласен, сжатый.
+    // Поддерживаются условные запросы (If-None-Match, If-Modified-Since) и Range
+    std::optional<FileRequestResult> TryMakeCachedFileResponse(const StringRequest& req) const {
+        std::string_view path{req.target().data(), req.target().size()};
+        path = path.substr(1, path.find('?') - 1);
+        if (path.empty()) {
+            path = "index.html"sv;
+        }
+        const auto* entry = path.find_first_of("%+"sv) == std::string_view::npos
+            ? static_files_.Find(path) : static_files_.Find(UrlDecode(path));
+        if (!entry) {
+            return std::nullopt;
+        }
+        const auto set_file_headers = [entry](auto& res, std::string_view content_type) {
+            res.set(http::field::content_type, content_type);
+            res.set(http::field::last_modified, entry->last_modified);
+            res.set(http::field::accept_ranges, "bytes");
+        };
+        const auto field = [&req](http::field name) {
+            const auto value = req[name];
+            return std::string_view{value.data(), value.size()};
+        };
+        auto reply = static_cache::MakeReply(*entry, {
+            .if_none_match = field(http::field::if_none_match),
+            .if_modified_since = field(http::field::if_modified_since),
+            .if_range = field(http::field::if_range),
+            .range = field(http::field::range),
+            .is_get = req.method() == http::verb::get});
+        using Kind = static_cache::Reply::Kind;
+        if (reply.kind == Kind::NOT_MODIFIED) {
+            auto res = MakeSharedResponse(req, entry->body->GetETag(prepared_body::Encoding::IDENTITY));
+            res.result(http::status::not_modified);
+            set_file_headers(res, entry->content_type);
+            return res;
+        }
+        if (reply.kind != Kind::FULL) {
+            const std::string content_type = std::move(reply.content_type);
+            auto res = MakeRangeResponse(req, *entry, std::move(reply));
+            set_file_headers(res, content_type);
+            return res;
+        }
+        auto res = MakePreparedResponse(req, entry->body);
+        set_file_headers(res, entry->content_type);
+        return res;
+    }
+
+    // Диапазоны всегда берутся из несжатых байтов, поэтому Content-Encoding не ставится
+    static StringResponse MakeRangeResponse(const StringRequest& req, const static_cache::StaticCache::Entry& entry,
+                                            static_cache::Reply&& reply) {
+        StringResponse res;
+        res.version(req.version());
+        res.keep_alive(req.keep_alive());
+        res.set(http::field::cache_control, "no-cache");
+        res.set(http::field::etag, entry.body->GetETag(prepared_body::Encoding::IDENTITY));
+        res.result(reply.kind == static_cache::Reply::Kind::PARTIAL
+                   ? http::status::partial_content : http::status::range_not_satisfiable);
+        if (!reply.content_range.empty()) {
+            res.set(http::field::content_range, reply.content_range);
+        }
+        res.body() = std::move(reply.body);
+        res.prepare_payload();
+        return res;
+    }
+
+    // Сессии, собаки и трофеи считаются по снимкам после тика
+    void UpdateGameMetrics() {
+        std::int64_t sessions = 0;
+        std::int64_t dogs = 0;
+        std::int64_t lost_objects = 0;
+        for (const auto& [map_id, game_sessions] : game_.game_sessions_on_map_) {
+            for (const auto& game_session : game_sessions) {
+                const auto snapshot = game_session->GetSnapshot();
+                ++sessions;
+                dogs += static_cast<std::int64_t>(snapshot->dogs.size());
+                lost_objects += static_cast<std::int64_t>(snapshot->lost_objects.size());
+            }
+        }
+        metrics_.sessions.Set(sessions);
+        metrics_.dogs.Set(dogs);
+        metrics_.lost_objects.Set(lost_objects);
+    }
+
+    // Метрики в текстовом формате Prometheus
+    StringResponse HandleMetricsRequest(const StringRequest& req) const {
+        if (req.method() != http::verb::get) {
+            auto res = MakeResponse<StringResponse>(http::status::method_not_allowed, "Method Not Allowed"sv, req.version(), req.keep_alive(), ContentType::TEXT_PLAIN);
+            res.set(http::field::allow, "GET"sv);
+            return res;
+        }
+        std::string out;
+        out.reserve(METRICS_BUFFER_SIZE);
+        request_durations_.Write(out, "dog_story_http_request_duration_seconds"sv, "API and static file request handling time"sv);
+        metrics_.Write(out);
+        const auto write_value = [&out](std::string_view name, std::string_view type, std::string_view help, double value) {
+            metrics::WriteHeader(out, name, type, help);
+            metrics::WriteSample(out, name, ""sv, value);
+        };
+        write_value("dog_story_connections"sv, "gauge"sv, "Open HTTP and WebSocket connections"sv,
+                static_cast<double>(http_server::ConnectionCount::Get()));
+        write_value("dog_story_api_queue_depth"sv, "gauge"sv, "Tasks waiting for the game strand"sv,
+                static_cast<double>(api_queue_.Depth()));
+        write_value("dog_story_api_queue_wait_seconds"sv, "gauge"sv, "Smoothed wait for the game strand"sv,
+                std::chrono::duration<double>(api_queue_.Wait()).count());
+        write_value("dog_story_api_queue_tasks_total"sv, "counter"sv, "Tasks sent to the game strand"sv,
+                static_cast<double>(api_queue_.Enqueued()));
+        write_value("dog_story_requests_shed_total"sv, "counter"sv, "Requests rejected with 503 under load"sv,
+                static_cast<double>(admission_.Shed()));
+        write_value("dog_story_requests_rate_limited_total"sv, "counter"sv, "Requests over the per-token rate limit"sv,
+                static_cast<double>(rate_limiter_.Limited()));
+        auto res = MakeResponse<StringResponse>(http::status::ok, std::move(out), req.version(), req.keep_alive(), ContentType::METRICS);
+        res.set(http::field::cache_control, "no-cache");
+        return res;
+    }
+
+    // /admin/tick-profile - перцентили фаз тика и самые медленные сессии,
+    // /admin/tick-profile?format=trace - трасса последних тиков для chrome://tracing
+    StringResponse HandleTickProfileRequest(const StringRequest& req, std::string_view query) const {
+        if (!tick_profiler_) {
+            return MakeResponse<StringResponse>(http::status::not_found, "Tick profiler is disabled"sv, req.version(), req.keep_alive(), ContentType::TEXT_PLAIN);
+        }
+        if (req.method() != http::verb::get) {
+            auto res = MakeResponse<StringResponse>(http::status::method_not_allowed, "Method Not Allowed"sv, req.version(), req.keep_alive(), ContentType::TEXT_PLAIN);
+            res.set(http::field::allow, "GET"sv);
+            return res;
+        }
+        const bool trace = api_router::QueryParams{query}.Find("format"sv) == "trace"sv;
+        return MakeApiResponse(req, http::status::ok, trace ? tick_profiler_->TraceToJson() : tick_profiler_->SummaryToJson());
+    }
+
     StringResponse ReportServerError(const StringRequest& req) const {
         const auto text_response = [&req](http::status status, std::string_view text) {
             return MakeResponse<StringResponse>(status, text, req.version(), req.keep_alive(), ContentType::TEXT_PLAIN);
@@ -397,7 +910,19 @@ private:
     Strand api_strand_;
     bool is_ticking_;
     loot_gen::LootGenerator& loot_generator_;
-    std::string db_url_;
+    std::shared_ptr<postgres::ConnectionPool> db_pool_;
+    const leaderboard::Leaderboard& leaderboard_;
+    std::shared_ptr<const prepared_body::PreparedBody> maps_catalog_;
+    PreparedMaps map_bodies_;
+    static_cache::StaticCache static_files_;
+    stream_hub::Hub stream_hub_;
+    admission::QueueMonitor api_queue_;
+    admission::AdmissionControl admission_;
+    admission::RateLimiter rate_limiter_;
+    metrics::Registry& metrics_;
+    std::string metrics_path_;
+    metrics::HistogramTable request_durations_;
+    const tick_profiler::Profiler* tick_profiler_ = nullptr;
 };
 
 }  // namespace http_handler
@@ -0,0 +1,271 @@
+#include "retirement_sink.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+namespace retirement_sink {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char SPILL_FILE_EXTENSION[]{".retired"};
+
+// Запись: "score play_time_ms длина_id длина_имени\n", затем id и имя как есть и перевод строки,
+// так что имя может содержать любые символы
+bool WriteSpillFile(const fs::path& path, const std::vector<RetiredPlayer>& batch) {
+    // Файл появляется под своим именем только целиком записанным
+    fs::path temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+        for (const auto& player : batch) {
+            out << player.score << ' ' << player.play_time_ms << ' ' << player.id.size() << ' ' << player.name.size() << '\n'
+                << player.id << player.name << '\n';
+        }
+        out.flush();
+        if (!out) {
+            std::error_code ec;
+            fs::remove(temp_path, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    return !ec;
+}
+
+bool ReadSpillFile(const fs::path& path, std::vector<RetiredPlayer>& batch) {
+    std::ifstream in{path, std::ios::binary};
+    RetiredPlayer player;
+    size_t id_size;
+    size_t name_size;
+    while (in >> player.score >> player.play_time_ms >> id_size >> name_size) {
+        in.get();
+        player.id.resize(id_size);
+        player.name.resize(name_size);
+        in.read(player.id.data(), id_size);
+        in.read(player.name.data(), name_size);
+        if (in.get() != '\n') {
+            return false;
+        }
+        batch.push_back(player);
+    }
+    return in.eof() && !batch.empty();
+}
+
+}  // namespace
+
+RetirementSink::RetirementSink(BatchWriter writer, size_t capacity, size_t max_batch_size, fs::path spill_dir)
+    : writer_{std::move(writer)}
+    , capacity_{std::max<size_t>(1, capacity)}
+    , max_batch_size_{std::max<size_t>(1, max_batch_size)}
+    , spill_dir_{std::move(spill_dir)} {
+    LoadSpillFiles();
+    thread_ = std::thread{[this] {
+        Run();
+    }};
+}
+
+RetirementSink::~RetirementSink() {
+    Stop();
+}
+
+void RetirementSink::Push(RetiredPlayer player) {
+    std::lock_guard lock{mutex_};
+    queue_.push_back(std::move(player));
+    ++stats_.pushed;
+    stats_.max_queue_size = std::max(stats_.max_queue_size, queue_.size());
+    not_empty_.notify_one();
+}
+
+void RetirementSink::Stop() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+RetirementSink::Stats RetirementSink::GetStats() const {
+    std::lock_guard lock{mutex_};
+    Stats stats = stats_;
+    stats.queue_size = queue_.size();
+    return stats;
+}
+
+void RetirementSink::LoadSpillFiles() {
+    if (spill_dir_.empty()) {
+        return;
+    }
+    fs::create_directories(spill_dir_);
+    for (const auto& entry : fs::directory_iterator{spill_dir_}) {
+        if (entry.path().extension() == SPILL_FILE_EXTENSION) {
+            spill_files_.push_back(entry.path());
+        }
+    }
+    // Имена файлов - номера одинаковой длины, поэтому сортировка по имени восстанавливает порядок
+    std::sort(spill_files_.begin(), spill_files_.end());
+    if (!spill_files_.empty()) {
+        next_spill_file_ = std::stoull(spill_files_.back().stem().string()) + 1;
+    }
+    stats_.spill_files = spill_files_.size();
+}
+
+bool RetirementSink::SpillQueue(bool all) {
+    if (spill_dir_.empty()) {
+        return false;
+    }
+    while (true) {
+        std::vector<RetiredPlayer> batch;
+        {
+            std::lock_guard lock{mutex_};
+            const size_t keep = all ? 0 : capacity_;
+            if (queue_.size() <= keep) {
+                return true;
+            }
+            const size_t count = std::min(queue_.size() - keep, max_batch_size_);
+            std::move(queue_.begin(), queue_.begin() + count, std::back_inserter(batch));
+            queue_.erase(queue_.begin(), queue_.begin() + count);
+        }
+
+        std::ostringstream name;
+        name << std::setw(20) << std::setfill('0') << next_spill_file_ << SPILL_FILE_EXTENSION;
+        const fs::path path = spill_dir_ / name.str();
+        const bool spilled = WriteSpillFile(path, batch);
+
+        std::lock_guard lock{mutex_};
+        if (!spilled) {
+            // Диск не принял пачку: записи остаются в памяти на прежнем месте
+            queue_.insert(queue_.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            return false;
+        }
+        ++next_spill_file_;
+        spill_files_.push_back(path);
+        stats_.spill_files = spill_files_.size();
+        stats_.spilled += batch.size();
+    }
+}
+
+void RetirementSink::Run() {
+    std::vector<RetiredPlayer> batch;
+    batch.reserve(max_batch_size_);
+    while (true) {
+        SpillQueue(false);
+        bool from_queue = false;
+        {
+            std::unique_lock lock{mutex_};
+            not_empty_.wait(lock, [this] {
+                return !queue_.empty() || !spill_files_.empty() || stopping_;
+            });
+            if (queue_.empty() && spill_files_.empty()) {
+                return;
+            }
+            // Записи на диске старше записей в очереди
+            if (spill_files_.empty()) {
+                const size_t count = std::min(queue_.size(), max_batch_size_);
+                std::move(queue_.begin(), queue_.begin() + count, std::back_inserter(batch));
+                queue_.erase(queue_.begin(), queue_.begin() + count);
+                from_queue = true;
+            }
+        }
+
+        if (!from_queue && !ReadSpillFile(spill_files_.front(), batch)) {
+            // Испорченный файл откладываем в сторону, чтобы он не останавливал запись остальных
+            std::error_code ec;
+            fs::path bad_path = spill_files_.front();
+            bad_path += ".bad";
+            fs::rename(spill_files_.front(), bad_path, ec);
+            std::lock_guard lock{mutex_};
+            spill_files_.pop_front();
+            stats_.spill_files = spill_files_.size();
+            ++stats_.failed_attempts;
+            batch.clear();
+            continue;
+        }
+
+        const auto result = WriteBatch(batch);
+        {
+            std::lock_guard lock{mutex_};
+            ++stats_.batches;
+            if (result == WriteResult::WRITTEN) {
+                stats_.written += batch.size();
+            } else if (result == WriteResult::REJECTED) {
+                stats_.dropped += batch.size();
+            } else if (from_queue) {
+                // Сервер останавливается, а база недоступна: пачка возвращается в начало очереди
+                queue_.insert(queue_.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            }
+        }
+        if (result != WriteResult::GAVE_UP && !from_queue) {
+            std::error_code ec;
+            fs::remove(spill_files_.front(), ec);
+            std::lock_guard lock{mutex_};
+            spill_files_.pop_front();
+            stats_.spill_files = spill_files_.size();
+        }
+        batch.clear();
+
+        if (result == WriteResult::GAVE_UP) {
+            // Остаток очереди сохраняется на диск до следующего запуска, а без spill_dir теряется
+            SpillQueue(true);
+            std::lock_guard lock{mutex_};
+            stats_.dropped += queue_.size();
+            queue_.clear();
+            return;
+        }
+    }
+}
+
+RetirementSink::WriteResult RetirementSink::WriteBatch(const std::vector<RetiredPlayer>& batch) {
+    auto delay = MIN_RETRY_DELAY;
+    int attempts_on_stop = 0;
+    while (true) {
+        try {
+            writer_(batch);
+            return WriteResult::WRITTEN;
+        } catch (const RetryableError&) {
+            {
+                std::lock_guard lock{mutex_};
+                ++stats_.failed_attempts;
+                // Пока сервер работает, пачка повторяется без ограничения числа попыток
+                if (stopping_ && ++attempts_on_stop >= MAX_ATTEMPTS_ON_STOP) {
+                    return WriteResult::GAVE_UP;
+                }
+            }
+            WaitBeforeRetry(delay);
+        } catch (...) {
+            // Повтор не поможет: например, пачка нарушает ограничения таблицы
+            std::lock_guard lock{mutex_};
+            ++stats_.failed_attempts;
+            return WriteResult::REJECTED;
+        }
+        delay = std::min(delay * 2, MAX_RETRY_DELAY);
+    }
+}
+
+void RetirementSink::WaitBeforeRetry(std::chrono::milliseconds delay) {
+    const auto deadline = Clock::now() + delay;
+    bool can_spill = !spill_dir_.empty();
+    std::unique_lock lock{mutex_};
+    // При остановке повторяем без ожидания, а пока ждём, переносим переполнение очереди на диск
+    while (!stopping_) {
+        const bool woken = not_empty_.wait_until(lock, deadline, [&] {
+            return stopping_ || (can_spill && queue_.size() > capacity_);
+        });
+        if (!woken || stopping_) {
+            return;
+        }
+        lock.unlock();
+        can_spill = SpillQueue(false);
+        lock.lock();
+    }
+}
+
+}  // namespace retirement_sink
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace retirement_sink {
+
+struct RetiredPlayer {
+    std::string name;
+    int score;
+    int play_time_ms;
+    // uuid записи, по нему таблица рекордов в памяти узнаёт уже загруженные из базы записи
+    std::string id = {};
+};
+
+// Ошибка записи, после которой пачку стоит повторить, например разрыв соединения с базой.
+// Такая пачка повторяется, пока работает сервер. Пачка, на которой writer выбросил
+// любое другое исключение, отбрасывается сразу
+class RetryableError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/*
+ *  Очередь записей об ушедших на пенсию игроках, которую разбирает отдельный поток.
+ *  Тик только кладёт запись в очередь, а поток пишет их пачками через writer.
+ *  Push никогда не ждёт и не теряет записи, так что недоступная база не останавливает тики игры.
+ *  Пока база недоступна, поток переносит самые старые записи сверх capacity в файлы
+ *  в каталоге spill_dir и пишет их в базу первыми, когда она вернётся. Без spill_dir
+ *  очередь растёт в памяти. Файлы, оставшиеся после остановки, дописываются при следующем запуске.
+ */
+class RetirementSink {
+public:
+    // Записывает пачку целиком или выбрасывает исключение. После RetryableError пачка
+    // повторяется, поэтому запись пачки должна быть идемпотентной
+    using BatchWriter = std::function<void(const std::vector<RetiredPlayer>&)>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        std::uint64_t pushed = 0;
+        std::uint64_t written = 0;
+        std::uint64_t batches = 0;
+        std::uint64_t failed_attempts = 0;
+        // записи из отвергнутых базой пачек и записи, не записанные при остановке без spill_dir
+        std::uint64_t dropped = 0;
+        // записи, перенесённые из очереди на диск
+        std::uint64_t spilled = 0;
+        size_t queue_size = 0;
+        size_t max_queue_size = 0;
+        size_t spill_files = 0;
+    };
+
+    explicit RetirementSink(BatchWriter writer, size_t capacity = 4096, size_t max_batch_size = 256,
+                            std::filesystem::path spill_dir = {});
+
+    RetirementSink(const RetirementSink&) = delete;
+    RetirementSink& operator=(const RetirementSink&) = delete;
+
+    ~RetirementSink();
+
+    void Push(RetiredPlayer player);
+
+    // Записывает всё, что осталось в очереди, и останавливает поток. Если база так и не
+    // приняла пачку, остаток очереди сохраняется в spill_dir
+    void Stop();
+
+    Stats GetStats() const;
+
+private:
+    enum class WriteResult {
+        WRITTEN,
+        REJECTED,
+        GAVE_UP
+    };
+
+    void Run();
+    WriteResult WriteBatch(const std::vector<RetiredPlayer>& batch);
+    void WaitBeforeRetry(std::chrono::milliseconds delay);
+    // Переносит на диск самые старые записи: сверх capacity или всю очередь при остановке
+    bool SpillQueue(bool all);
+    void LoadSpillFiles();
+
+    constexpr static int MAX_ATTEMPTS_ON_STOP = 3;
+    constexpr static std::chrono::milliseconds MIN_RETRY_DELAY{100};
+    constexpr static std::chrono::milliseconds MAX_RETRY_DELAY{5000};
+
+    BatchWriter writer_;
+    const size_t capacity_;
+    const size_t max_batch_size_;
+    const std::filesystem::path spill_dir_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::deque<RetiredPlayer> queue_;
+    bool stopping_ = false;
+    Stats stats_;
+
+    // Файлы с пачками на диске, от старых к новым. Их читает и пишет только поток записи
+    std::deque<std::filesystem::path> spill_files_;
+    std::uint64_t next_spill_file_ = 0;
+
+    std::thread thread_;
+};
+
+}  // namespace retirement_sink
@@ -0,0 +1,126 @@
+#include "road_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace road_index {
+
+namespace {
+
+std::int64_t NearestLine(double pos) {
+    return static_cast<std::int64_t>(std::floor(pos + 0.5));
+}
+
+}  // namespace
+
+void RoadIndex::AddHorizontal(int y, int x0, int x1) {
+    horizontal_[y].Add(std::min(x0, x1) - half_width_, std::max(x0, x1) + half_width_);
+}
+
+void RoadIndex::AddVertical(int x, int y0, int y1) {
+    vertical_[x].Add(std::min(y0, y1) - half_width_, std::max(y0, y1) + half_width_);
+}
+
+void RoadIndex::Build() {
+    for (auto& [y, line] : horizontal_) {
+        line.Build();
+    }
+    for (auto& [x, line] : vertical_) {
+        line.Build();
+    }
+}
+
+Area RoadIndex::FindArea(double x, double y) const {
+    Area area;
+    const std::int64_t line_y = NearestLine(y);
+    if (auto it = horizontal_.find(line_y); it != horizontal_.end()) {
+        const double min_y = static_cast<double>(line_y) - half_width_;
+        const double max_y = static_cast<double>(line_y) + half_width_;
+        if (min_y <= y && y <= max_y) {
+            if (const Extent* extent = it->second.Find(x)) {
+                area = {extent->min, extent->max, min_y, max_y};
+            }
+        }
+    }
+    const std::int64_t line_x = NearestLine(x);
+    if (auto it = vertical_.find(line_x); it != vertical_.end()) {
+        const double min_x = static_cast<double>(line_x) - half_width_;
+        const double max_x = static_cast<double>(line_x) + half_width_;
+        if (min_x <= x && x <= max_x) {
+            if (const Extent* extent = it->second.Find(y)) {
+                area.min_x = std::min(area.min_x, min_x);
+                area.max_x = std::max(area.max_x, max_x);
+                area.min_y = std::min(area.min_y, extent->min);
+                area.max_y = std::max(area.max_y, extent->max);
+            }
+        }
+    }
+    return area;
+}
+
+void RoadIndex::Line::Build() {
+    bounds_.clear();
+    for (const auto& road : roads_) {
+        bounds_.push_back(road.min);
+        bounds_.push_back(road.max);
+    }
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+
+    std::vector<Extent> by_min = roads_;
+    std::sort(by_min.begin(), by_min.end(), [](const Extent& l, const Extent& r) {
+        return l.min < r.min;
+    });
+    std::vector<Extent> by_max = roads_;
+    std::sort(by_max.begin(), by_max.end(), [](const Extent& l, const Extent& r) {
+        return l.max < r.max;
+    });
+
+    // Заметаем прямую слева направо, поддерживая множество дорог, покрывающих текущую точку
+    std::multiset<double> active_mins;
+    std::multiset<double> active_maxes;
+    const auto save_coverage = [&] {
+        if (active_mins.empty()) {
+            coverage_.push_back({});
+            covered_.push_back(false);
+        } else {
+            coverage_.push_back({*active_mins.begin(), *active_maxes.rbegin()});
+            covered_.push_back(true);
+        }
+    };
+
+    coverage_.clear();
+    covered_.clear();
+    coverage_.reserve(bounds_.size() * 2);
+    covered_.reserve(bounds_.size() * 2);
+    size_t opened = 0;
+    size_t closed = 0;
+    for (double bound : bounds_) {
+        for (; opened < by_min.size() && by_min[opened].min == bound; ++opened) {
+            active_mins.insert(by_min[opened].min);
+            active_maxes.insert(by_min[opened].max);
+        }
+        save_coverage();
+        for (; closed < by_max.size() && by_max[closed].max == bound; ++closed) {
+            active_mins.erase(active_mins.find(by_max[closed].min));
+            active_maxes.erase(active_maxes.find(by_max[closed].max));
+        }
+        save_coverage();
+    }
+}
+
+const RoadIndex::Extent* RoadIndex::Line::Find(double pos) const {
+    auto it = std::lower_bound(bounds_.begin(), bounds_.end(), pos);
+    size_t cell;
+    if (it != bounds_.end() && *it == pos) {
+        cell = 2 * (it - bounds_.begin());
+    } else if (it == bounds_.begin()) {
+        return nullptr;
+    } else {
+        cell = 2 * (it - bounds_.begin() - 1) + 1;
+    }
+    return covered_[cell] ? &coverage_[cell] : nullptr;
+}
+
+}  // namespace road_index
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace road_index {
+
+// Прямоугольник, в пределах которого может двигаться собака.
+// Значения по умолчанию соответствуют случаю, когда точка не лежит ни на одной дороге.
+struct Area {
+    bool operator==(const Area&) const = default;
+
+    double min_x = 1e9;
+    double max_x = -1e9;
+    double min_y = 1e9;
+    double max_y = -1e9;
+};
+
+/*
+ *  Индекс дорог карты.
+ *  Дороги группируются по прямым (горизонтальные - по y, вертикальные - по x),
+ *  и на каждой прямой заранее вычисляется объединение дорог, покрывающих каждый
+ *  элементарный отрезок между концами дорог. Запрос FindArea возвращает тот же
+ *  прямоугольник, что и перебор всех дорог, содержащих точку, но за O(log k),
+ *  где k - число дорог на прямой.
+ */
+class RoadIndex {
+public:
+    explicit RoadIndex(double road_width)
+        : half_width_{road_width / 2} {
+    }
+
+    void AddHorizontal(int y, int x0, int x1);
+    void AddVertical(int x, int y0, int y1);
+
+    // Строит индекс, должна быть вызвана после добавления всех дорог
+    void Build();
+
+    Area FindArea(double x, double y) const;
+
+private:
+    struct Extent {
+        double min;
+        double max;
+    };
+
+    // Дороги, лежащие на одной прямой
+    class Line {
+    public:
+        void Add(double min, double max) {
+            roads_.push_back({min, max});
+        }
+
+        void Build();
+
+        // Объединение дорог прямой, содержащих координату pos
+        const Extent* Find(double pos) const;
+
+    private:
+        std::vector<Extent> roads_;
+        // Упорядоченные концы дорог
+        std::vector<double> bounds_;
+        // Ячейка 2 * i - покрытие в точке bounds_[i],
+        // ячейка 2 * i + 1 - на интервале (bounds_[i], bounds_[i + 1])
+        std::vector<Extent> coverage_;
+        std::vector<bool> covered_;
+    };
+
+    double half_width_;
+    std::unordered_map<std::int64_t, Line> horizontal_;
+    std::unordered_map<std::int64_t, Line> vertical_;
+};
+
+}  // namespace road_index
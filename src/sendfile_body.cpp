@@ -0,0 +1,28 @@
+#include "sendfile_body.h"
+
+#include <boost/asio/error.hpp>
+
+#include <sys/sendfile.h>
+
+#include <cerrno>
+
+namespace sendfile_body {
+
+std::size_t SendChunk(int socket, int file, std::uint64_t& offset, std::size_t count, boost::beast::error_code& ec) {
+    off_t position = static_cast<off_t>(offset);
+    while (true) {
+        const ssize_t sent = ::sendfile(socket, file, &position, count);
+        if (sent >= 0) {
+            offset = static_cast<std::uint64_t>(position);
+            // Файл стал короче, чем обещано в Content-Length
+            ec = sent == 0 && count > 0 ? boost::asio::error::eof : boost::beast::error_code{};
+            return static_cast<std::size_t>(sent);
+        }
+        if (errno != EINTR) {
+            ec.assign(errno, boost::system::system_category());
+            return 0;
+        }
+    }
+}
+
+}  // namespace sendfile_body
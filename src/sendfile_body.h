@@ -0,0 +1,26 @@
+#pragma once
+
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/file_body.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sendfile_body {
+
+/*
+ *  Тело-файл, которое http_server отправляет через sendfile(2): Beast пишет только
+ *  заголовок, а байты файла идут из кэша страниц прямо в сокет, без копии в памяти процесса.
+ *  Всё остальное унаследовано от file_body, поэтому обычный http::async_write
+ *  отправит такое тело с буферизацией, как раньше.
+ */
+struct SendfileBody : boost::beast::http::file_body {};
+
+// Больше за один вызов не отправляется, чтобы большой файл не занимал поток надолго
+constexpr std::size_t MAX_CHUNK = 1 << 20;
+
+// Один вызов sendfile: до count байтов файла начиная с offset, offset сдвигается на отправленное.
+// Если буфер неблокирующего сокета заполнен, возвращает 0 и would_block
+std::size_t SendChunk(int socket, int file, std::uint64_t& offset, std::size_t count, boost::beast::error_code& ec);
+
+}  // namespace sendfile_body
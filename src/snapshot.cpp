@@ -0,0 +1,124 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+
+namespace snapshot {
+
+namespace {
+
+constexpr std::uint64_t CHECKSUM_SEED = 0x9E3779B97F4A7C15ull;
+constexpr std::uint64_t CHECKSUM_MUL1 = 0xBF58476D1CE4E5B9ull;
+constexpr std::uint64_t CHECKSUM_MUL2 = 0x94D049BB133111EBull;
+
+std::uint64_t Mix(std::uint64_t h) {
+    h ^= h >> 30;
+    h *= CHECKSUM_MUL1;
+    h ^= h >> 27;
+    h *= CHECKSUM_MUL2;
+    return h ^ (h >> 31);
+}
+
+template <typename T>
+void PutNumber(char* out, T value) {
+    value = detail::ToLittleEndian(value);
+    std::memcpy(out, &value, sizeof(value));
+}
+
+template <typename T>
+T GetNumber(const char* in) {
+    T value;
+    std::memcpy(&value, in, sizeof(value));
+    return detail::ToLittleEndian(value);
+}
+
+}  // namespace
+
+// Не криптографическая сумма: ловит повреждения и обрезанные файлы, обрабатывая по 8 байт
+std::uint64_t Checksum(std::string_view data) {
+    std::uint64_t h = CHECKSUM_SEED ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        h = std::rotl(h ^ (GetNumber<std::uint64_t>(data.data() + i) * CHECKSUM_MUL1), 31) * CHECKSUM_MUL2;
+    }
+    std::uint64_t tail = 0;
+    for (size_t shift = 0; i < data.size(); ++i, shift += 8) {
+        tail |= std::uint64_t{static_cast<unsigned char>(data[i])} << shift;
+    }
+    return Mix(h ^ tail);
+}
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Failed to open " + path);
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "Failed to stat " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            const int error = errno;
+            data_ = nullptr;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "Failed to map " + path);
+        }
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+}
+
+bool IsSnapshotFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::array<char, MAGIC.size()> magic{};
+    return in.read(magic.data(), magic.size()) && magic == MAGIC;
+}
+
+void BinaryOArchive::SaveToFile(const std::string& path) {
+    const std::string_view payload = std::string_view{buffer_}.substr(HEADER_SIZE);
+    std::memcpy(buffer_.data(), MAGIC.data(), MAGIC.size());
+    PutNumber(buffer_.data() + 4, FORMAT_VERSION);
+    PutNumber(buffer_.data() + 8, static_cast<std::uint64_t>(payload.size()));
+    PutNumber(buffer_.data() + 16, Checksum(payload));
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(buffer_.data(), buffer_.size());
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+BinaryIArchive::BinaryIArchive(std::string_view data) {
+    if (data.size() < HEADER_SIZE || data.substr(0, MAGIC.size()) != std::string_view{MAGIC.data(), MAGIC.size()}) {
+        throw FormatError("Not a snapshot");
+    }
+    if (const auto version = GetNumber<std::uint32_t>(data.data() + 4); version != FORMAT_VERSION) {
+        throw FormatError("Unsupported snapshot version " + std::to_string(version));
+    }
+    const auto payload_size = GetNumber<std::uint64_t>(data.data() + 8);
+    if (payload_size != data.size() - HEADER_SIZE) {
+        throw FormatError("Snapshot is truncated");
+    }
+    data_ = data.substr(HEADER_SIZE);
+    if (Checksum(data_) != GetNumber<std::uint64_t>(data.data() + 16)) {
+        throw FormatError("Snapshot checksum mismatch");
+    }
+}
+
+}  // namespace snapshot
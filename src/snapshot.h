@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace snapshot {
+
+/*
+ *  Двоичный формат файла состояния.
+ *  Заголовок: сигнатура, версия формата, размер и контрольная сумма данных.
+ *  Данные пишутся теми же методами serialize, что и архивы Boost: числа в little-endian,
+ *  строки и контейнеры с длиной впереди, shared_ptr с отслеживанием повторов.
+ *  Файл отображается в память, и загрузка - один линейный проход по нему.
+ */
+
+constexpr std::array<char, 4> MAGIC{'D', 'S', 'S', 'N'};
+// Передаётся в serialize как version
+constexpr std::uint32_t FORMAT_VERSION = 1;
+constexpr size_t HEADER_SIZE = 24;
+
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+std::uint64_t Checksum(std::string_view data);
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    std::string_view Data() const noexcept {
+        return {static_cast<const char*>(data_), size_};
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Начинается ли файл с сигнатуры двоичного формата
+bool IsSnapshotFile(const std::string& path);
+
+namespace detail {
+
+template <typename T, template <typename...> typename Template>
+struct IsSpecialization : std::false_type {};
+
+template <template <typename...> typename Template, typename... Args>
+struct IsSpecialization<Template<Args...>, Template> : std::true_type {};
+
+template <typename T, template <typename...> typename Template>
+constexpr bool IS_SPECIALIZATION = IsSpecialization<std::remove_cv_t<T>, Template>::value;
+
+template <typename T>
+T ToLittleEndian(T value) {
+    if constexpr (std::endian::native == std::endian::big && sizeof(T) == 8) {
+        return __builtin_bswap64(value);
+    } else if constexpr (std::endian::native == std::endian::big && sizeof(T) == 4) {
+        return __builtin_bswap32(value);
+    } else if constexpr (std::endian::native == std::endian::big && sizeof(T) == 2) {
+        return __builtin_bswap16(value);
+    } else {
+        return value;
+    }
+}
+
+template <typename T>
+using UnsignedOfSize = std::conditional_t<sizeof(T) == 8, std::uint64_t,
+                       std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                       std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint8_t>>>;
+
+}  // namespace detail
+
+class BinaryOArchive {
+public:
+    using is_loading = std::false_type;
+    using is_saving = std::true_type;
+
+    BinaryOArchive() {
+        buffer_.resize(HEADER_SIZE);
+    }
+
+    template <typename T>
+    BinaryOArchive& operator<<(const T& value) {
+        Save(value);
+        return *this;
+    }
+
+    template <typename T>
+    BinaryOArchive& operator&(const T& value) {
+        Save(value);
+        return *this;
+    }
+
+    // Дописывает заголовок и сохраняет архив в файл
+    void SaveToFile(const std::string& path);
+
+    size_t Size() const noexcept {
+        return buffer_.size();
+    }
+
+private:
+    template <typename T>
+    void Save(const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            SaveNumber(static_cast<std::uint8_t>(value));
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            SaveNumber(value);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            SaveNumber(static_cast<std::uint64_t>(value.size()));
+            buffer_.append(value);
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::pair>) {
+            Save(value.first);
+            Save(value.second);
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::vector> || detail::IS_SPECIALIZATION<T, std::map>) {
+            SaveNumber(static_cast<std::uint64_t>(value.size()));
+            for (const auto& item : value) {
+                Save(item);
+            }
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::shared_ptr>) {
+            SavePointer(value);
+        } else {
+            // serialize не меняет объект при сохранении, как и в архивах Boost
+            const_cast<T&>(value).serialize(*this, FORMAT_VERSION);
+        }
+    }
+
+    template <typename T>
+    void SaveNumber(T value) {
+        const auto bits = detail::ToLittleEndian(std::bit_cast<detail::UnsignedOfSize<T>>(value));
+        buffer_.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+    }
+
+    // 0 - пустой указатель, иначе номер объекта; новый объект записывается следом за номером
+    template <typename T>
+    void SavePointer(const std::shared_ptr<T>& ptr) {
+        if (!ptr) {
+            return SaveNumber(std::uint32_t{0});
+        }
+        auto [it, inserted] = tracked_.try_emplace(ptr.get(), static_cast<std::uint32_t>(tracked_.size() + 1));
+        SaveNumber(it->second);
+        if (inserted) {
+            Save(*ptr);
+        }
+    }
+
+    std::string buffer_;
+    std::unordered_map<const void*, std::uint32_t> tracked_;
+};
+
+class BinaryIArchive {
+public:
+    using is_loading = std::true_type;
+    using is_saving = std::false_type;
+
+    // Проверяет заголовок и контрольную сумму; data должна жить дольше архива
+    explicit BinaryIArchive(std::string_view data);
+
+    template <typename T>
+    BinaryIArchive& operator>>(T& value) {
+        Load(value);
+        return *this;
+    }
+
+    template <typename T>
+    BinaryIArchive& operator&(T& value) {
+        Load(value);
+        return *this;
+    }
+
+private:
+    template <typename T>
+    void Load(T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            value = LoadNumber<std::uint8_t>() != 0;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            value = LoadNumber<T>();
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            const size_t size = LoadSize();
+            value.assign(Take(size), size);
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::pair>) {
+            Load(value.first);
+            Load(value.second);
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::vector>) {
+            const size_t size = LoadSize();
+            value.clear();
+            value.resize(size);
+            for (auto& item : value) {
+                Load(item);
+            }
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::map>) {
+            const size_t size = LoadSize();
+            value.clear();
+            for (size_t i = 0; i < size; ++i) {
+                std::pair<typename T::key_type, typename T::mapped_type> item;
+                Load(item);
+                value.emplace_hint(value.end(), std::move(item));
+            }
+        } else if constexpr (detail::IS_SPECIALIZATION<T, std::shared_ptr>) {
+            LoadPointer(value);
+        } else {
+            value.serialize(*this, FORMAT_VERSION);
+        }
+    }
+
+    template <typename T>
+    T LoadNumber() {
+        detail::UnsignedOfSize<T> bits;
+        std::memcpy(&bits, Take(sizeof(bits)), sizeof(bits));
+        return std::bit_cast<T>(detail::ToLittleEndian(bits));
+    }
+
+    // Размер контейнера не может превышать число оставшихся байт
+    size_t LoadSize() {
+        const auto size = LoadNumber<std::uint64_t>();
+        if (size > data_.size() - offset_) {
+            throw FormatError("Snapshot is corrupted");
+        }
+        return static_cast<size_t>(size);
+    }
+
+    template <typename T>
+    void LoadPointer(std::shared_ptr<T>& ptr) {
+        const auto index = LoadNumber<std::uint32_t>();
+        if (index == 0) {
+            ptr.reset();
+        } else if (index == loaded_.size() + 1) {
+            ptr = std::make_shared<T>();
+            loaded_.push_back(ptr);
+            Load(*ptr);
+        } else if (index <= loaded_.size()) {
+            ptr = std::static_pointer_cast<T>(loaded_[index - 1]);
+        } else {
+            throw FormatError("Snapshot is corrupted");
+        }
+    }
+
+    const char* Take(size_t size) {
+        if (size > data_.size() - offset_) {
+            throw FormatError("Snapshot is truncated");
+        }
+        const char* result = data_.data() + offset_;
+        offset_ += size;
+        return result;
+    }
+
+    std::string_view data_;
+    size_t offset_ = 0;
+    std::vector<std::shared_ptr<void>> loaded_;
+};
+
+}  // namespace snapshot
@@ -0,0 +1,146 @@
+#include "static_cache.h"
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace static_cache {
+
+using namespace std::literals;
+
+namespace {
+
+std::string ReadFile(const fs::path& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error("Failed to open "s + path.string());
+    }
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+std::time_t ToTime(fs::file_time_type time) {
+    return std::chrono::system_clock::to_time_t(
+        std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(time)));
+}
+
+bool MatchesAnyETag(std::string_view if_none_match, const prepared_body::PreparedBody& body) {
+    using prepared_body::Encoding;
+    for (auto encoding : {Encoding::IDENTITY, Encoding::GZIP, Encoding::DEFLATE}) {
+        if (body.HasEncoding(encoding) && prepared_body::MatchesETag(if_none_match, body.GetETag(encoding))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+std::string FormatHttpDate(std::time_t time) {
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    char buffer[32];
+    const size_t size = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return {buffer, size};
+}
+
+std::optional<std::time_t> ParseHttpDate(std::string_view date) {
+    // strptime нужна строка с завершающим нулём; длиннее правильной даты быть не может
+    char buffer[32];
+    if (date.size() >= sizeof(buffer)) {
+        return std::nullopt;
+    }
+    date.copy(buffer, date.size());
+    buffer[date.size()] = '\0';
+    std::tm tm{};
+    const char* end = strptime(buffer, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return std::nullopt;
+    }
+    return timegm(&tm);
+}
+
+bool IsCompressible(std::string_view content_type) {
+    if (content_type.starts_with("image/"sv)) {
+        return content_type == "image/svg+xml"sv || content_type == "image/bmp"sv
+            || content_type == "image/vnd.microsoft.icon"sv;
+    }
+    return !content_type.starts_with("audio/"sv) && !content_type.starts_with("video/"sv);
+}
+
+Reply MakeReply(const StaticCache::Entry& entry, const Conditions& conditions) {
+    using byte_range::ParsedRanges;
+    Reply reply;
+    if (conditions.if_none_match.empty()) {
+        if (!conditions.if_modified_since.empty()) {
+            const auto since = ParseHttpDate(conditions.if_modified_since);
+            if (since && entry.modified <= *since) {
+                reply.kind = Reply::Kind::NOT_MODIFIED;
+                return reply;
+            }
+        }
+    } else if (MatchesAnyETag(conditions.if_none_match, *entry.body)) {
+        // 304 с ETag выбранного сжатия отвечает вызывающий
+        return reply;
+    }
+    if (!conditions.is_get || conditions.range.empty()) {
+        return reply;
+    }
+    const auto& etag = entry.body->GetETag(prepared_body::Encoding::IDENTITY);
+    if (!conditions.if_range.empty() && conditions.if_range != etag && conditions.if_range != entry.last_modified) {
+        return reply;
+    }
+    // Диапазоны всегда берутся из несжатых байтов
+    const auto& content = entry.body->Get(prepared_body::Encoding::IDENTITY);
+    const auto ranges = byte_range::ParseRange(conditions.range, content.size());
+    if (ranges.status == ParsedRanges::Status::IGNORED) {
+        return reply;
+    }
+    if (ranges.status == ParsedRanges::Status::UNSATISFIABLE) {
+        reply.kind = Reply::Kind::RANGE_NOT_SATISFIABLE;
+        reply.content_type = entry.content_type;
+        reply.content_range = "bytes */"s + std::to_string(content.size());
+        return reply;
+    }
+    reply.kind = Reply::Kind::PARTIAL;
+    if (ranges.ranges.size() == 1) {
+        const auto& range = ranges.ranges.front();
+        reply.content_type = entry.content_type;
+        reply.content_range = byte_range::ContentRange(range, content.size());
+        reply.body = content.substr(range.first, range.Size());
+    } else {
+        const auto boundary = RangeBoundary(entry);
+        reply.content_type = "multipart/byteranges; boundary="s + boundary;
+        reply.body = byte_range::MakeMultipartBody(content, ranges.ranges, entry.content_type, boundary);
+    }
+    return reply;
+}
+
+std::string RangeBoundary(const StaticCache::Entry& entry) {
+    const auto& etag = entry.body->GetETag(prepared_body::Encoding::IDENTITY);
+    return "dog_story_"s + etag.substr(1, etag.size() - 2);
+}
+
+StaticCache::StaticCache(const fs::path& root, const ContentTypeResolver& content_type_of, std::uintmax_t max_file_size) {
+    const fs::path base = fs::weakly_canonical(root);
+    // Символические ссылки пропускаются: они могут вести за пределы корня
+    for (const auto& file : fs::recursive_directory_iterator{base}) {
+        if (file.is_symlink() || !file.is_regular_file() || file.file_size() > max_file_size) {
+            continue;
+        }
+        std::string content_type{content_type_of(file.path())};
+        const bool compress = IsCompressible(content_type);
+        auto body = std::make_shared<const prepared_body::PreparedBody>(ReadFile(file.path()), compress);
+        total_bytes_ += body->Get(prepared_body::Encoding::IDENTITY).size();
+        const std::time_t modified = ToTime(file.last_write_time());
+        entries_.emplace(file.path().lexically_relative(base).generic_string(),
+                         Entry{std::move(body), std::move(content_type), modified, FormatHttpDate(modified)});
+    }
+}
+
+const StaticCache::Entry* StaticCache::Find(std::string_view path) const {
+    const auto it = entries_.find(path);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+}  // namespace static_cache
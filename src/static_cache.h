@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "byte_range.h"
+#include "prepared_body.h"
+
+namespace static_cache {
+
+namespace fs = std::filesystem;
+
+/*
+ *  Статические файлы, прочитанные в память при запуске вместе со сжатыми вариантами и ETag.
+ *  Запрос к файлу из кэша не трогает файловую систему. Файлы, появившиеся после запуска,
+ *  и файлы больше max_file_size в кэш не попадают: их читают с диска как раньше.
+ */
+class StaticCache {
+public:
+    struct Entry {
+        std::shared_ptr<const prepared_body::PreparedBody> body;
+        std::string content_type;
+        // Время изменения файла при запуске и оно же в виде HTTP-даты для Last-Modified
+        std::time_t modified = 0;
+        std::string last_modified;
+    };
+
+    using ContentTypeResolver = std::function<std::string_view(const fs::path& path)>;
+
+    constexpr static std::uintmax_t MAX_FILE_SIZE = 16 << 20;
+
+    StaticCache(const fs::path& root, const ContentTypeResolver& content_type_of, std::uintmax_t max_file_size = MAX_FILE_SIZE);
+
+    // path - раскодированный путь относительно корня через '/', например "js/game.js"
+    const Entry* Find(std::string_view path) const;
+
+    size_t Size() const noexcept {
+        return entries_.size();
+    }
+
+    std::uintmax_t TotalBytes() const noexcept {
+        return total_bytes_;
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view str) const noexcept {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    std::unordered_map<std::string, Entry, Hash, std::equal_to<>> entries_;
+    std::uintmax_t total_bytes_ = 0;
+};
+
+// Заголовки запроса к файлу из кэша, от которых зависит ответ
+struct Conditions {
+    std::string_view if_none_match;
+    std::string_view if_modified_since;
+    std::string_view if_range;
+    std::string_view range;
+    // Range учитывается только в GET
+    bool is_get = true;
+};
+
+// Ответ на запрос к файлу из кэша с учётом условных заголовков и Range
+struct Reply {
+    enum class Kind {
+        // Всё тело; If-None-Match проверяет вызывающий вместе с выбором сжатия
+        FULL,
+        NOT_MODIFIED,
+        PARTIAL,
+        RANGE_NOT_SATISFIABLE
+    };
+
+    Kind kind = Kind::FULL;
+    // Для PARTIAL и RANGE_NOT_SATISFIABLE; у одного диапазона тело - его байты,
+    // у нескольких - multipart/byteranges
+    std::string content_type;
+    std::string content_range;
+    std::string body;
+};
+
+// If-Modified-Since учитывается, только если нет If-None-Match. Диапазон отдаётся,
+// если If-None-Match не совпал, а If-Range совпал с ETag или Last-Modified файла
+Reply MakeReply(const StaticCache::Entry& entry, const Conditions& conditions);
+
+// Граница частей multipart/byteranges строится из ETag файла
+std::string RangeBoundary(const StaticCache::Entry& entry);
+
+// Картинки и звук уже сжаты, сжимать их ещё раз бесполезно
+bool IsCompressible(std::string_view content_type);
+
+// HTTP-дата вида "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string FormatHttpDate(std::time_t time);
+std::optional<std::time_t> ParseHttpDate(std::string_view date);
+
+}  // namespace static_cache
@@ -0,0 +1,74 @@
+#include "stream_hub.h"
+
+#include <algorithm>
+
+namespace stream_hub {
+
+void Hub::Subscribe(Topic topic, std::string owner, std::weak_ptr<Subscriber> subscriber) {
+    std::lock_guard lock{mutex_};
+    topics_[topic].push_back({std::move(owner), std::move(subscriber)});
+}
+
+size_t Hub::Close(Topic topic, std::string_view owner, std::string_view reason) {
+    std::vector<std::shared_ptr<Subscriber>> closed;
+    {
+        std::lock_guard lock{mutex_};
+        const auto it = topics_.find(topic);
+        if (it == topics_.end()) {
+            return 0;
+        }
+        auto& subscriptions = it->second;
+        std::erase_if(subscriptions, [owner, &closed](const Subscription& subscription) {
+            if (subscription.owner != owner) {
+                return false;
+            }
+            if (auto locked = subscription.subscriber.lock()) {
+                closed.push_back(std::move(locked));
+            }
+            return true;
+        });
+        if (subscriptions.empty()) {
+            topics_.erase(it);
+        }
+    }
+    // Подписчики закрываются без блокировки хаба, как и получают кадры
+    for (const auto& subscriber : closed) {
+        subscriber->Close(std::string{reason});
+    }
+    return closed.size();
+}
+
+size_t Hub::CountSubscribers(Topic topic) const {
+    std::lock_guard lock{mutex_};
+    const auto it = topics_.find(topic);
+    if (it == topics_.end()) {
+        return 0;
+    }
+    return std::count_if(it->second.begin(), it->second.end(), [](const Subscription& subscription) {
+        return !subscription.subscriber.expired();
+    });
+}
+
+std::vector<std::shared_ptr<Subscriber>> Hub::TakeAlive(Topic topic) {
+    std::vector<std::shared_ptr<Subscriber>> alive;
+    std::lock_guard lock{mutex_};
+    const auto it = topics_.find(topic);
+    if (it == topics_.end()) {
+        return alive;
+    }
+    auto& subscriptions = it->second;
+    alive.reserve(subscriptions.size());
+    std::erase_if(subscriptions, [&alive](const Subscription& subscription) {
+        if (auto locked = subscription.subscriber.lock()) {
+            alive.push_back(std::move(locked));
+            return false;
+        }
+        return true;
+    });
+    if (subscriptions.empty()) {
+        topics_.erase(it);
+    }
+    return alive;
+}
+
+}  // namespace stream_hub
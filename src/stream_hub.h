@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace stream_hub {
+
+// Готовый кадр; один буфер раздаётся всем подписчикам темы
+using Frame = std::shared_ptr<const std::string>;
+
+class Subscriber {
+public:
+    virtual ~Subscriber() = default;
+
+    // Вызывается из потока публикации, поэтому не должен блокироваться
+    virtual void Push(Frame frame) = 0;
+
+    // Хаб отписал подписчика, и тот должен закрыть поток, сообщив клиенту reason.
+    // Вызывается из потока публикации, поэтому не должен блокироваться
+    virtual void Close(std::string reason) = 0;
+};
+
+/*
+ *  Подписчики, сгруппированные по темам. Тема - адрес объекта, за которым следят подписчики,
+ *  например игровой сессии. Хаб держит слабые ссылки: закрытое соединение просто
+ *  перестаёт существовать и выбрасывается из темы при следующей публикации.
+ *  Подписка помнит владельца, например токен игрока, чтобы сервер мог сам закрыть его потоки.
+ */
+class Hub {
+public:
+    using Topic = const void*;
+
+    void Subscribe(Topic topic, std::string owner, std::weak_ptr<Subscriber> subscriber);
+
+    // Отписывает от темы все подписки owner и закрывает их потоки с причиной reason.
+    // Возвращает число закрытых потоков
+    size_t Close(Topic topic, std::string_view owner, std::string_view reason);
+
+    // Кадр строится фабрикой, только если у темы есть живые подписчики.
+    // Возвращает число подписчиков, получивших кадр
+    template <typename Factory>
+    size_t Publish(Topic topic, Factory&& make_frame) {
+        const auto receivers = TakeAlive(topic);
+        if (receivers.empty()) {
+            return 0;
+        }
+        const Frame frame = make_frame();
+        for (const auto& receiver : receivers) {
+            receiver->Push(frame);
+        }
+        return receivers.size();
+    }
+
+    size_t CountSubscribers(Topic topic) const;
+
+private:
+    struct Subscription {
+        std::string owner;
+        std::weak_ptr<Subscriber> subscriber;
+    };
+
+    // Живые подписчики темы; умершие удаляются из неё
+    std::vector<std::shared_ptr<Subscriber>> TakeAlive(Topic topic);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Topic, std::vector<Subscription>> topics_;
+};
+
+/*
+ *  Очередь кадров медленного получателя длиной в один кадр. Пока пишется текущий кадр,
+ *  новый кадр вытесняет ещё не отправленный: получатель всегда видит последнее состояние,
+ *  а не копит отставание. Не потокобезопасна, используется в strand соединения.
+ */
+class FrameSlot {
+public:
+    // Возвращает true, если запись не шла и её нужно начать с кадра Current()
+    bool Put(Frame frame) {
+        if (!current_) {
+            current_ = std::move(frame);
+            return true;
+        }
+        if (pending_) {
+            ++dropped_;
+        }
+        pending_ = std::move(frame);
+        return false;
+    }
+
+    // Кадр, который сейчас пишется. Живёт до вызова Finish
+    const Frame& Current() const noexcept {
+        return current_;
+    }
+
+    // Вызывается после записи текущего кадра. Возвращает true, если нужно писать следующий
+    bool Finish() {
+        current_ = std::move(pending_);
+        pending_.reset();
+        return static_cast<bool>(current_);
+    }
+
+    std::uint64_t Dropped() const noexcept {
+        return dropped_;
+    }
+
+private:
+    Frame current_;
+    Frame pending_;
+    std::uint64_t dropped_ = 0;
+};
+
+}  // namespace stream_hub
@@ -0,0 +1,200 @@
+#include "tick_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+#include "json_writer.h"
+
+namespace tick_profiler {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::array<std::string_view, PHASE_COUNT> PHASE_NAMES{
+    "move"sv, "gather"sv, "retire"sv, "loot"sv, "publish"sv, "sessions"sv, "retirePlayers"sv, "saveState"sv
+};
+
+std::int64_t ToMicros(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+double ToTraceTime(Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// Перцентили по ближайшему рангу; durations сортируется
+void WritePercentiles(json_writer::JsonWriter& writer, std::vector<Clock::duration>& durations) {
+    std::sort(durations.begin(), durations.end());
+    const auto percentile = [&durations](double q) {
+        const auto rank = static_cast<size_t>(q * static_cast<double>(durations.size()) + 0.999999);
+        return ToMicros(durations[std::clamp<size_t>(rank, 1, durations.size()) - 1]);
+    };
+    writer.BeginObject();
+    if (!durations.empty()) {
+        writer.KeyFragment(R"("p50":)").Int(percentile(0.5))
+            .KeyFragment(R"("p95":)").Int(percentile(0.95))
+            .KeyFragment(R"("p99":)").Int(percentile(0.99))
+            .KeyFragment(R"("max":)").Int(ToMicros(durations.back()));
+    }
+    writer.EndObject();
+}
+
+void WriteEvent(json_writer::JsonWriter& writer, std::string_view name, std::string_view category,
+                Clock::time_point epoch, const Span& span, std::uint32_t thread) {
+    writer.BeginObject()
+        .KeyFragment(R"("name":)").String(name)
+        .KeyFragment(R"("cat":)").String(category)
+        .KeyFragment(R"("ph":"X","pid":1,"tid":)").Int(thread)
+        .KeyFragment(R"("ts":)").Double(ToTraceTime(span.start - epoch))
+        .KeyFragment(R"("dur":)").Double(ToTraceTime(span.duration));
+}
+
+}  // namespace
+
+std::string_view PhaseName(Phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+std::uint32_t ThreadNumber() noexcept {
+    static std::atomic<std::uint32_t> next_thread{0};
+    thread_local const std::uint32_t thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+Clock::duration Trace::Total() const noexcept {
+    Clock::duration total{};
+    for (const auto& span : spans) {
+        total += span.duration;
+    }
+    return total;
+}
+
+Profiler::Profiler()
+    : Profiler(Options{}) {
+}
+
+void Profiler::Record(TickTrace tick) {
+    std::lock_guard lock{mutex_};
+    ticks_.push_back(std::move(tick));
+    while (ticks_.size() > options_.window) {
+        ticks_.pop_front();
+    }
+}
+
+std::string Profiler::SummaryToJson() const {
+    struct SessionStats {
+        // Копия: трасса, из которой взята карта, может уйти из окна, пока пишется JSON
+        std::string map;
+        size_t dogs = 0;
+        Clock::duration max{};
+        Clock::duration sum{};
+        size_t ticks = 0;
+    };
+
+    std::vector<Clock::duration> tick_durations;
+    std::array<std::vector<Clock::duration>, PHASE_COUNT> phase_durations;
+    std::map<std::uint64_t, SessionStats> sessions;
+    {
+        std::lock_guard lock{mutex_};
+        tick_durations.reserve(ticks_.size());
+        for (const auto& tick : ticks_) {
+            tick_durations.push_back(tick.tick.duration);
+            const auto add_phases = [&phase_durations](const Trace& trace) {
+                for (size_t i = 0; i < PHASE_COUNT; ++i) {
+                    if (trace.spans[i].IsRecorded()) {
+                        phase_durations[i].push_back(trace.spans[i].duration);
+                    }
+                }
+            };
+            add_phases(tick.game);
+            for (const auto& trace : tick.sessions) {
+                add_phases(trace);
+                auto& stats = sessions[trace.session];
+                const auto total = trace.Total();
+                if (stats.ticks == 0) {
+                    stats.map = trace.map;
+                }
+                stats.dogs = trace.dogs;
+                stats.max = std::max(stats.max, total);
+                stats.sum += total;
+                ++stats.ticks;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, const SessionStats*>> slowest;
+    slowest.reserve(sessions.size());
+    for (const auto& [id, stats] : sessions) {
+        slowest.emplace_back(id, &stats);
+    }
+    const size_t shown = std::min(options_.slowest_sessions, slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second->max > rhs.second->max;
+    });
+
+    json_writer::JsonWriter writer;
+    writer.BeginObject().KeyFragment(R"("ticks":)").Int(tick_durations.size()).KeyFragment(R"("tick":)");
+    WritePercentiles(writer, tick_durations);
+    writer.KeyFragment(R"("phases":)").BeginObject();
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        writer.Key(PHASE_NAMES[i]);
+        WritePercentiles(writer, phase_durations[i]);
+    }
+    writer.EndObject().KeyFragment(R"("slowestSessions":)").BeginArray();
+    for (size_t i = 0; i < shown; ++i) {
+        const auto& [id, stats] = slowest[i];
+        writer.BeginObject()
+            .KeyFragment(R"("session":)").Int(id)
+            .KeyFragment(R"("map":)").String(stats->map)
+            .KeyFragment(R"("dogs":)").Int(stats->dogs)
+            .KeyFragment(R"("max":)").Int(ToMicros(stats->max))
+            .KeyFragment(R"("mean":)").Int(ToMicros(stats->sum / static_cast<std::int64_t>(stats->ticks)))
+            .EndObject();
+    }
+    writer.EndArray().EndObject();
+    return writer.Release();
+}
+
+std::string Profiler::TraceToJson() const {
+    json_writer::JsonWriter writer;
+    writer.BeginObject().KeyFragment(R"("displayTimeUnit":"ms","traceEvents":)").BeginArray();
+    const auto write_phases = [this, &writer](const Trace& trace, std::string_view category) {
+        for (size_t i = 0; i < PHASE_COUNT; ++i) {
+            if (!trace.spans[i].IsRecorded()) {
+                continue;
+            }
+            WriteEvent(writer, PHASE_NAMES[i], category, epoch_, trace.spans[i], trace.thread);
+            if (trace.session != 0) {
+                writer.KeyFragment(R"("args":)").BeginObject()
+                    .KeyFragment(R"("session":)").Int(trace.session)
+                    .KeyFragment(R"("map":)").String(trace.map)
+                    .KeyFragment(R"("dogs":)").Int(trace.dogs)
+                    .EndObject();
+            }
+            writer.EndObject();
+        }
+    };
+
+    // JSON пишется без блокировки, чтобы выгрузка трассы не задерживала Record в api_strand
+    std::vector<TickTrace> ticks;
+    {
+        std::lock_guard lock{mutex_};
+        ticks.assign(ticks_.begin(), ticks_.end());
+    }
+    for (const auto& tick : ticks) {
+        WriteEvent(writer, "tick"sv, "game"sv, epoch_, tick.tick, tick.game.thread);
+        writer.KeyFragment(R"("args":)").BeginObject()
+            .KeyFragment(R"("sessions":)").Int(tick.sessions.size())
+            .EndObject().EndObject();
+        write_phases(tick.game, "game"sv);
+        for (const auto& trace : tick.sessions) {
+            write_phases(trace, "session"sv);
+        }
+    }
+    writer.EndArray().EndObject();
+    return writer.Release();
+}
+
+}  // namespace tick_profiler
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tick_profiler {
+
+using Clock = std::chrono::steady_clock;
+
+// Фазы тика сессии, затем фазы Game::Tick после тика сессий
+enum class Phase {
+    // Движение собак и упор в края дорог
+    MOVE,
+    // FindGatherEvents и разбор событий сбора
+    GATHER,
+    // Отбор собак на пенсию
+    RETIRE,
+    // Генерация трофеев
+    LOOT,
+    // Снимок сессии для читателей
+    PUBLISH,
+    // Все сессии, параллельно
+    SESSIONS,
+    // Удаление игроков, таблица рекордов и очередь записи в базу
+    RETIRE_PLAYERS,
+    // Сигнал тика и сохранение состояния
+    SAVE_STATE
+};
+
+constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::SAVE_STATE) + 1;
+
+std::string_view PhaseName(Phase phase);
+
+// Номер потока для трассы: потоки нумеруются при первом обращении
+std::uint32_t ThreadNumber() noexcept;
+
+struct Span {
+    Clock::time_point start;
+    Clock::duration duration{};
+
+    bool IsRecorded() const noexcept {
+        return start != Clock::time_point{};
+    }
+};
+
+// Фазы тика одной сессии или уровня игры (session = 0)
+struct Trace {
+    std::uint64_t session = 0;
+    // Указывает на id карты, карты живут всё время работы сервера
+    std::string_view map;
+    size_t dogs = 0;
+    std::uint32_t thread = 0;
+    std::array<Span, PHASE_COUNT> spans{};
+
+    Clock::duration Total() const noexcept;
+};
+
+struct TickTrace {
+    Span tick;
+    Trace game;
+    std::vector<Trace> sessions;
+};
+
+/*
+ *  Секундомер фаз: Lap закрывает текущую фазу и начинает следующую.
+ *  Без трассы ничего не делает и даже не читает часы, так что выключенный
+ *  профилировщик стоит одной проверки указателя на фазу.
+ */
+class Stopwatch {
+public:
+    explicit Stopwatch(Trace* trace) noexcept
+        : trace_{trace} {
+        if (trace_) {
+            trace_->thread = ThreadNumber();
+            last_ = Clock::now();
+        }
+    }
+
+    void Lap(Phase phase) noexcept {
+        if (!trace_) {
+            return;
+        }
+        const auto now = Clock::now();
+        trace_->spans[static_cast<size_t>(phase)] = {last_, now - last_};
+        last_ = now;
+    }
+
+private:
+    Trace* trace_;
+    Clock::time_point last_;
+};
+
+/*
+ *  Хранит трассы последних тиков. По ним считаются перцентили фаз и самые медленные
+ *  сессии, и их же можно выгрузить в формате trace event для chrome://tracing и Perfetto.
+ *  Record вызывается в api_strand, чтение - из любого потока.
+ */
+class Profiler {
+public:
+    struct Options {
+        // Перцентили и трасса строятся по этому числу последних тиков
+        size_t window = 256;
+        size_t slowest_sessions = 5;
+    };
+
+    Profiler();
+
+    explicit Profiler(Options options)
+        : options_{options} {
+    }
+
+    void Record(TickTrace tick);
+
+    // Длительности в микросекундах:
+    // {"ticks": n, "tick": {"p50": .., "p95": .., "p99": .., "max": ..}, "phases": {"move": {..}, ..},
+    //  "slowestSessions": [{"session": .., "map": .., "dogs": .., "max": .., "mean": ..}, ..]}
+    std::string SummaryToJson() const;
+
+    // {"traceEvents": [...]}: тики, фазы игры и фазы каждой сессии, время от запуска профилировщика
+    std::string TraceToJson() const;
+
+private:
+    const Options options_;
+    const Clock::time_point epoch_ = Clock::now();
+    mutable std::mutex mutex_;
+    std::deque<TickTrace> ticks_;
+};
+
+}  // namespace tick_profiler
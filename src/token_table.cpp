@@ -0,0 +1,45 @@
+#include "token_table.h"
+
+namespace token_table {
+
+namespace {
+
+int HexDigit(char c) {
+    if ('0' <= c && c <= '9') {
+        return c - '0';
+    }
+    if ('a' <= c && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+}  // namespace
+
+std::optional<TokenKey> ParseToken(std::string_view token) {
+    if (token.size() != TOKEN_LENGTH) {
+        return std::nullopt;
+    }
+    TokenKey key;
+    for (size_t i = 0; i < TOKEN_LENGTH; ++i) {
+        const int digit = HexDigit(token[i]);
+        if (digit < 0) {
+            return std::nullopt;
+        }
+        std::uint64_t& half = i < TOKEN_LENGTH / 2 ? key.hi : key.lo;
+        half = (half << 4) | static_cast<std::uint64_t>(digit);
+    }
+    return key;
+}
+
+std::string FormatToken(TokenKey key) {
+    constexpr std::string_view DIGITS = "0123456789abcdef";
+    std::string token(TOKEN_LENGTH, '0');
+    for (size_t i = 0; i < TOKEN_LENGTH; ++i) {
+        const std::uint64_t half = i < TOKEN_LENGTH / 2 ? key.hi : key.lo;
+        token[i] = DIGITS[(half >> (60 - 4 * (i % (TOKEN_LENGTH / 2)))) & 0xF];
+    }
+    return token;
+}
+
+}  // namespace token_table
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace token_table {
+
+// Токен игрока - 32 шестнадцатеричные цифры, то есть 128 бит
+struct TokenKey {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+
+    bool operator==(const TokenKey&) const = default;
+};
+
+constexpr size_t TOKEN_LENGTH = 32;
+
+// Разбирает токен без копирования строки. Принимает только строчные цифры,
+// чтобы токены сравнивались так же, как строки
+std::optional<TokenKey> ParseToken(std::string_view token);
+
+std::string FormatToken(TokenKey key);
+
+/*
+ *  Хеш-таблица с открытой адресацией по 128-битному ключу токена.
+ *  Разбита на шарды со своими shared_mutex, так что поиск из разных потоков
+ *  не выстраивается в очередь за одной блокировкой.
+ *  Value должен конструироваться по умолчанию.
+ */
+template <typename Value>
+class TokenTable {
+public:
+    explicit TokenTable(size_t shard_count = 16)
+        : shard_count_{std::bit_ceil(std::max<size_t>(shard_count, 1))}
+        , shards_{std::make_unique<Shard[]>(shard_count_)} {
+    }
+
+    // Возвращает false, если такой ключ уже есть
+    bool Insert(TokenKey key, Value value) {
+        const std::uint64_t hash = Hash(key);
+        Shard& shard = GetShard(hash);
+        std::unique_lock lock{shard.mutex};
+        if (shard.FindSlot(key, hash)) {
+            return false;
+        }
+        if ((shard.used + 1) * 2 > shard.slots.size()) {
+            shard.Rehash(std::max(MIN_SHARD_CAPACITY, std::bit_ceil((shard.size + 1) * 4)));
+        }
+        shard.Place(key, hash, std::move(value));
+        return true;
+    }
+
+    std::optional<Value> Find(TokenKey key) const {
+        const std::uint64_t hash = Hash(key);
+        const Shard& shard = GetShard(hash);
+        std::shared_lock lock{shard.mutex};
+        if (const Slot* slot = shard.FindSlot(key, hash)) {
+            return slot->value;
+        }
+        return std::nullopt;
+    }
+
+    bool Erase(TokenKey key) {
+        const std::uint64_t hash = Hash(key);
+        Shard& shard = GetShard(hash);
+        std::unique_lock lock{shard.mutex};
+        Slot* slot = shard.FindSlot(key, hash);
+        if (!slot) {
+            return false;
+        }
+        // Слот остаётся занятым для цепочек проб, пока таблицу не перестроят
+        slot->state = SlotState::DELETED;
+        slot->value = Value{};
+        --shard.size;
+        return true;
+    }
+
+    void Clear() {
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::unique_lock lock{shards_[i].mutex};
+            shards_[i].slots.clear();
+            shards_[i].size = 0;
+            shards_[i].used = 0;
+        }
+    }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::shared_lock lock{shards_[i].mutex};
+            size += shards_[i].size;
+        }
+        return size;
+    }
+
+    // Обходит шарды по очереди; fn вызывается под блокировкой шарда
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::shared_lock lock{shards_[i].mutex};
+            for (const Slot& slot : shards_[i].slots) {
+                if (slot.state == SlotState::FULL) {
+                    fn(slot.key, slot.value);
+                }
+            }
+        }
+    }
+
+private:
+    enum class SlotState : std::uint8_t { EMPTY, FULL, DELETED };
+
+    struct Slot {
+        TokenKey key;
+        SlotState state = SlotState::EMPTY;
+        Value value{};
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::vector<Slot> slots;
+        // живые записи и занятые слоты вместе с удалёнными
+        size_t size = 0;
+        size_t used = 0;
+
+        template <typename Self>
+        static auto FindSlotImpl(Self& self, TokenKey key, std::uint64_t hash) -> decltype(&self.slots[0]) {
+            if (self.slots.empty()) {
+                return nullptr;
+            }
+            const size_t mask = self.slots.size() - 1;
+            for (size_t i = Probe(hash), step = 0; step <= mask; i = (i + 1) & mask, ++step) {
+                auto& slot = self.slots[i & mask];
+                if (slot.state == SlotState::EMPTY) {
+                    return nullptr;
+                }
+                if (slot.state == SlotState::FULL && slot.key == key) {
+                    return &slot;
+                }
+            }
+            return nullptr;
+        }
+
+        Slot* FindSlot(TokenKey key, std::uint64_t hash) {
+            return FindSlotImpl(*this, key, hash);
+        }
+
+        const Slot* FindSlot(TokenKey key, std::uint64_t hash) const {
+            return FindSlotImpl(*this, key, hash);
+        }
+
+        // Вставляет ключ, которого нет в шарде; место под него уже есть
+        void Place(TokenKey key, std::uint64_t hash, Value&& value) {
+            const size_t mask = slots.size() - 1;
+            size_t i = Probe(hash) & mask;
+            while (slots[i].state == SlotState::FULL) {
+                i = (i + 1) & mask;
+            }
+            if (slots[i].state == SlotState::EMPTY) {
+                ++used;
+            }
+            slots[i] = {key, SlotState::FULL, std::move(value)};
+            ++size;
+        }
+
+        void Rehash(size_t capacity) {
+            std::vector<Slot> old = std::exchange(slots, std::vector<Slot>(capacity));
+            size = 0;
+            used = 0;
+            for (Slot& slot : old) {
+                if (slot.state == SlotState::FULL) {
+                    Place(slot.key, Hash(slot.key), std::move(slot.value));
+                }
+            }
+        }
+    };
+
+    constexpr static size_t MIN_SHARD_CAPACITY = 16;
+
+    // Токены случайны, но приходят от клиента, поэтому биты перемешиваются
+    static std::uint64_t Hash(TokenKey key) {
+        std::uint64_t h = key.hi ^ std::rotl(key.lo, 32) ^ 0x9E3779B97F4A7C15ull;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return h ^ (h >> 31);
+    }
+
+    // Младшие биты хеша выбирают шард, старшие - слот внутри шарда
+    static size_t Probe(std::uint64_t hash) {
+        return static_cast<size_t>(hash >> 16);
+    }
+
+    Shard& GetShard(std::uint64_t hash) {
+        return shards_[hash & (shard_count_ - 1)];
+    }
+
+    const Shard& GetShard(std::uint64_t hash) const {
+        return shards_[hash & (shard_count_ - 1)];
+    }
+
+    size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace token_table
@@ -164,6 +164,7 @@ class GameState {
       self.stateLoaded = true;
       self._startGame();
     });
+    this._openStream();
     this._syncPlayers(function() {
       self.playersLoaded = true;
       self._startGame();
@@ -178,7 +179,14 @@ class GameState {
     if (!this.started)
       return false;
 
-    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
+    if (this.stream !== undefined) {
+      if (this.streamedState !== undefined) {
+        this._setDesiredState(this.streamedState);
+        this.streamedState = undefined;
+        this._applyDesiredState();
+      }
+    }
+    else if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
       this.requestInstantUpdate = false;
       this._updateState(function() {
         self._applyDesiredState();
@@ -207,6 +215,13 @@ class GameState {
 
   _pressKey(keys, then) {
     const self = this;
+    if (this.stream !== undefined) {
+      this.stream.send(JSON.stringify({
+        move: keys
+      }));
+      then();
+      return;
+    }
     $.post({
       url: '/api/v1/game/player/action',
       dataType: 'json',
@@ -390,21 +405,83 @@ class GameState {
     return abandonedLoot;
   }
 
+  // The server sends only what changed after the last received tick,
+  // so the full state is assembled here from the deltas
   _updateState(then) {
     let self = this;
+    if (self.serverState === undefined) {
+      // The first full state is fetched in the compact binary form
+      fetch('/api/v1/game/state', {
+        headers: {
+          'Authorization': 'Bearer ' + Cookies.get('authToken'),
+          'Accept': BINARY_STATE_TYPE
+        }
+      }).then(function(response) {
+        return response.arrayBuffer();
+      }).then(function(buffer) {
+        self.serverState = decodeBinaryState(buffer);
+        self._setDesiredState(self.serverState);
+        then();
+      });
+      return;
+    }
     $.get({
-      url: '/api/v1/game/state',
+      url: '/api/v1/game/state?since=' + self.serverState.tick,
       dataType: 'json',
       beforeSend: function(xhr) {
         xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
       }
     }).done(function(x){
-      self.desiredState = x;
-      self.stateTime = performance.now();
+      const state = self.serverState;
+      if (x.full) {
+        state.players = {};
+        state.lostObjects = {};
+      }
+      Object.assign(state.players, x.players);
+      for (const id of x.removedPlayers) {
+        delete state.players[id];
+      }
+      Object.assign(state.lostObjects, x.lostObjects);
+      for (const id of x.removedLostObjects) {
+        delete state.lostObjects[id];
+      }
+      state.tick = x.tick;
+      self._setDesiredState(state);
       then();
     })
   }
 
+  _setDesiredState(state) {
+    // Rendering modifies the player objects, so it gets its own copies
+    const players = {};
+    Object.entries(state.players).forEach(([id, player]) => {
+      players[id] = Object.assign({}, player);
+    });
+    this.desiredState = {players: players, lostObjects: Object.assign({}, state.lostObjects)};
+    this.stateTime = performance.now();
+  }
+
+  // The server pushes the session state after every tick. Until the socket
+  // is open, or after it is closed, the state is polled over HTTP
+  _openStream() {
+    const self = this;
+    if (typeof WebSocket === 'undefined') {
+      return;
+    }
+    const scheme = window.location.protocol === 'https:' ? 'wss://' : 'ws://';
+    const stream = new WebSocket(scheme + window.location.host + '/api/v1/game/stream?token=' + Cookies.get('authToken'));
+    stream.onopen = function() {
+      self.stream = stream;
+    };
+    stream.onmessage = function(event) {
+      self.streamedState = JSON.parse(event.data);
+    };
+    stream.onclose = function() {
+      self.stream = undefined;
+      self.streamedState = undefined;
+    };
+  }
+
   _interpolateRotation(old_pos, new_pos) {
     const pi = Math.PI;
     const rot_speed = pi / 300;
@@ -0,0 +1,46 @@
+// Decodes the binary game state served for
+// Accept: application/vnd.dogstory.state (see src/binary_encoder.h)
+// into the same shape as the JSON state, plus the tick it was taken at
+// in the "<session>.<version>" form that ?since= expects.
+const BINARY_STATE_TYPE = 'application/vnd.dogstory.state';
+
+function decodeBinaryState(buffer) {
+  const view = new DataView(buffer);
+  const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3));
+  if (magic !== 'DSST') {
+    throw new Error('Unknown state format');
+  }
+  const readUint64 = function(offset) {
+    return view.getUint32(offset, true) + view.getUint32(offset + 4, true) * 4294967296;
+  };
+
+  const state = {tick: readUint64(4) + '.' + readUint64(12), players: {}, lostObjects: {}};
+  const dogCount = view.getUint32(20, true);
+  const lootCount = view.getUint32(24, true);
+  let offset = 28;
+  for (let i = 0; i < dogCount; ++i) {
+    const id = readUint64(offset);
+    const bagSize = view.getUint16(offset + 30, true);
+    const bag = [];
+    for (let j = 0; j < bagSize; ++j) {
+      const item = offset + 32 + j * 8;
+      bag.push({id: view.getInt32(item, true), type: view.getInt32(item + 4, true)});
+    }
+    state.players[id] = {
+      pos: [view.getFloat32(offset + 8, true), view.getFloat32(offset + 12, true)],
+      speed: [view.getFloat32(offset + 16, true), view.getFloat32(offset + 20, true)],
+      score: view.getInt32(offset + 24, true),
+      dir: String.fromCharCode(view.getUint8(offset + 28)),
+      bag: bag
+    };
+    offset += 32 + bagSize * 8;
+  }
+  for (let i = 0; i < lootCount; ++i) {
+    state.lostObjects[view.getInt32(offset, true)] = {
+      type: view.getInt32(offset + 4, true),
+      pos: [view.getFloat32(offset + 8, true), view.getFloat32(offset + 12, true)]
+    };
+    offset += 16;
+  }
+  return state;
+}
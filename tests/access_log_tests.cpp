@@ -0,0 +1,95 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/access_log.h"
+
+using namespace std::literals;
+using access_log::Logger;
+
+namespace {
+
+std::vector<std::string> Lines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in{text};
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+const auto LOCALHOST = boost::asio::ip::make_address("127.0.0.1");
+
+}  // namespace
+
+TEST_CASE("Access log formats records in the writer thread in the Boost.Log layout") {
+    std::ostringstream out;
+    Logger logger{out};
+    logger.LogRequest(LOCALHOST, "/api/v1/game/state"sv, "GET"sv);
+    logger.LogResponse(LOCALHOST, 3ms, 200, "application/json"sv);
+    logger.WriteLine(R"({"message":"server started"})"s);
+    logger.Stop();
+
+    const auto lines = Lines(out.str());
+    REQUIRE(lines.size() == 3);
+    CHECK(lines[0] == R"({"message":"server started"})"s);
+    CHECK(lines[1].starts_with(R"({"timestamp":")"));
+    CHECK(lines[1].ends_with(R"(","data":{"ip":"127.0.0.1","URI":"/api/v1/game/state","method":"GET"},"message":"request received"})"));
+    CHECK(lines[2].ends_with(R"(","data":{"ip":"127.0.0.1","response_time":3,"code":200,"content_type":"application/json"},"message":"response sent"})"));
+    CHECK(logger.GetStats().written == 2);
+}
+
+TEST_CASE("Access log samples every n-th request of a thread") {
+    std::ostringstream out;
+    Logger logger{out, {.sample_rate = 4}};
+    int sampled = 0;
+    for (int i = 0; i < 100; ++i) {
+        sampled += logger.Sample();
+    }
+    CHECK(sampled == 25);
+    logger.SetSampleRate(0);
+    CHECK(logger.Sample());
+}
+
+TEST_CASE("Full rings drop records instead of blocking and the drop is reported") {
+    std::ostringstream out;
+    Logger logger{out, {.ring_capacity = 4, .flush_period = 1h}};
+    for (int i = 0; i < 10; ++i) {
+        logger.LogRequest(LOCALHOST, "/"sv, "GET"sv);
+    }
+    logger.Flush();
+    CHECK(logger.GetStats().written == 4);
+    CHECK(logger.GetStats().dropped == 6);
+    CHECK(out.str().find(R"({"data":{"dropped":6},"message":"log records dropped"})") != std::string::npos);
+
+    // Каждый поток пишет в своё кольцо
+    std::thread other{[&logger] {
+        logger.LogRequest(LOCALHOST, "/other"sv, "GET"sv);
+    }};
+    other.join();
+    logger.LogRequest(LOCALHOST, "/"sv, "GET"sv);
+    logger.Stop();
+    CHECK(logger.GetStats().written == 6);
+}
+
+TEST_CASE("Access log cost on the request path", "[.][benchmark]") {
+    std::ostringstream out;
+    Logger logger{out, {.ring_capacity = 1 << 16}};
+    BENCHMARK("LogRequest + LogResponse") {
+        logger.LogRequest(LOCALHOST, "/api/v1/game/state?since=1234"sv, "GET"sv);
+        logger.LogResponse(LOCALHOST, 1ms, 200, "application/json"sv);
+    };
+    BENCHMARK("synchronous formatting into a stream") {
+        std::ostringstream line;
+        line << R"({"timestamp":")" << std::chrono::system_clock::now().time_since_epoch().count()
+             << R"(","data":{"ip":")" << LOCALHOST.to_string() << R"(","URI":"/api/v1/game/state?since=1234","method":"GET"}})" << '\n';
+        out << line.str() << std::flush;
+    };
+}
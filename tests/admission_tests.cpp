@@ -0,0 +1,124 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/admission.h"
+#include "../src/token_table.h"
+
+using namespace std::literals;
+using admission::AdmissionControl;
+using admission::Clock;
+using admission::Priority;
+using admission::QueueMonitor;
+using admission::RateLimiter;
+
+namespace {
+
+std::string MakeToken(std::uint64_t n) {
+    return token_table::FormatToken({n, n * 31});
+}
+
+}  // namespace
+
+TEST_CASE("Queue monitor counts waiting tasks and smooths their wait") {
+    QueueMonitor queue;
+    const auto first = queue.Enqueue();
+    const auto second = queue.Enqueue();
+    CHECK(queue.Depth() == 2);
+    CHECK(queue.Enqueued() == 2);
+
+    queue.Start(first - 80ms);
+    CHECK(queue.Depth() == 1);
+    CHECK(queue.Wait() >= 10ms);
+    CHECK(queue.MaxWait() >= 80ms);
+
+    queue.Start(second);
+    CHECK(queue.Depth() == 0);
+    CHECK(queue.Wait() < 80ms);
+}
+
+TEST_CASE("Admission control sheds low priority work first and never sheds critical work") {
+    QueueMonitor queue;
+    AdmissionControl control{queue, {.shed_depth = 2, .shed_wait = 1h, .max_depth = 4}};
+    CHECK(control.Admit(Priority::LOW));
+
+    std::vector<Clock::time_point> waiting;
+    for (int i = 0; i < 2; ++i) {
+        waiting.push_back(queue.Enqueue());
+    }
+    CHECK_FALSE(control.Admit(Priority::LOW));
+    CHECK(control.Admit(Priority::NORMAL));
+
+    for (int i = 0; i < 2; ++i) {
+        waiting.push_back(queue.Enqueue());
+    }
+    CHECK_FALSE(control.Admit(Priority::NORMAL));
+    CHECK(control.Admit(Priority::CRITICAL));
+    CHECK(control.Shed() == 2);
+
+    for (auto enqueued : waiting) {
+        queue.Start(enqueued);
+    }
+    CHECK(control.Admit(Priority::LOW));
+}
+
+TEST_CASE("Admission control sheds low priority work when tasks wait too long") {
+    QueueMonitor queue;
+    AdmissionControl control{queue, {.shed_depth = 100, .shed_wait = 10ms}};
+    const auto waiting = queue.Enqueue();
+    for (int i = 0; i < 32; ++i) {
+        queue.Start(queue.Enqueue() - 1s);
+    }
+    CHECK(queue.Depth() == 1);
+    CHECK_FALSE(control.Admit(Priority::LOW));
+    CHECK(control.Admit(Priority::NORMAL));
+
+    // Очередь опустела: всплеск больше не мешает запросам LOW, даже без новых задач в strand
+    queue.Start(waiting);
+    CHECK(queue.Depth() == 0);
+    CHECK(queue.Wait() == Clock::duration::zero());
+    CHECK(control.Admit(Priority::LOW));
+
+    // Следующий запрос после всплеска начинает с нулевого ожидания
+    const auto next = queue.Enqueue();
+    CHECK(queue.Wait() == Clock::duration::zero());
+    CHECK(control.Admit(Priority::LOW));
+    queue.Start(next);
+}
+
+TEST_CASE("Rate limiter allows a burst and refills at the configured rate") {
+    RateLimiter limiter{{.rate = 10.0, .burst = 3.0}};
+    const auto token = MakeToken(1);
+    const auto other = MakeToken(2);
+    const auto now = Clock::now();
+
+    for (int i = 0; i < 3; ++i) {
+        CHECK(limiter.TryAcquire(token, now));
+    }
+    CHECK_FALSE(limiter.TryAcquire(token, now));
+    CHECK(limiter.TryAcquire(other, now));
+    CHECK(limiter.Limited() == 1);
+
+    CHECK(limiter.TryAcquire(token, now + 100ms));
+    CHECK_FALSE(limiter.TryAcquire(token, now + 100ms));
+    // Корзина не копит больше burst запросов
+    for (int i = 0; i < 3; ++i) {
+        CHECK(limiter.TryAcquire(token, now + 1h));
+    }
+    CHECK_FALSE(limiter.TryAcquire(token, now + 1h));
+}
+
+TEST_CASE("Rate limiter is disabled by zero rate and ignores malformed tokens") {
+    RateLimiter disabled{{}};
+    CHECK_FALSE(disabled.IsEnabled());
+    for (int i = 0; i < 10; ++i) {
+        CHECK(disabled.TryAcquire(MakeToken(1)));
+    }
+
+    RateLimiter limiter{{.rate = 1.0, .burst = 1.0}};
+    for (int i = 0; i < 10; ++i) {
+        CHECK(limiter.TryAcquire("not a token"sv));
+    }
+}
@@ -0,0 +1,102 @@
+#include <array>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/api_router.h"
+
+using namespace std::literals;
+using api_router::QueryParams;
+using api_router::Route;
+
+namespace {
+
+enum class Endpoint {
+    MAPS,
+    JOIN,
+    STATE,
+    RECORDS,
+    RECORDS_RANK
+};
+
+constexpr api_router::Router ROUTER{std::array{
+    Route<Endpoint>{"/api/v1/maps"sv, Endpoint::MAPS, "GET, HEAD"sv, true},
+    Route<Endpoint>{"/api/v1/game/join"sv, Endpoint::JOIN, "POST"sv},
+    Route<Endpoint>{"/api/v1/game/state"sv, Endpoint::STATE, "GET, HEAD"sv},
+    Route<Endpoint>{"/api/v1/game/records"sv, Endpoint::RECORDS, "GET, HEAD"sv},
+    Route<Endpoint>{"/api/v1/game/records/rank"sv, Endpoint::RECORDS_RANK, "GET, HEAD"sv}
+}};
+
+}  // namespace
+
+TEST_CASE("Router finds endpoints by path ignoring the query and a trailing slash") {
+    const auto state = ROUTER.Find("/api/v1/game/state/?since=5"sv);
+    REQUIRE(state);
+    CHECK(state->route->endpoint == Endpoint::STATE);
+    CHECK(state->query == "since=5"sv);
+    CHECK(state->parameter.empty());
+
+    const auto rank = ROUTER.Find("/api/v1/game/records/rank?name=Rex"sv);
+    REQUIRE(rank);
+    CHECK(rank->route->endpoint == Endpoint::RECORDS_RANK);
+
+    CHECK_FALSE(ROUTER.Find("/api/v1/game/stat"sv));
+    CHECK_FALSE(ROUTER.Find("/api/v1/game/state/x"sv));
+    CHECK_FALSE(ROUTER.Find("/api/v2/maps"sv));
+}
+
+TEST_CASE("Router passes one trailing segment to routes with a parameter") {
+    const auto catalog = ROUTER.Find("/api/v1/maps"sv);
+    REQUIRE(catalog);
+    CHECK(catalog->parameter.empty());
+
+    const auto map = ROUTER.Find("/api/v1/maps/map1/"sv);
+    REQUIRE(map);
+    CHECK(map->route->endpoint == Endpoint::MAPS);
+    CHECK(map->parameter == "map1"sv);
+
+    CHECK_FALSE(ROUTER.Find("/api/v1/maps/map1/roads"sv));
+    CHECK_FALSE(ROUTER.Find("/api/v1/game/join/x"sv));
+}
+
+TEST_CASE("Allowed methods come from the route table") {
+    const auto join = ROUTER.Find("/api/v1/game/join"sv);
+    REQUIRE(join);
+    CHECK(join->Allows("POST"sv));
+    CHECK_FALSE(join->Allows("GET"sv));
+    const auto state = ROUTER.Find("/api/v1/game/state"sv);
+    REQUIRE(state);
+    CHECK(state->Allows("GET"sv));
+    CHECK(state->Allows("HEAD"sv));
+    CHECK_FALSE(state->Allows("HEA"sv));
+    CHECK_FALSE(state->Allows("POST"sv));
+}
+
+TEST_CASE("Query parameters are found in any order without decoding") {
+    const QueryParams params{"maxItems=10&start=20&flag&name=a%20b&start=30"sv};
+    CHECK(params.Find("start"sv) == "20"sv);
+    CHECK(params.Find("maxItems"sv) == "10"sv);
+    CHECK(params.Find("flag"sv) == ""sv);
+    CHECK(params.Find("name"sv) == "a%20b"sv);
+    CHECK_FALSE(params.Find("max"sv));
+    CHECK_FALSE(params.Find("items"sv));
+    CHECK_FALSE(QueryParams{""sv}.Find("start"sv));
+}
+
+TEST_CASE("Route lookup time", "[.][benchmark]") {
+    BENCHMARK("perfect hash") {
+        return ROUTER.Find("/api/v1/game/records/rank?name=Rex"sv).has_value();
+    };
+    BENCHMARK("if-chain over a copied target") {
+        std::string target{"/api/v1/game/records/rank?name=Rex"sv};
+        target = target.substr(0, target.find('?'));
+        for (const auto path : {"/api/v1/maps"sv, "/api/v1/game/join"sv, "/api/v1/game/state"sv,
+                                "/api/v1/game/records"sv, "/api/v1/game/records/rank"sv}) {
+            if (target == path) {
+                return true;
+            }
+        }
+        return false;
+    };
+}
@@ -0,0 +1,116 @@
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/binary_encoder.h"
+#include "../src/snapshot.h"
+#include "../src/json_encoder.h"
+
+using namespace std::literals;
+using model::SessionSnapshot;
+
+namespace {
+
+void FillSnapshot(SessionSnapshot& snapshot, int dogs) {
+    snapshot.session_serial = 3;
+    snapshot.version = 42;
+    for (int i = 0; i < dogs; ++i) {
+        std::vector<std::pair<int, int>> bag;
+        for (int j = 0; j < i % 4; ++j) {
+            bag.emplace_back(i * 10 + j, j % 3);
+        }
+        snapshot.dogs.push_back({model::Dog::Id{static_cast<std::uint64_t>(i)}, "dog"s + std::to_string(i),
+            i * 0.5, 10.25 - i * 0.125, i % 2 ? 1.5 : 0.0, 0.0, "URDL"s.substr(i % 4, 1), std::move(bag), i * 7});
+    }
+    for (int i = 0; i < dogs / 2; ++i) {
+        snapshot.lost_objects.push_back({i, i % 3, i * 0.75, i * 0.5});
+    }
+}
+
+// Читает числа little-endian из закодированного состояния
+class Reader {
+public:
+    explicit Reader(const std::string& data)
+        : data_{data} {
+    }
+
+    template <typename T>
+    T Get() {
+        if constexpr (std::is_floating_point_v<T>) {
+            return std::bit_cast<T>(Get<snapshot::detail::UnsignedOfSize<T>>());
+        } else {
+            T value;
+            std::memcpy(&value, data_.data() + offset_, sizeof(value));
+            offset_ += sizeof(value);
+            return snapshot::detail::ToLittleEndian(value);
+        }
+    }
+
+    size_t Offset() const {
+        return offset_;
+    }
+
+private:
+    const std::string& data_;
+    size_t offset_ = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Binary state has the documented fixed layout") {
+    SessionSnapshot snapshot;
+    FillSnapshot(snapshot, 4);
+    const std::string data = binary_encoder::GameStateToBinary(snapshot);
+    CHECK(data.size() == binary_encoder::HEADER_SIZE + 4 * binary_encoder::DOG_SIZE
+        + (0 + 1 + 2 + 3) * binary_encoder::BAG_ITEM_SIZE + 2 * binary_encoder::LOOT_SIZE);
+    REQUIRE(data.substr(0, 4) == binary_encoder::MAGIC);
+
+    Reader reader{data};
+    reader.Get<std::uint32_t>();
+    CHECK(reader.Get<std::uint64_t>() == 3);
+    CHECK(reader.Get<std::uint64_t>() == 42);
+    CHECK(reader.Get<std::uint32_t>() == 4);
+    CHECK(reader.Get<std::uint32_t>() == 2);
+    for (const auto& dog : snapshot.dogs) {
+        CHECK(reader.Get<std::uint64_t>() == *dog.id);
+        CHECK(reader.Get<float>() == static_cast<float>(dog.x));
+        CHECK(reader.Get<float>() == static_cast<float>(dog.y));
+        CHECK(reader.Get<float>() == static_cast<float>(dog.dx));
+        CHECK(reader.Get<float>() == static_cast<float>(dog.dy));
+        CHECK(reader.Get<std::int32_t>() == dog.score);
+        CHECK(reader.Get<std::uint8_t>() == static_cast<std::uint8_t>(dog.dir.front()));
+        reader.Get<std::uint8_t>();
+        REQUIRE(reader.Get<std::uint16_t>() == dog.bag.size());
+        for (const auto& [id, type] : dog.bag) {
+            CHECK(reader.Get<std::int32_t>() == id);
+            CHECK(reader.Get<std::int32_t>() == type);
+        }
+    }
+    for (const auto& item : snapshot.lost_objects) {
+        CHECK(reader.Get<std::int32_t>() == item.id);
+        CHECK(reader.Get<std::int32_t>() == item.type);
+        CHECK(reader.Get<float>() == static_cast<float>(item.x));
+        CHECK(reader.Get<float>() == static_cast<float>(item.y));
+    }
+    CHECK(reader.Offset() == data.size());
+}
+
+TEST_CASE("Binary and JSON state size and encode time", "[.][benchmark]") {
+    for (int dogs : {10, 100, 1000}) {
+        SessionSnapshot snapshot;
+        FillSnapshot(snapshot, dogs);
+        std::cout << dogs << " dogs: JSON " << json_encoder::GameStateToString(snapshot).size()
+                  << " bytes, binary " << binary_encoder::GameStateToBinary(snapshot).size() << " bytes" << std::endl;
+
+        BENCHMARK("JSON, "s + std::to_string(dogs) + " dogs"s) {
+            return json_encoder::GameStateToString(snapshot);
+        };
+        BENCHMARK("binary, "s + std::to_string(dogs) + " dogs"s) {
+            return binary_encoder::GameStateToBinary(snapshot);
+        };
+    }
+}
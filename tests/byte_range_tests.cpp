@@ -0,0 +1,67 @@
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/byte_range.h"
+
+using namespace std::literals;
+using byte_range::ParsedRanges;
+using byte_range::ParseRange;
+using byte_range::Range;
+
+TEST_CASE("Range header is parsed into inclusive ranges clipped to the body") {
+    const auto parsed = ParseRange("bytes=0-99, 950-, -30, 990-2000"sv, 1000);
+    REQUIRE(parsed.status == ParsedRanges::Status::SATISFIABLE);
+    CHECK(parsed.ranges == std::vector<Range>{{0, 99}, {950, 999}});
+    CHECK(parsed.ranges.front().Size() == 100);
+
+    CHECK(ParseRange("bytes=-5000"sv, 1000).ranges == std::vector<Range>{{0, 999}});
+    CHECK(ParseRange("bytes=500-"sv, 1000).ranges == std::vector<Range>{{500, 999}});
+}
+
+TEST_CASE("Overlapping and adjacent ranges are sorted and merged") {
+    CHECK(ParseRange("bytes=500-599,0-9,10-19,550-700,-100"sv, 1000).ranges
+        == std::vector<Range>{{0, 19}, {500, 700}, {900, 999}});
+    CHECK(ParseRange("bytes=20-29,0-9"sv, 1000).ranges == std::vector<Range>{{0, 9}, {20, 29}});
+    CHECK(ParseRange("bytes=0-4,5-9"sv, 10).ranges == std::vector<Range>{{0, 9}});
+}
+
+TEST_CASE("Ranges longer than the body in total are ignored") {
+    std::string repeated = "bytes=0-"s;
+    for (size_t i = 1; i < byte_range::MAX_RANGES; ++i) {
+        repeated += ",0-"s;
+    }
+    CHECK(ParseRange(repeated, 1000).status == ParsedRanges::Status::IGNORED);
+    CHECK(ParseRange("bytes=0-599,400-999"sv, 1000).status == ParsedRanges::Status::IGNORED);
+    CHECK(ParseRange("bytes=0-499,400-899"sv, 1000).ranges == std::vector<Range>{{0, 899}});
+}
+
+TEST_CASE("Malformed or foreign Range headers are ignored") {
+    for (auto header : {"items=0-1"sv, "bytes="sv, "bytes=5"sv, "bytes=9-3"sv, "bytes=a-b"sv, "bytes=0-1,x"sv, "bytes=-"sv}) {
+        INFO(header);
+        CHECK(ParseRange(header, 1000).status == ParsedRanges::Status::IGNORED);
+    }
+    std::string too_many = "bytes=0-0"s;
+    for (size_t i = 1; i <= byte_range::MAX_RANGES; ++i) {
+        too_many += ","s + std::to_string(i) + "-"s + std::to_string(i);
+    }
+    CHECK(ParseRange(too_many, 1000).status == ParsedRanges::Status::IGNORED);
+}
+
+TEST_CASE("Ranges outside the body are unsatisfiable") {
+    CHECK(ParseRange("bytes=1000-1200"sv, 1000).status == ParsedRanges::Status::UNSATISFIABLE);
+    CHECK(ParseRange("bytes=-0"sv, 1000).status == ParsedRanges::Status::UNSATISFIABLE);
+    CHECK(ParseRange("bytes=0-10"sv, 0).status == ParsedRanges::Status::UNSATISFIABLE);
+    // Достаточно одного попадающего диапазона
+    CHECK(ParseRange("bytes=2000-,0-0"sv, 1000).ranges == std::vector<Range>{{0, 0}});
+}
+
+TEST_CASE("Multipart body carries every range with its Content-Range") {
+    const std::string content = "0123456789"s;
+    CHECK(byte_range::ContentRange({2, 4}, content.size()) == "bytes 2-4/10"s);
+    CHECK(byte_range::MakeMultipartBody(content, {{0, 1}, {7, 9}}, "text/plain"sv, "XYZ"sv)
+        == "\r\n--XYZ\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/10\r\n\r\n01"
+           "\r\n--XYZ\r\nContent-Type: text/plain\r\nContent-Range: bytes 7-9/10\r\n\r\n789"
+           "\r\n--XYZ--\r\n"s);
+}
@@ -2,6 +2,8 @@
 
 #include <cmath>
 #include <functional>
+#include <random>
+#include <tuple>
 #include <sstream>
 
 #include <catch2/catch_test_macros.hpp>
@@ -236,4 +238,80 @@ TEST_CASE("Two gatherers moving diagonally and perpendicular, item achievable y
     CHECK_THAT(events[0].time, WithinAbs(0.4375, 1e-10));
     CHECK_THAT(events[1].sq_distance, WithinAbs(0.0, 1e-10));
     CHECK_THAT(events[1].time, WithinAbs(0.5, 1e-10));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Item grid finds the same events as the full search") {
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<double> coord(-50, 50);
+    std::uniform_real_distribution<double> step(-5, 5);
+    std::uniform_real_distribution<double> width(0, 0.5);
+
+    std::vector<Item> items;
+    ItemGrid grid;
+    for (size_t i = 0; i < 1000; ++i) {
+        items.push_back({{coord(gen), coord(gen)}, width(gen)});
+        grid.Insert(i, items.back());
+    }
+    std::vector<Gatherer> gatherers;
+    for (size_t i = 0; i < 100; ++i) {
+        geom::Point2D start{coord(gen), coord(gen)};
+        gatherers.push_back({start, {start.x + step(gen), start.y + step(gen)}, width(gen)});
+    }
+    // один собиратель пересекает всю карту
+    gatherers.push_back({{-60, -60}, {60, 60}, 0.3});
+
+    TestVectorItemGathererProvider provider{items, gatherers};
+    auto expected = FindGatherEvents(provider);
+    auto actual = FindGatherEvents(gatherers, {&grid});
+    const auto by_ids = [](const GatheringEvent& l, const GatheringEvent& r) {
+        return std::tie(l.gatherer_id, l.item_id) < std::tie(r.gatherer_id, r.item_id);
+    };
+    std::sort(expected.begin(), expected.end(), by_ids);
+    std::sort(actual.begin(), actual.end(), by_ids);
+    CHECK(!expected.empty());
+    CHECK_THAT(actual, EqualsRange(expected, CompareEvents()));
+}
+
+TEST_CASE("Item grid layers and erasing") {
+    ItemGrid loot;
+    ItemGrid offices;
+    loot.Insert(7, {{1, 0}, 0.});
+    loot.Insert(8, {{3, 0}, 0.});
+    offices.Insert(0, {{2, 0}, 0.25});
+    loot.Erase(8);
+    CHECK(loot.ItemsCount() == 1);
+
+    std::vector<Gatherer> gatherers{{{0, 0}, {4, 0}, 0.3}};
+    auto events = FindGatherEvents(gatherers, {&loot, &offices});
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].layer == 0);
+    CHECK(events[0].item_id == 7);
+    CHECK_THAT(events[0].time, WithinAbs(0.25, 1e-10));
+    CHECK(events[1].layer == 1);
+    CHECK(events[1].item_id == 0);
+    CHECK_THAT(events[1].time, WithinAbs(0.5, 1e-10));
+}
+
+TEST_CASE("All supported kernels find the same events") {
+    std::mt19937 gen{7};
+    std::uniform_real_distribution<double> coord(-10, 10);
+    std::uniform_real_distribution<double> width(0, 1);
+
+    ItemBatch items;
+    for (size_t i = 0; i < 1003; ++i) {
+        items.Add({{coord(gen), coord(gen)}, width(gen)});
+    }
+    for (size_t g = 0; g < 20; ++g) {
+        Gatherer gatherer{{coord(gen), coord(gen)}, {coord(gen), coord(gen)}, width(gen)};
+        std::vector<GatheringEvent> expected;
+        CollectItems(gatherer, g, items, expected, Kernel::SCALAR);
+        for (Kernel kernel : {Kernel::SSE2, Kernel::AVX2}) {
+            if (!IsKernelSupported(kernel)) {
+                continue;
+            }
+            std::vector<GatheringEvent> actual;
+            CollectItems(gatherer, g, items, actual, kernel);
+            CHECK_THAT(actual, EqualsRange(expected, CompareEvents()));
+        }
+    }
+}
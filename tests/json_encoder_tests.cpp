@@ -0,0 +1,224 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/json_encoder.h"
+
+using namespace std::literals;
+using model::SessionSnapshot;
+
+namespace json = boost::json;
+
+namespace {
+
+constexpr int BENCHMARK_DOGS = 200;
+constexpr int BENCHMARK_LOOT = 100;
+
+// Снимок не перемещается, поэтому создаётся в куче, как в GameSession
+std::shared_ptr<const SessionSnapshot> MakeSnapshot() {
+    auto snapshot = std::make_shared<SessionSnapshot>();
+    snapshot->dogs = {
+        {model::Dog::Id{1}, "Rex"s, 0.0, 2.5, 0.0, -1.5, "U"s, {{3, 0}, {4, 2}}, 15},
+        {model::Dog::Id{12}, "Bim \"Black\""s, 10.25, 0.0, 0.0, 0.0, "L"s, {}, 0}
+    };
+    snapshot->lost_objects = {{3, 1, 1.0, 0.5}, {17, 0, 40.0, 7.75}};
+    return snapshot;
+}
+
+std::shared_ptr<const SessionSnapshot> MakeBenchmarkSnapshot() {
+    auto snapshot = std::make_shared<SessionSnapshot>();
+    for (int i = 0; i < BENCHMARK_DOGS; ++i) {
+        snapshot->dogs.push_back({model::Dog::Id{static_cast<std::uint64_t>(i)}, "dog"s + std::to_string(i),
+                                  i * 0.5, i * 0.25, 0.0, 1.5, "U"s, {{i, i % 3}}, i * 10});
+    }
+    for (int i = 0; i < BENCHMARK_LOOT; ++i) {
+        snapshot->lost_objects.push_back({i, i % 3, i * 0.75, i * 0.5});
+    }
+    return snapshot;
+}
+
+// Ответы в том виде, в каком их собирал json_encoder до JsonWriter: дерево boost::json
+json::value BaselineBag(const std::vector<std::pair<int, int>>& bag) {
+    json::array json_bag;
+    for (const auto& item : bag) {
+        json_bag.push_back({{"id", item.first}, {"type", item.second}});
+    }
+    return json_bag;
+}
+
+json::value BaselineState(const SessionSnapshot& snapshot) {
+    json::object players;
+    for (const auto& dog : snapshot.dogs) {
+        players[std::to_string(*dog.id)] = json::object{
+            {"pos", json::array{dog.x, dog.y}},
+            {"speed", json::array{dog.dx, dog.dy}},
+            {"dir", dog.dir},
+            {"bag", BaselineBag(dog.bag)},
+            {"score", dog.score}
+        };
+    }
+    json::object lost_objects;
+    for (const auto& item : snapshot.lost_objects) {
+        lost_objects[std::to_string(item.id)] = json::object{
+            {"type", item.type},
+            {"pos", json::array{item.x, item.y}}
+        };
+    }
+    return json::object{{"players", players}, {"lostObjects", lost_objects}};
+}
+
+json::value BaselineSession(const SessionSnapshot& snapshot) {
+    json::object session;
+    for (const auto& dog : snapshot.dogs) {
+        session[std::to_string(*dog.id)] = json::object{{"name", dog.name}};
+    }
+    return session;
+}
+
+json::value BaselineRecords(const std::vector<leaderboard::Record>& records) {
+    json::array result;
+    for (const auto& record : records) {
+        result.push_back({{"name", record.name}, {"score", record.score}, {"playTime", record.play_time_ms / 1000.0}});
+    }
+    return result;
+}
+
+double ToDouble(const json::value& value) {
+    if (value.is_double()) {
+        return value.get_double();
+    }
+    return value.is_int64() ? static_cast<double>(value.get_int64()) : static_cast<double>(value.get_uint64());
+}
+
+// Сравнивает деревья JSON; числа сравниваются по значению: JsonWriter пишет 10.0 как 10,
+// и разбор даёт целое там, где в дереве было дробное
+bool SameJson(const json::value& lhs, const json::value& rhs) {
+    const bool lhs_number = lhs.is_double() || lhs.is_int64() || lhs.is_uint64();
+    const bool rhs_number = rhs.is_double() || rhs.is_int64() || rhs.is_uint64();
+    if (lhs_number || rhs_number) {
+        return lhs_number && rhs_number && ToDouble(lhs) == ToDouble(rhs);
+    }
+    if (lhs.is_object() && rhs.is_object()) {
+        const auto& lhs_object = lhs.get_object();
+        const auto& rhs_object = rhs.get_object();
+        if (lhs_object.size() != rhs_object.size()) {
+            return false;
+        }
+        for (const auto& member : lhs_object) {
+            const auto* other = rhs_object.if_contains(member.key());
+            if (!other || !SameJson(member.value(), *other)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (lhs.is_array() && rhs.is_array()) {
+        const auto& lhs_array = lhs.get_array();
+        const auto& rhs_array = rhs.get_array();
+        if (lhs_array.size() != rhs_array.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < lhs_array.size(); ++i) {
+            if (!SameJson(lhs_array[i], rhs_array[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return lhs == rhs;
+}
+
+}  // namespace
+
+TEST_CASE("Json encoder state has the baseline shape") {
+    const auto shared_snapshot = MakeSnapshot();
+    const auto& snapshot = *shared_snapshot;
+    const auto encoded = json_encoder::GameStateToString(snapshot);
+    INFO(encoded);
+    CHECK(SameJson(json::parse(encoded), BaselineState(snapshot)));
+    CHECK(SameJson(json::parse(json_encoder::GameStateToString(SessionSnapshot{})), BaselineState(SessionSnapshot{})));
+}
+
+TEST_CASE("Json encoder session and player have the baseline shape") {
+    const auto shared_snapshot = MakeSnapshot();
+    const auto& snapshot = *shared_snapshot;
+    const auto session = json_encoder::GameSessionToString(snapshot);
+    INFO(session);
+    CHECK(SameJson(json::parse(session), BaselineSession(snapshot)));
+
+    const model::Player player{"Rex"s, model::Player::Token{"0123456789abcdef0123456789abcdef"s}};
+    const auto encoded = json_encoder::PlayerToString(player);
+    INFO(encoded);
+    CHECK(SameJson(json::parse(encoded), json::object{
+        {"authToken", *player.GetToken()},
+        {"playerId", *player.GetDog()->GetId()}
+    }));
+}
+
+TEST_CASE("Json encoder records have the baseline shape") {
+    const std::vector<leaderboard::Record> records{{"a"s, "Rex"s, 30, 61500}, {"b"s, "Bim"s, 0, 0}, {"c"s, "Tuz"s, 5, 1001}};
+    const auto encoded = json_encoder::RecordsToString(records);
+    INFO(encoded);
+    CHECK(SameJson(json::parse(encoded), BaselineRecords(records)));
+    CHECK(SameJson(json::parse(json_encoder::RecordsToString({})), json::array{}));
+}
+
+// Точный текст проверяется без разбора JSON
+TEST_CASE("State, session and records are encoded exactly") {
+    const auto shared_snapshot = MakeSnapshot();
+    const auto& snapshot = *shared_snapshot;
+    CHECK(json_encoder::GameStateToString(snapshot)
+        == R"({"players":{)"
+           R"("1":{"pos":[0,2.5],"speed":[0,-1.5],"dir":"U","bag":[{"id":3,"type":0},{"id":4,"type":2}],"score":15},)"
+           R"("12":{"pos":[10.25,0],"speed":[0,0],"dir":"L","bag":[],"score":0}},)"
+           R"("lostObjects":{"3":{"type":1,"pos":[1,0.5]},"17":{"type":0,"pos":[40,7.75]}}})"s);
+    CHECK(json_encoder::GameStateToString(SessionSnapshot{}) == R"({"players":{},"lostObjects":{}})"s);
+    CHECK(json_encoder::GameSessionToString(snapshot) == R"({"1":{"name":"Rex"},"12":{"name":"Bim \"Black\""}})"s);
+
+    const model::Player player{"Rex"s, model::Player::Token{"0123456789abcdef0123456789abcdef"s}};
+    CHECK(json_encoder::PlayerToString(player)
+        == R"({"authToken":"0123456789abcdef0123456789abcdef","playerId":)"s + std::to_string(*player.GetDog()->GetId()) + "}"s);
+
+    // playTime - в секундах, как раньше
+    CHECK(json_encoder::RecordsToString({{"a"s, "Rex"s, 30, 61500}, {"b"s, "Bim"s, 0, 0}, {"c"s, "Tuz"s, 5, 1001}})
+        == R"([{"name":"Rex","score":30,"playTime":61.5},{"name":"Bim","score":0,"playTime":0},)"
+           R"({"name":"Tuz","score":5,"playTime":1.001}])"s);
+    CHECK(json_encoder::RecordsToString({}) == "[]"s);
+}
+
+TEST_CASE("Action body of the usual shape is parsed without a JSON tree") {
+    CHECK(json_encoder::TryParseMove(R"({"move":"L"})"sv) == "L"sv);
+    CHECK(json_encoder::TryParseMove(" { \"move\" :\t\"U\" }\r\n"sv) == "U"sv);
+    CHECK(json_encoder::TryParseMove(R"({"move": ""})"sv) == ""sv);
+    // Направление проверяет вызывающий
+    CHECK(json_encoder::TryParseMove(R"({"move": "X"})"sv) == "X"sv);
+}
+
+TEST_CASE("Other action bodies are left to the full parser") {
+    for (const auto body : {R"({"move": "LR"})"sv, R"({"mov": "L"})"sv, R"({"move": "\""})"sv,
+                            R"({"move": "L", "x": 1})"sv, R"({"x": 1, "move": "L"})"sv, R"({"move": "L"} x)"sv,
+                            R"({"move": "L")"sv, R"({"move": 1})"sv, ""sv}) {
+        INFO(body);
+        CHECK_FALSE(json_encoder::TryParseMove(body));
+    }
+}
+
+TEST_CASE("Json encoder state versus the baseline tree encoder", "[.][benchmark]") {
+    const auto snapshot = MakeBenchmarkSnapshot();
+    CHECK(SameJson(json::parse(json_encoder::GameStateToString(*snapshot)), BaselineState(*snapshot)));
+
+    BENCHMARK("boost::json tree + ostringstream") {
+        std::ostringstream res;
+        res << BaselineState(*snapshot);
+        return res.str();
+    };
+    BENCHMARK("json_encoder::GameStateToString") {
+        return json_encoder::GameStateToString(*snapshot);
+    };
+}
@@ -0,0 +1,45 @@
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/json_writer.h"
+
+using namespace std::literals;
+using json_writer::JsonWriter;
+
+TEST_CASE("Json writer places commas between members and elements") {
+    JsonWriter writer;
+    writer.BeginObject()
+        .KeyFragment(R"("a":)").BeginArray().Int(1).Int(-2).BeginObject().EndObject().BeginArray().EndArray().EndArray()
+        .Key("b").Bool(true)
+        .Key(std::uint64_t{7}).Null()
+        .EndObject();
+    CHECK(writer.View() == R"({"a":[1,-2,{},[]],"b":true,"7":null})");
+}
+
+TEST_CASE("Json writer escapes keys and strings") {
+    JsonWriter writer;
+    writer.BeginObject().Key("q\"k").String("line\nquote\" back\\ tab\t \x01 мир").EndObject();
+    CHECK(writer.View() == R"({"q\"k":"line\nquote\" back\\ tab\t \u0001 мир"})");
+}
+
+TEST_CASE("Json writer prints numbers in the shortest round-trip form") {
+    JsonWriter writer;
+    writer.BeginArray()
+        .Double(0.5).Double(10.0).Double(0.1).Double(-3.25)
+        .Double(std::numeric_limits<double>::quiet_NaN()).Double(std::numeric_limits<double>::infinity())
+        .Int(std::numeric_limits<std::int64_t>::min()).Int(std::numeric_limits<std::uint64_t>::max())
+        .EndArray();
+    CHECK(writer.View() == "[0.5,10,0.1,-3.25,null,null,-9223372036854775808,18446744073709551615]"s);
+}
+
+TEST_CASE("Json writer can be reused after Release") {
+    JsonWriter writer;
+    writer.BeginArray().Int(1).EndArray();
+    CHECK(writer.Release() == "[1]"s);
+    CHECK(writer.View().empty());
+    writer.BeginObject().KeyFragment(R"("x":)").Raw("[1,2]").EndObject();
+    CHECK(writer.Release() == R"({"x":[1,2]})"s);
+}
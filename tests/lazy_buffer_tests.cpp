@@ -0,0 +1,112 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/lazy_buffer.h"
+#include "../src/json_encoder.h"
+#include "../src/model.h"
+
+using namespace std::literals;
+using lazy_buffer::LazyBuffer;
+
+namespace {
+
+// Снимок сессии из dogs собак, как его публикует GameSession после тика
+std::shared_ptr<const model::SessionSnapshot> MakeSnapshot(int tick, int dogs) {
+    auto snapshot = std::make_shared<model::SessionSnapshot>();
+    snapshot->version = tick;
+    for (int i = 0; i < dogs; ++i) {
+        snapshot->dogs.push_back({model::Dog::Id{static_cast<std::uint64_t>(i)}, "dog"s + std::to_string(i),
+                                  tick * 0.1 + i, i * 0.5, 0.0, 1.0, "U"s, {}, i});
+    }
+    return snapshot;
+}
+
+}  // namespace
+
+TEST_CASE("Lazy buffer is computed once for concurrent readers") {
+    LazyBuffer buffer;
+    std::atomic<int> encodes{0};
+    std::vector<std::thread> readers;
+    std::vector<LazyBuffer::Buffer> results(8);
+    for (size_t i = 0; i < results.size(); ++i) {
+        readers.emplace_back([&, i] {
+            results[i] = buffer.Get([&] {
+                ++encodes;
+                std::this_thread::sleep_for(10ms);
+                return "state"s;
+            });
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(encodes == 1);
+    for (const auto& result : results) {
+        REQUIRE(result);
+        CHECK(result == results.front());
+        CHECK(*result == "state");
+    }
+}
+
+TEST_CASE("Lazy buffer retries after a failed computation") {
+    LazyBuffer buffer;
+    CHECK_THROWS_AS(buffer.Get([]() -> std::string {
+        throw std::runtime_error("encode failed");
+    }), std::runtime_error);
+    CHECK(*buffer.Get([] {
+        return "ok"s;
+    }) == "ok");
+}
+
+TEST_CASE("Lazy buffer benchmark", "[.][benchmark]") {
+    constexpr int DOGS = 100;
+    constexpr int POLLERS = 10;
+    constexpr int TICKS = 200;
+
+    // 10 игроков опрашивают состояние каждый тик: сколько раз оно кодируется
+    for (const bool shared : {false, true}) {
+        std::atomic<int> encodes{0};
+        std::atomic<int> polls{0};
+        const auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < TICKS; ++tick) {
+            const auto snapshot = MakeSnapshot(tick, DOGS);
+            std::vector<std::thread> pollers;
+            for (int p = 0; p < POLLERS; ++p) {
+                pollers.emplace_back([&] {
+                    const auto encode = [&] {
+                        ++encodes;
+                        return json_encoder::GameStateToString(*snapshot);
+                    };
+                    const auto body = shared ? snapshot->encoded_state.Get(encode) : std::make_shared<const std::string>(encode());
+                    polls += !body->empty();
+                });
+            }
+            for (auto& poller : pollers) {
+                poller.join();
+            }
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << (shared ? "shared buffer: "sv : "encode per poll: "sv)
+                  << polls / elapsed.count() << " polls/s, " << encodes / elapsed.count() << " encodes/s" << std::endl;
+        CHECK(encodes == (shared ? TICKS : TICKS * POLLERS));
+    }
+
+    const auto snapshot = MakeSnapshot(1, DOGS);
+    BENCHMARK("poll with encoding") {
+        return json_encoder::GameStateToString(*snapshot).size();
+    };
+    BENCHMARK("poll of shared buffer") {
+        return snapshot->encoded_state.Get([&snapshot] {
+            return json_encoder::GameStateToString(*snapshot);
+        })->size();
+    };
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/leaderboard.h"
+
+using namespace std::literals;
+using leaderboard::Leaderboard;
+using leaderboard::Record;
+
+namespace {
+
+// Порядок из запроса к базе: ORDER BY score DESC, play_time_ms, name
+bool RecordLess(const Record& l, const Record& r) {
+    return std::tie(r.score, l.play_time_ms, l.name) < std::tie(l.score, r.play_time_ms, r.name);
+}
+
+std::vector<Record> MakeRecords(size_t count, unsigned seed) {
+    std::mt19937 rng{seed};
+    std::uniform_int_distribution<int> score{0, 50};
+    std::uniform_int_distribution<int> play_time{0, 20};
+    std::uniform_int_distribution<int> name{0, 30};
+    std::vector<Record> records;
+    for (size_t i = 0; i < count; ++i) {
+        records.push_back({"id"s + std::to_string(i), "dog"s + std::to_string(name(rng)), score(rng), play_time(rng) * 1000});
+    }
+    return records;
+}
+
+}  // namespace
+
+TEST_CASE("Leaderboard pages match sorted records") {
+    auto records = MakeRecords(500, 7);
+    Leaderboard board;
+    board.Load({records.begin(), records.begin() + 250});
+    for (auto it = records.begin() + 250; it != records.end(); ++it) {
+        board.Add(*it);
+    }
+    CHECK(board.IsLoaded());
+    REQUIRE(board.Size() == records.size());
+
+    std::stable_sort(records.begin(), records.end(), RecordLess);
+    for (size_t start : {0, 1, 99, 250, 480, 500, 600}) {
+        const auto page = board.GetPage(start, 100);
+        const size_t expected = start < records.size() ? std::min<size_t>(100, records.size() - start) : 0;
+        REQUIRE(page.records.size() == expected);
+        for (size_t i = 0; i < page.records.size(); ++i) {
+            const auto& got = page.records[i];
+            const auto& want = records[start + i];
+            CHECK(std::tie(got.score, got.play_time_ms, got.name) == std::tie(want.score, want.play_time_ms, want.name));
+        }
+    }
+}
+
+TEST_CASE("Leaderboard finds best rank of a player") {
+    Leaderboard board;
+    board.Add({"1", "Rex", 10, 5000});
+    board.Add({"2", "Bim", 30, 1000});
+    board.Add({"3", "Rex", 20, 3000});
+    board.Add({"4", "Ace", 20, 3000});
+
+    const auto rex = board.FindBestRank("Rex");
+    REQUIRE(rex);
+    CHECK(rex->place == 3);
+    CHECK(rex->record.id == "3");
+    CHECK(rex->record.score == 20);
+
+    const auto bim = board.FindBestRank("Bim");
+    REQUIRE(bim);
+    CHECK(bim->place == 1);
+
+    CHECK_FALSE(board.FindBestRank("Tuzik"));
+}
+
+TEST_CASE("Leaderboard skips records it already knows") {
+    Leaderboard board;
+    CHECK_FALSE(board.IsLoaded());
+    board.Add({"a", "Rex", 10, 1000});
+    const auto version = board.GetPage(0, 10).version;
+
+    // Запись успела попасть в базу до загрузки таблицы
+    board.Load({{"a", "Rex", 10, 1000}, {"b", "Bim", 5, 1000}});
+    CHECK(board.IsLoaded());
+    CHECK(board.Size() == 2);
+
+    const auto page = board.GetPage(0, 10);
+    CHECK(page.version != version);
+    REQUIRE(page.records.size() == 2);
+    CHECK(page.records[0].name == "Rex");
+    CHECK(page.records[1].name == "Bim");
+}
+
+TEST_CASE("Leaderboard versions start from the process start time") {
+    const auto before = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    Leaderboard board;
+    const auto version = board.GetPage(0, 10).version;
+    // Таблица пуста, но версия уже не 0: после перезапуска старые ETag не совпадут
+    CHECK(version > 0);
+    CHECK(version <= static_cast<std::uint64_t>(before));
+    board.Add({"a", "Rex", 10, 1000});
+    CHECK(board.GetPage(0, 10).version == version + 1);
+}
+
+TEST_CASE("Leaderboard benchmark", "[.][benchmark]") {
+    Leaderboard board;
+    board.Load(MakeRecords(1'000'000, 42));
+
+    BENCHMARK("page of 100 from the middle") {
+        return board.GetPage(500'000, 100).records.size();
+    };
+    BENCHMARK("rank of a player") {
+        return board.FindBestRank("dog17")->place;
+    };
+}
@@ -0,0 +1,134 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/metrics.h"
+
+using namespace std::literals;
+using metrics::Histogram;
+
+namespace {
+
+bool Contains(const std::string& text, std::string_view line) {
+    return text.find(line) != std::string::npos;
+}
+
+}  // namespace
+
+TEST_CASE("Counter sums the shards of all threads") {
+    metrics::Counter counter;
+    constexpr int THREADS = 4;
+    constexpr int ADDS = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < ADDS; ++j) {
+                counter.Add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(counter.Value() == THREADS * ADDS);
+}
+
+TEST_CASE("Histogram buckets cover values without gaps and within the relative error") {
+    for (std::uint64_t value : {0ull, 1ull, 2ull, 3ull, 4ull, 5ull, 7ull, 100ull, 1000ull, 123456ull, 1ull << 39}) {
+        const size_t index = Histogram::BucketIndex(value);
+        REQUIRE(index < Histogram::BUCKETS);
+        CHECK(value < Histogram::BucketLimit(index));
+        if (index > 0) {
+            CHECK(value >= Histogram::BucketLimit(index - 1));
+        }
+        // Ширина интервала не больше 1 / SUB_BUCKETS его нижней границы
+        if (index >= Histogram::SUB_BUCKETS) {
+            const auto lower = Histogram::BucketLimit(index - 1);
+            CHECK((Histogram::BucketLimit(index) - lower) * Histogram::SUB_BUCKETS <= lower);
+        }
+    }
+    CHECK(Histogram::BucketIndex(std::uint64_t{1} << 50) == Histogram::BUCKETS - 1);
+}
+
+TEST_CASE("Histogram collects counts and sum") {
+    Histogram histogram;
+    histogram.Record(100ms);
+    histogram.Record(std::uint64_t{5});
+    histogram.Record(-1ms);
+    const auto snapshot = histogram.Collect();
+    CHECK(snapshot.count == 3);
+    CHECK(snapshot.sum == 100005);
+    CHECK(snapshot.buckets[0] == 1);
+    CHECK(snapshot.buckets[Histogram::BucketIndex(100000)] == 1);
+}
+
+TEST_CASE("Histogram table writes Prometheus histograms per row and code") {
+    metrics::HistogramTable table{"route"s, {"/api/v1/maps"s, "static"s}};
+    table.Record(0, 200, 1ms);
+    table.Record(0, 200, 3ms);
+    table.Record(1, 404, 20ms);
+    table.Record(1, 1000, 1s);
+
+    std::string out;
+    table.Write(out, "http_duration_seconds"sv, "Request time"sv);
+    CHECK(out.starts_with("# HELP http_duration_seconds Request time\n# TYPE http_duration_seconds histogram\n"sv));
+    CHECK(Contains(out, "http_duration_seconds_bucket{route=\"/api/v1/maps\",code=\"200\",le=\"+Inf\"} 2\n"sv));
+    CHECK(Contains(out, "http_duration_seconds_bucket{route=\"/api/v1/maps\",code=\"200\",le=\"6.4e-05\"} 0\n"sv));
+    CHECK(Contains(out, "http_duration_seconds_sum{route=\"/api/v1/maps\",code=\"200\"} 0.004\n"sv));
+    CHECK(Contains(out, "http_duration_seconds_count{route=\"static\",code=\"404\"} 1\n"sv));
+    CHECK(Contains(out, "http_duration_seconds_count{route=\"static\",code=\"599\"} 1\n"sv));
+    CHECK_FALSE(Contains(out, "code=\"500\""sv));
+
+    // Счётчики интервалов не убывают
+    std::uint64_t previous = 0;
+    size_t pos = 0;
+    const auto prefix = "http_duration_seconds_bucket{route=\"/api/v1/maps\",code=\"200\","sv;
+    while ((pos = out.find(prefix, pos)) != std::string::npos) {
+        const size_t value = out.find("} "sv, pos) + 2;
+        const auto count = std::stoull(out.substr(value, out.find('\n', value) - value));
+        CHECK(count >= previous);
+        previous = count;
+        pos = value;
+    }
+    CHECK(previous == 2);
+}
+
+TEST_CASE("Registry writes game metrics") {
+    metrics::Registry registry;
+    registry.sessions.Set(2);
+    registry.dogs.Set(7);
+    registry.db_write_errors.Add();
+    registry.tick_duration.Record(2ms);
+    std::string out;
+    registry.Write(out);
+    CHECK(Contains(out, "dog_story_sessions 2\n"sv));
+    CHECK(Contains(out, "dog_story_dogs 7\n"sv));
+    CHECK(Contains(out, "dog_story_lost_objects 0\n"sv));
+    CHECK(Contains(out, "dog_story_db_write_errors_total 1\n"sv));
+    CHECK(Contains(out, "dog_story_tick_duration_seconds_count 1\n"sv));
+    CHECK(Contains(out, "dog_story_db_write_duration_seconds_bucket{le=\"+Inf\"} 0\n"sv));
+}
+
+TEST_CASE("Metric updates on the hot path", "[.][benchmark]") {
+    metrics::Counter counter;
+    Histogram histogram;
+    metrics::HistogramTable table{"route"s, {"a"s}};
+    std::uint64_t value = 0;
+
+    BENCHMARK("Counter::Add") {
+        counter.Add();
+    };
+    BENCHMARK("Histogram::Record") {
+        histogram.Record(++value & 0xFFFFF);
+    };
+    BENCHMARK("HistogramTable::Record") {
+        table.Record(0, 200, std::chrono::microseconds{++value & 0xFFFFF});
+    };
+    BENCHMARK("Clock::now") {
+        return metrics::Clock::now();
+    };
+}
@@ -0,0 +1,395 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model.h"
+#include "../src/json_encoder.h"
+
+using namespace std::literals;
+using model::Dog;
+using model::SessionSnapshot;
+
+namespace {
+
+using DogState = SessionSnapshot::DogState;
+using LootState = SessionSnapshot::LootState;
+
+DogState MakeDog(std::uint64_t id, double x) {
+    return {Dog::Id{id}, "dog"s + std::to_string(id), x, 0.0, 0.0, 0.0, "U"s, {}, 0};
+}
+
+std::vector<std::uint64_t> DogIds(const SessionSnapshot::Delta& delta) {
+    std::vector<std::uint64_t> ids;
+    for (const auto* dog : delta.dogs) {
+        ids.push_back(*dog->id);
+    }
+    return ids;
+}
+
+std::vector<int> LootIds(const SessionSnapshot::Delta& delta) {
+    std::vector<int> ids;
+    for (const auto* loot : delta.spawned_loot) {
+        ids.push_back(loot->id);
+    }
+    return ids;
+}
+
+std::vector<int> LootIds(const SessionSnapshot& snapshot) {
+    std::vector<int> ids;
+    for (const auto& loot : snapshot.lost_objects) {
+        ids.push_back(loot.id);
+    }
+    return ids;
+}
+
+model::Map MakeMap() {
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+    map.map_dog_speed_ = -1.0;
+    map.map_bag_capacity_ = -1;
+    map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+    map.BuildRoadIndex();
+    map.AddLootTypes(boost::json::array{boost::json::object{{"name", "key"}, {"value", 10}}});
+    return map;
+}
+
+// Сессия на дороге из MakeMap, снимки которой публикует сама GameSession
+struct TestSession {
+    model::Map map = MakeMap();
+    model::GameSession session{&map, 1.0, 10, 60.0};
+    // Сессия копирует генератор при первом тике, поэтому вероятность задаётся через ссылку
+    double loot_chance = 0.0;
+    loot_gen::LootGenerator loot_generator{1ms, 1.0, [this] {
+        return loot_chance;
+    }};
+
+    std::shared_ptr<Dog> AddDog(std::string name) {
+        auto dog = std::make_shared<Dog>(std::move(name));
+        session.AddDog(dog, false);
+        return dog;
+    }
+
+    std::vector<std::shared_ptr<Dog>> Tick(int time_delta) {
+        return session.Tick(time_delta, loot_generator);
+    }
+
+    // Тик, в котором появляется по трофею на каждую собаку
+    void SpawnLoot() {
+        loot_chance = 1.0;
+        Tick(1);
+        loot_chance = 0.0;
+    }
+
+    // Собака проходит дорогу вдоль обеих половин её ширины и подбирает все трофеи
+    void CollectAllLoot(Dog& dog) {
+        for (const double y : {-0.2, 0.2}) {
+            dog.x = -0.4;
+            dog.y = y;
+            dog.dx = 20.0;
+            dog.dy = 0.0;
+            Tick(1000);
+        }
+    }
+
+    // Собака стоит почти всё время до пенсии и уходит на неё в следующем тике
+    std::vector<std::shared_ptr<Dog>> Retire(Dog& dog) {
+        dog.time_standing = 60 * 1000 - 1;
+        return Tick(1);
+    }
+
+    std::shared_ptr<const SessionSnapshot> Snapshot() const {
+        return session.GetSnapshot();
+    }
+};
+
+void SetupGame(model::Game& game) {
+    game.AddMap(MakeMap());
+    game.game_dog_speed_ = 2.0;
+    game.game_bag_capacity_ = 3;
+    game.dog_retirement_time = 60.0;
+}
+
+// Текстовый архив Boost, который записывал сервер до двоичных снимков: три игрока на map1,
+// скорость 2, рюкзак на 3 предмета, строка подключения к базе в сессии
+constexpr std::string_view BASELINE_TEXT_STATE =
+    "22 serialization::archive 18 0 0 0 0 3 0 0 0 0 0 32 83c54f56193a55fe1fb43775b6aac54b 0 1 5 1 0\n"
+    "0 0 0 4 map1 0 1 8 1 0\n"
+    "1 0.00000000000000000e+00 2.50000000000000000e-01 2.00000000000000000e+00 0.00000000000000000e+00 1 R "
+    "2.00000000000000000e+00 3 0 0 1 0 0 0 0 0 0 3 0 0 1 3 Rex 0 0 32 83c54f56193a55fe1fb43775b6aac54b "
+    "32 975d468e3205ed01f9b8165c6975e79c 5\n"
+    "2 4 map1 8\n"
+    "3 3.00000000000000000e+00 2.50000000000000000e-01 2.00000000000000000e+00 0.00000000000000000e+00 1 R "
+    "2.00000000000000000e+00 3 1 0 2 0 20 3 3 5 Tuzik 0 0 32 975d468e3205ed01f9b8165c6975e79c "
+    "32 bac854419a0e3007e3e01c3219965ac7 5\n"
+    "4 4 map1 8\n"
+    "5 1.50000000000000000e+00 2.50000000000000000e-01 2.00000000000000000e+00 0.00000000000000000e+00 1 R "
+    "2.00000000000000000e+00 3 1 0 1 1 10 3 2 3 Bim 0 0 32 bac854419a0e3007e3e01c3219965ac7 1 0\n"
+    "6 0 0 1 0 0 0 4 map1 0 0 1 1 0 1 17 1 0\n"
+    "7 2.00000000000000000e+00 3 0 0 3 0 0 0 1 8 1 2 8 5 3 8 3 0 0 0 0 0 6.00000000000000000e+01 14 postgres://old\n"sv;
+
+}  // namespace
+
+TEST_CASE("Snapshot diff finds changed, new and removed dogs and loot") {
+    SessionSnapshot previous;
+    previous.dogs = {MakeDog(1, 0.0), MakeDog(2, 0.0), MakeDog(3, 0.0)};
+    previous.lost_objects = {{1, 0, 1.0, 1.0}, {2, 0, 2.0, 2.0}};
+    SessionSnapshot current;
+    current.version = 7;
+    current.dogs = {MakeDog(1, 0.0), MakeDog(3, 0.5), MakeDog(4, 0.0)};
+    current.dogs[0].bag = {{2, 0}};
+    current.lost_objects = {{1, 0, 1.0, 1.0}, {3, 1, 3.0, 3.0}};
+
+    const auto change = model::DiffSnapshots(previous, current);
+    CHECK(change.version == 7);
+    CHECK(change.changed_dogs == std::vector<Dog::Id>{Dog::Id{1}, Dog::Id{3}, Dog::Id{4}});
+    CHECK(change.removed_dogs == std::vector<Dog::Id>{Dog::Id{2}});
+    CHECK(change.spawned_loot == std::vector<int>{3});
+    CHECK(change.removed_loot == std::vector<int>{2});
+
+    const auto same = model::DiffSnapshots(current, current);
+    CHECK(same.changed_dogs.empty());
+    CHECK(same.removed_dogs.empty());
+    CHECK(same.spawned_loot.empty());
+    CHECK(same.removed_loot.empty());
+}
+
+TEST_CASE("Session delta merges the changes after since") {
+    TestSession test;
+    const auto rex = test.AddDog("Rex"s);
+    test.AddDog("Bim"s);
+    const auto tuzik = test.AddDog("Tuzik"s);
+    test.SpawnLoot();
+    const auto first = test.Snapshot();
+    auto all_loot = LootIds(*first);
+    REQUIRE(all_loot.size() == 3);
+
+    // Рекс сдвинулся, затем пришёл Шарик и для него появился трофей, затем Шарик собрал
+    // все трофеи, а Тузик ушёл на пенсию
+    rex->x = 1.0;
+    test.session.PublishSnapshot();
+    const auto second = test.Snapshot();
+    const auto sharik = test.AddDog("Sharik"s);
+    test.SpawnLoot();
+    const auto third = test.Snapshot();
+    REQUIRE(third->lost_objects.size() == 4);
+    const int new_loot = third->lost_objects.back().id;
+    all_loot.push_back(new_loot);
+    test.CollectAllLoot(*sharik);
+    const auto collected = test.Snapshot();
+    REQUIRE(collected->lost_objects.empty());
+    REQUIRE(test.Retire(*tuzik).size() == 1);
+    const auto last = test.Snapshot();
+
+    const auto delta = last->GetDelta(first->GetSince());
+    CHECK_FALSE(delta.full);
+    CHECK(DogIds(delta) == std::vector<std::uint64_t>{*rex->GetId(), *sharik->GetId()});
+    CHECK(delta.removed_dogs == std::vector<Dog::Id>{tuzik->GetId()});
+    // Трофей появился и исчез внутри окна: клиенту достаточно узнать, что его нет
+    CHECK(LootIds(delta).empty());
+    CHECK(delta.removed_loot == all_loot);
+
+    const auto recent = last->GetDelta(collected->GetSince());
+    CHECK(DogIds(recent).empty());
+    CHECK(recent.removed_dogs == std::vector<Dog::Id>{tuzik->GetId()});
+    CHECK(recent.removed_loot.empty());
+
+    const auto from_second = third->GetDelta(second->GetSince());
+    CHECK(DogIds(from_second) == std::vector<std::uint64_t>{*sharik->GetId()});
+    CHECK(LootIds(from_second) == std::vector<int>{new_loot});
+}
+
+TEST_CASE("Session delta is empty for the current version and full for unknown ones") {
+    TestSession test;
+    const auto rex = test.AddDog("Rex"s);
+    test.SpawnLoot();
+    const auto snapshot = test.Snapshot();
+
+    const auto same = snapshot->GetDelta(snapshot->GetSince());
+    CHECK_FALSE(same.full);
+    CHECK(same.dogs.empty());
+    CHECK(same.removed_dogs.empty());
+    CHECK(same.spawned_loot.empty());
+    CHECK(same.removed_loot.empty());
+
+    // since из будущего, например от прошлого запуска сервера
+    const auto ahead = snapshot->GetDelta({test.session.GetSerial(), snapshot->version + 1});
+    CHECK(ahead.full);
+    CHECK(DogIds(ahead) == std::vector<std::uint64_t>{*rex->GetId()});
+    CHECK(LootIds(ahead) == LootIds(*snapshot));
+}
+
+TEST_CASE("Session keeps the last changes and answers older since with the full state") {
+    const auto map = MakeMap();
+    model::GameSession session{&map, 1.0, 3, 60.0};
+    session.AddDog(std::make_shared<Dog>("Rex"s), false);
+    for (size_t i = 0; i < SessionSnapshot::MAX_CHANGES + 10; ++i) {
+        session.PublishSnapshot();
+    }
+    const auto snapshot = session.GetSnapshot();
+    REQUIRE(snapshot->changes.size() == SessionSnapshot::MAX_CHANGES);
+    CHECK(snapshot->changes.back()->version == snapshot->version);
+
+    const std::uint64_t oldest_covered = snapshot->version - SessionSnapshot::MAX_CHANGES;
+    CHECK_FALSE(snapshot->GetDelta({session.GetSerial(), oldest_covered}).full);
+    const auto old = snapshot->GetDelta({session.GetSerial(), oldest_covered - 1});
+    CHECK(old.full);
+    CHECK(old.dogs.size() == 1);
+
+    // Версии всех сессий начинаются с одного времени, поэтому since другой сессии узнаётся по её номеру
+    model::GameSession other{&map, 1.0, 3, 60.0};
+    other.AddDog(std::make_shared<Dog>("Bim"s), false);
+    CHECK(snapshot->GetDelta({other.GetSerial(), snapshot->version}).full);
+    CHECK_FALSE(snapshot->GetDelta(snapshot->GetSince()).full);
+}
+
+TEST_CASE("Since token carries the session serial and the snapshot version") {
+    const auto since = SessionSnapshot::Since::Parse("3.1700000000123"sv);
+    REQUIRE(since);
+    CHECK(since->session_serial == 3);
+    CHECK(since->version == 1700000000123);
+    CHECK(since->ToString() == "3.1700000000123"s);
+    CHECK_FALSE(SessionSnapshot::Since::Parse("1700000000123"sv));
+    CHECK_FALSE(SessionSnapshot::Since::Parse("3."sv));
+    CHECK_FALSE(SessionSnapshot::Since::Parse(".5"sv));
+    CHECK_FALSE(SessionSnapshot::Since::Parse("3.5x"sv));
+}
+
+TEST_CASE("Session publishes player actions once at the end of the tick") {
+    const auto map = MakeMap();
+    model::GameSession session{&map, 1.0, 3, 60.0};
+    auto dog = std::make_shared<Dog>("Rex"s);
+    session.AddDog(dog, false);
+    const loot_gen::LootGenerator no_loot{1s, 0.0};
+    const auto joined = session.GetSnapshot();
+
+    // Тик, в котором ничего не произошло, не публикует новый снимок
+    session.Tick(100, no_loot);
+    CHECK(session.GetSnapshot() == joined);
+
+    for (const auto move : {"U"s, "L"s, "R"s}) {
+        dog->ChangeDirection(move);
+        session.MarkChanged();
+    }
+    CHECK(session.GetSnapshot() == joined);
+
+    session.Tick(100, no_loot);
+    const auto ticked = session.GetSnapshot();
+    CHECK(ticked->version == joined->version + 1);
+    REQUIRE(ticked->dogs.size() == 1);
+    CHECK(ticked->dogs.front().dir == "R"s);
+    CHECK(ticked->dogs.front().x == 0.1);
+    CHECK(DogIds(ticked->GetDelta(joined->GetSince())) == std::vector<std::uint64_t>{*dog->GetId()});
+}
+
+TEST_CASE("Game state delta is encoded with removed ids") {
+    TestSession test;
+    const auto rex = test.AddDog("Rex"s);
+    test.SpawnLoot();
+    const auto bim = test.AddDog("Bim"s);
+    const auto first = test.Snapshot();
+    REQUIRE(first->lost_objects.size() == 1);
+    const int loot = first->lost_objects.front().id;
+
+    test.CollectAllLoot(*rex);
+    REQUIRE(test.Retire(*bim).size() == 1);
+    rex->x = 1.5;
+    rex->y = 0.0;
+    rex->score = 7;
+    test.session.PublishSnapshot();
+    const auto last = test.Snapshot();
+    const std::string tick = R"({"tick":")"s + last->GetSince().ToString() + R"(",)"s;
+
+    CHECK(json_encoder::GameStateDeltaToString(*last, last->GetDelta(first->GetSince()))
+        == tick + R"("full":false,)"s
+           + R"("players":{")"s + std::to_string(*rex->GetId())
+           + R"(":{"pos":[1.5,0],"speed":[0,0],"dir":"U","bag":[{"id":)"s + std::to_string(loot) + R"(,"type":0}],"score":7}},)"s
+           + R"("removedPlayers":[)"s + std::to_string(*bim->GetId()) + R"(],)"s
+           + R"("lostObjects":{},)"s
+           + R"("removedLostObjects":[)"s + std::to_string(loot) + R"(]})"s);
+    CHECK(json_encoder::GameStateDeltaToString(*last, last->GetDelta(last->GetSince()))
+        == tick + R"("full":false,"players":{},"removedPlayers":[],"lostObjects":{},"removedLostObjects":[]})"s);
+    CHECK(json_encoder::GameStateDeltaToString(*last, last->GetDelta({0, 1})).starts_with(tick + R"("full":true,)"s));
+}
+
+TEST_CASE("Game state round-trips through the binary snapshot") {
+    const auto path = std::filesystem::temp_directory_path() / "model_state_round_trip";
+    model::Game game;
+    SetupGame(game);
+    const auto* map = game.FindMap(model::Map::Id{"map1"s});
+    std::vector<std::string> tokens;
+    for (int i = 0; i < 12; ++i) {
+        auto player = game.GetPlayers().CreatePlayer("dog"s + std::to_string(i));
+        game.JoinMap(map, player);
+        auto dog = player->GetDog();
+        dog->x = i * 0.5;
+        dog->y = 0.25;
+        dog->dx = 2.0;
+        dog->dir = "R"s;
+        dog->score = i * 10;
+        dog->bag_.push_back({i, i % 3});
+        tokens.push_back(*player->GetToken());
+    }
+    model::SaveState(game, path.string());
+
+    model::Game loaded;
+    SetupGame(loaded);
+    REQUIRE(model::LoadState(loaded, path.string()));
+    std::filesystem::remove(path);
+    CHECK(loaded.GetPlayers().Size() == tokens.size());
+    // 12 собак не помещаются в одну сессию
+    const auto& sessions = loaded.game_sessions_on_map_.at(model::Map::Id{"map1"s});
+    REQUIRE(sessions.size() == 2);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const auto player = loaded.GetPlayers().FindByToken(tokens[i]);
+        REQUIRE(player);
+        const auto dog = player->GetDog();
+        CHECK(dog->GetName() == "dog"s + std::to_string(i));
+        CHECK(dog->x == i * 0.5);
+        CHECK(dog->dir == "R"s);
+        CHECK(dog->score == static_cast<int>(i) * 10);
+        CHECK(dog->bag_ == std::vector<std::pair<int, int>>{{static_cast<int>(i), static_cast<int>(i % 3)}});
+        // Собака игрока и собака сессии - один объект
+        const auto& session = player->GetSession();
+        REQUIRE(session);
+        CHECK(session->GetDogs().at(dog->GetId()) == dog);
+        CHECK(loaded.GetPlayers().FindByDogIdAndMapId(dog->GetId(), model::Map::Id{"map1"s}) == player);
+    }
+    const auto snapshot = sessions.front()->GetSnapshot();
+    CHECK(snapshot->dogs.size() == 10);
+    CHECK(snapshot->dogs.front().name == "dog0"s);
+}
+
+TEST_CASE("Game state loads a text archive written before binary snapshots") {
+    const auto path = std::filesystem::temp_directory_path() / "model_state_baseline.txt";
+    std::ofstream{path} << BASELINE_TEXT_STATE;
+
+    model::Game game;
+    SetupGame(game);
+    REQUIRE(model::LoadState(game, path.string()));
+    std::filesystem::remove(path);
+    CHECK(game.GetPlayers().Size() == 3);
+
+    const auto& sessions = game.game_sessions_on_map_.at(model::Map::Id{"map1"s});
+    REQUIRE(sessions.size() == 1);
+    CHECK(sessions.front()->dog_speed_ == 2.0);
+    CHECK(sessions.front()->GetDogs().size() == 3);
+
+    const auto rex = game.GetPlayers().FindByToken("83c54f56193a55fe1fb43775b6aac54b"sv);
+    REQUIRE(rex);
+    CHECK(rex->GetDog()->GetName() == "Rex"s);
+    CHECK(*rex->GetDog()->GetId() == 1);
+    CHECK(rex->GetSession() == sessions.front());
+    const auto tuzik = game.GetPlayers().FindByToken("975d468e3205ed01f9b8165c6975e79c"sv);
+    REQUIRE(tuzik);
+    CHECK(tuzik->GetDog()->x == 3.0);
+    CHECK(tuzik->GetDog()->score == 20);
+    CHECK(tuzik->GetDog()->bag_ == std::vector<std::pair<int, int>>{{2, 0}});
+
+    const auto snapshot = sessions.front()->GetSnapshot();
+    REQUIRE(snapshot->dogs.size() == 3);
+    CHECK(snapshot->dogs[1].name == "Bim"s);
+    CHECK(snapshot->dogs[1].score == 10);
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/parallel_for.h"
+
+SCENARIO("Parallel for") {
+    GIVEN("a poster running tasks on separate threads") {
+        std::vector<std::jthread> threads;
+        util::TaskPoster post = [&threads](std::function<void()> task) {
+            threads.emplace_back(std::move(task));
+        };
+
+        WHEN("there are many indices") {
+            THEN("every index is processed exactly once") {
+                std::vector<std::atomic<int>> calls(1000);
+                util::ParallelFor(calls.size(), [&calls](size_t i) {
+                    ++calls[i];
+                }, post, 4);
+                for (const auto& count : calls) {
+                    CHECK(count == 1);
+                }
+            }
+        }
+
+        WHEN("fn throws") {
+            THEN("exception is passed to the caller") {
+                CHECK_THROWS_AS(util::ParallelFor(10, [](size_t i) {
+                    if (i == 5) {
+                        throw std::runtime_error("tick failed");
+                    }
+                }, post, 3), std::runtime_error);
+            }
+        }
+    }
+
+    GIVEN("a poster that never runs tasks") {
+        std::vector<std::function<void()>> postponed;
+        util::TaskPoster post = [&postponed](std::function<void()> task) {
+            postponed.push_back(std::move(task));
+        };
+
+        THEN("caller processes everything itself") {
+            std::vector<int> calls(100);
+            util::ParallelFor(calls.size(), [&calls](size_t i) {
+                ++calls[i];
+            }, post, 4);
+            CHECK(std::count(calls.begin(), calls.end(), 1) == 100);
+
+            AND_THEN("late tasks do nothing") {
+                for (auto& task : postponed) {
+                    task();
+                }
+                CHECK(std::count(calls.begin(), calls.end(), 1) == 100);
+            }
+        }
+    }
+}
@@ -0,0 +1,227 @@
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/postgres.h"
+
+namespace {
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+
+/*
+ *  Заглушка сервера Postgres: принимает подключение без пароля и на каждый
+ *  запрос расширенного протокола отвечает одними и теми же строками через delay
+ */
+class StubServer {
+public:
+    StubServer(std::vector<std::vector<std::string>> rows, std::chrono::milliseconds delay)
+        : rows_{std::move(rows)}
+        , delay_{delay}
+        , acceptor_{ioc_, {net::ip::make_address("127.0.0.1"), 0}} {
+        DoAccept();
+        thread_ = std::thread{[this] {
+            ioc_.run();
+        }};
+    }
+
+    ~StubServer() {
+        ioc_.stop();
+        thread_.join();
+    }
+
+    std::string ConnInfo() const {
+        return "host=127.0.0.1 port="s + std::to_string(acceptor_.local_endpoint().port())
+            + " user=test dbname=test sslmode=disable gssencmode=disable connect_timeout=5"s;
+    }
+
+private:
+    void DoAccept() {
+        acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+            if (!ec) {
+                std::thread{&StubServer::Serve, this, std::make_shared<tcp::socket>(std::move(socket))}.detach();
+                DoAccept();
+            }
+        });
+    }
+
+    // Обслуживает соединение синхронно в отдельном потоке
+    void Serve(std::shared_ptr<tcp::socket> socket) {
+        try {
+            std::uint32_t length = ReadInt32(*socket);
+            std::string startup(length - 4, '\0');
+            net::read(*socket, net::buffer(startup));
+
+            std::string greeting;
+            AppendMessage(greeting, 'R', Int32(0));
+            AppendMessage(greeting, 'S', "server_version\0"s + "15.0\0"s);
+            AppendMessage(greeting, 'S', "client_encoding\0"s + "UTF8\0"s);
+            AppendMessage(greeting, 'K', Int32(1) + Int32(2));
+            AppendMessage(greeting, 'Z', "I"s);
+            net::write(*socket, net::buffer(greeting));
+
+            while (true) {
+                char type;
+                net::read(*socket, net::buffer(&type, 1));
+                length = ReadInt32(*socket);
+                std::string body(length - 4, '\0');
+                net::read(*socket, net::buffer(body));
+                if (type == 'X') {
+                    return;
+                }
+                if (type != 'S') {
+                    continue;
+                }
+                std::this_thread::sleep_for(delay_);
+                net::write(*socket, net::buffer(MakeResult()));
+            }
+        } catch (...) {
+        }
+    }
+
+    std::string MakeResult() const {
+        std::string result;
+        AppendMessage(result, '1', "");
+        AppendMessage(result, '2', "");
+        const size_t fields = rows_.empty() ? 0 : rows_.front().size();
+        std::string description = Int16(fields);
+        for (size_t i = 0; i < fields; ++i) {
+            description += "f"s + std::to_string(i) + '\0' + Int32(0) + Int16(0) + Int32(25) + Int16(-1) + Int32(-1) + Int16(0);
+        }
+        AppendMessage(result, 'T', description);
+        for (const auto& row : rows_) {
+            std::string data = Int16(row.size());
+            for (const auto& value : row) {
+                data += Int32(value.size()) + value;
+            }
+            AppendMessage(result, 'D', data);
+        }
+        AppendMessage(result, 'C', "SELECT "s + std::to_string(rows_.size()) + '\0');
+        AppendMessage(result, 'Z', "I"s);
+        return result;
+    }
+
+    static std::uint32_t ReadInt32(tcp::socket& socket) {
+        unsigned char bytes[4];
+        net::read(socket, net::buffer(bytes));
+        return (std::uint32_t{bytes[0]} << 24) | (std::uint32_t{bytes[1]} << 16) | (std::uint32_t{bytes[2]} << 8) | bytes[3];
+    }
+
+    static std::string Int32(std::uint32_t value) {
+        return {static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value)};
+    }
+
+    static std::string Int16(std::uint16_t value) {
+        return {static_cast<char>(value >> 8), static_cast<char>(value)};
+    }
+
+    static void AppendMessage(std::string& out, char type, const std::string& body) {
+        out += type;
+        out += Int32(body.size() + 4);
+        out += body;
+    }
+
+    std::vector<std::vector<std::string>> rows_;
+    std::chrono::milliseconds delay_;
+    net::io_context ioc_;
+    tcp::acceptor acceptor_;
+    std::thread thread_;
+};
+
+}  // namespace
+
+SCENARIO("Asynchronous Postgres connection pool") {
+    GIVEN("a slow database and a single-threaded io_context") {
+        constexpr auto DB_DELAY = 100ms;
+        StubServer server{{{"Rex", "10", "5000"}, {"Buddy", "7", "1200"}}, DB_DELAY};
+        net::io_context ioc;
+        auto pool = std::make_shared<postgres::ConnectionPool>(ioc, server.ConnInfo(), 2);
+        pool->Start();
+
+        WHEN("a query is in flight") {
+            postgres::Rows rows;
+            std::exception_ptr error;
+            Clock::time_point query_done;
+            Clock::time_point timer_fired;
+            const auto start = Clock::now();
+            pool->AsyncQuery("SELECT name, score, play_time_ms FROM retired_players LIMIT $1 OFFSET $2", {"100", "0"},
+                             [&](std::exception_ptr e, postgres::Rows r) {
+                                 error = e;
+                                 rows = std::move(r);
+                                 query_done = Clock::now();
+                             });
+            net::steady_timer timer{ioc, 10ms};
+            timer.async_wait([&](boost::system::error_code) {
+                timer_fired = Clock::now();
+            });
+            ioc.run_for(5s);
+
+            THEN("rows arrive and the thread keeps serving other work meanwhile") {
+                REQUIRE_FALSE(error);
+                REQUIRE(rows.size() == 2);
+                CHECK(rows[0] == postgres::Row{"Rex", "10", "5000"});
+                CHECK(rows[1] == postgres::Row{"Buddy", "7", "1200"});
+                CHECK(timer_fired - start < DB_DELAY);
+                CHECK(query_done - start >= DB_DELAY);
+            }
+        }
+
+        WHEN("more queries than connections are sent") {
+            constexpr int QUERIES = 6;
+            int done = 0;
+            Clock::duration max_latency{};
+            const auto start = Clock::now();
+            for (int i = 0; i < QUERIES; ++i) {
+                pool->AsyncQuery("SELECT 1", {}, [&](std::exception_ptr e, postgres::Rows) {
+                    CHECK_FALSE(e);
+                    ++done;
+                    max_latency = std::max(max_latency, Clock::now() - start);
+                });
+            }
+            ioc.run_for(5s);
+
+            THEN("they are queued and run on two connections in parallel") {
+                CHECK(done == QUERIES);
+                // три волны по два запроса
+                CHECK(max_latency >= DB_DELAY * 3);
+                CHECK(max_latency < DB_DELAY * QUERIES);
+            }
+        }
+    }
+
+    GIVEN("an unreachable database") {
+        net::io_context ioc;
+        auto pool = std::make_shared<postgres::ConnectionPool>(ioc, "host=127.0.0.1 port=1 connect_timeout=1", 1);
+        pool->Start();
+
+        THEN("queries fail instead of hanging") {
+            int failed = 0;
+            const auto query = [&] {
+                pool->AsyncQuery("SELECT 1", {}, [&](std::exception_ptr e, postgres::Rows) {
+                    failed += static_cast<bool>(e);
+                });
+            };
+            query();
+            ioc.run_for(200ms);
+            CHECK(failed == 1);
+
+            AND_THEN("while the pool waits to reconnect") {
+                query();
+                ioc.run_for(200ms);
+                CHECK(failed == 2);
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <sstream>
+#include <string>
+
+#include <boost/beast/http.hpp>
+#include <zlib.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/prepared_body.h"
+
+using namespace std::literals;
+using prepared_body::Encoding;
+
+namespace {
+
+std::string Decompress(const std::string& data, int window_bits) {
+    z_stream stream{};
+    REQUIRE(inflateInit2(&stream, window_bits) == Z_OK);
+    std::string result(1 << 20, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+    CHECK(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+    result.resize(stream.total_out);
+    inflateEnd(&stream);
+    return result;
+}
+
+std::string MakeContent() {
+    std::string content = "["s;
+    for (int i = 0; i < 1000; ++i) {
+        content += R"({"x0": )"s + std::to_string(i) + R"(, "y0": 0, "x1": 40},)"s;
+    }
+    content.back() = ']';
+    return content;
+}
+
+}  // namespace
+
+TEST_CASE("Prepared body keeps compressed variants of the same content") {
+    const std::string content = MakeContent();
+    const prepared_body::PreparedBody body{content};
+
+    CHECK(body.Get(Encoding::IDENTITY) == content);
+    CHECK(body.Get(Encoding::GZIP).size() < content.size());
+    CHECK(Decompress(body.Get(Encoding::GZIP), 15 + 16) == content);
+    CHECK(Decompress(body.Get(Encoding::DEFLATE), 15) == content);
+
+    CHECK(body.GetETag(Encoding::IDENTITY).front() == '"');
+    CHECK(body.GetETag(Encoding::IDENTITY) != body.GetETag(Encoding::GZIP));
+    CHECK(body.GetETag(Encoding::IDENTITY) == prepared_body::PreparedBody{content}.GetETag(Encoding::IDENTITY));
+    CHECK(body.GetETag(Encoding::IDENTITY) != prepared_body::PreparedBody{content + " "}.GetETag(Encoding::IDENTITY));
+}
+
+TEST_CASE("Prepared body drops variants that are not smaller") {
+    const prepared_body::PreparedBody tiny{"{}"s};
+    CHECK_FALSE(tiny.HasEncoding(Encoding::GZIP));
+    CHECK(tiny.HasEncoding(Encoding::IDENTITY));
+    CHECK(tiny.Get(Encoding::GZIP) == "{}"s);
+    CHECK(tiny.GetETag(Encoding::GZIP) == tiny.GetETag(Encoding::IDENTITY));
+
+    const prepared_body::PreparedBody uncompressed{MakeContent(), false};
+    CHECK_FALSE(uncompressed.HasEncoding(Encoding::DEFLATE));
+    CHECK(uncompressed.Get(Encoding::DEFLATE) == MakeContent());
+}
+
+TEST_CASE("Encoding is chosen by Accept-Encoding") {
+    CHECK(prepared_body::ChooseEncoding(""sv) == Encoding::IDENTITY);
+    CHECK(prepared_body::ChooseEncoding("gzip, deflate, br"sv) == Encoding::GZIP);
+    CHECK(prepared_body::ChooseEncoding("deflate"sv) == Encoding::DEFLATE);
+    CHECK(prepared_body::ChooseEncoding("gzip;q=0.5, deflate;q=0.8"sv) == Encoding::DEFLATE);
+    CHECK(prepared_body::ChooseEncoding("GZIP"sv) == Encoding::GZIP);
+    CHECK(prepared_body::ChooseEncoding("gzip;q=0"sv) == Encoding::IDENTITY);
+    CHECK(prepared_body::ChooseEncoding("*"sv) == Encoding::GZIP);
+    CHECK(prepared_body::ChooseEncoding("gzip;q=0, *"sv) == Encoding::DEFLATE);
+    CHECK(prepared_body::ChooseEncoding("br, identity"sv) == Encoding::IDENTITY);
+}
+
+TEST_CASE("Quality of a media type is found in Accept") {
+    const auto accept = "application/json, application/vnd.dogstory.state;level=1;q=0.9, text/html;q=0"sv;
+    CHECK(prepared_body::FindQuality(accept, "application/json"sv) == 1.0);
+    CHECK(prepared_body::FindQuality(accept, "APPLICATION/VND.DOGSTORY.STATE"sv) == 0.9);
+    CHECK(prepared_body::FindQuality(accept, "text/html"sv) == 0.0);
+    CHECK_FALSE(prepared_body::FindQuality(accept, "image/png"sv));
+    CHECK_FALSE(prepared_body::FindQuality(""sv, "application/json"sv));
+}
+
+TEST_CASE("If-None-Match is compared weakly") {
+    const auto etag = "\"abc\""sv;
+    CHECK(prepared_body::MatchesETag("\"abc\""sv, etag));
+    CHECK(prepared_body::MatchesETag("W/\"abc\""sv, etag));
+    CHECK(prepared_body::MatchesETag("\"x\", \"abc\""sv, etag));
+    CHECK(prepared_body::MatchesETag("*"sv, etag));
+    CHECK_FALSE(prepared_body::MatchesETag(""sv, etag));
+    CHECK_FALSE(prepared_body::MatchesETag("\"abcd\""sv, etag));
+}
+
+TEST_CASE("Shared body is written without owning the bytes") {
+    namespace http = boost::beast::http;
+    const auto body = std::make_shared<const prepared_body::PreparedBody>(MakeContent());
+
+    http::response<prepared_body::SharedBody> res{http::status::ok, 11};
+    res.body() = prepared_body::Share(body, Encoding::GZIP);
+    res.prepare_payload();
+    CHECK(res.body()->data() == body->Get(Encoding::GZIP).data());
+    CHECK(res[http::field::content_length] == std::to_string(body->Get(Encoding::GZIP).size()));
+
+    std::ostringstream out;
+    out << res;
+    const std::string written = out.str();
+    CHECK(written.ends_with(body->Get(Encoding::GZIP)));
+}
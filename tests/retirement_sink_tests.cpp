@@ -0,0 +1,219 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/retirement_sink.h"
+
+using retirement_sink::RetiredPlayer;
+using retirement_sink::RetirementSink;
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+SCENARIO("Retirement sink") {
+    std::mutex mutex;
+    std::vector<std::vector<RetiredPlayer>> batches;
+    const auto collect = [&](const std::vector<RetiredPlayer>& batch) {
+        std::lock_guard lock{mutex};
+        batches.push_back(batch);
+    };
+
+    GIVEN("a sink with small batches") {
+        RetirementSink sink{collect, 100, 4};
+
+        WHEN("records are pushed and sink is stopped") {
+            for (int i = 0; i < 10; ++i) {
+                sink.Push({"dog"s + std::to_string(i), i, i * 1000});
+            }
+            sink.Stop();
+
+            THEN("all records are written in order, in batches no larger than the limit") {
+                std::vector<RetiredPlayer> written;
+                for (const auto& batch : batches) {
+                    CHECK(batch.size() <= 4);
+                    written.insert(written.end(), batch.begin(), batch.end());
+                }
+                REQUIRE(written.size() == 10);
+                for (int i = 0; i < 10; ++i) {
+                    CHECK(written[i].name == "dog"s + std::to_string(i));
+                    CHECK(written[i].score == i);
+                }
+                const auto stats = sink.GetStats();
+                CHECK(stats.pushed == 10);
+                CHECK(stats.written == 10);
+                CHECK(stats.queue_size == 0);
+            }
+        }
+    }
+
+    GIVEN("a writer that fails once") {
+        bool failed = false;
+        RetirementSink sink{[&](const std::vector<RetiredPlayer>& batch) {
+            if (!failed) {
+                failed = true;
+                throw retirement_sink::RetryableError("connection lost");
+            }
+            collect(batch);
+        }};
+        sink.Push({"dog", 1, 0});
+        sink.Stop();
+
+        THEN("batch is retried") {
+            const auto stats = sink.GetStats();
+            CHECK(stats.failed_attempts == 1);
+            CHECK(stats.written == 1);
+            CHECK(batches.size() == 1);
+        }
+    }
+
+    GIVEN("a writer that always fails") {
+        RetirementSink sink{[](const std::vector<RetiredPlayer>&) {
+            throw retirement_sink::RetryableError("database is down");
+        }};
+        sink.Push({"dog", 1, 0});
+        sink.Stop();
+
+        THEN("stop gives up after a few attempts and the record is counted as dropped") {
+            CHECK(sink.GetStats().dropped == 1);
+        }
+    }
+
+    GIVEN("a writer that fails on a bad batch") {
+        int attempts = 0;
+        RetirementSink sink{[&attempts](const std::vector<RetiredPlayer>&) {
+            ++attempts;
+            throw std::runtime_error("duplicate key value violates unique constraint");
+        }};
+        sink.Push({"dog", 1, 0});
+        sink.Stop();
+
+        THEN("the batch is not retried") {
+            CHECK(attempts == 1);
+            CHECK(sink.GetStats().dropped == 1);
+        }
+    }
+
+    GIVEN("a database that is down for a long time") {
+        std::atomic<int> failures = 0;
+        RetirementSink sink{[&](const std::vector<RetiredPlayer>& batch) {
+            // Пять неудачных попыток подряд раньше отбрасывали пачку
+            if (++failures <= 5) {
+                throw retirement_sink::RetryableError("database is down");
+            }
+            collect(batch);
+        }, 8, 4};
+
+        WHEN("ticks keep retiring players") {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < 1000; ++i) {
+                sink.Push({"dog", i, 0});
+            }
+            const auto push_time = std::chrono::steady_clock::now() - start;
+            CHECK(push_time < 100ms);
+
+            THEN("the batch is retried until the database is back and no record is lost") {
+                while (sink.GetStats().written < 1000 && std::chrono::steady_clock::now() - start < 10s) {
+                    std::this_thread::sleep_for(10ms);
+                }
+                const auto stats = sink.GetStats();
+                CHECK(stats.pushed == 1000);
+                CHECK(stats.written == 1000);
+                CHECK(stats.dropped == 0);
+                CHECK(stats.failed_attempts == 5);
+                CHECK(stats.max_queue_size > 8);
+            }
+            sink.Stop();
+        }
+    }
+
+    GIVEN("a sink with a spill directory") {
+        const fs::path spill_dir = fs::temp_directory_path() / "retirement_sink_test";
+        fs::remove_all(spill_dir);
+        std::atomic<bool> down = true;
+        const auto write_when_up = [&](const std::vector<RetiredPlayer>& batch) {
+            if (down) {
+                throw retirement_sink::RetryableError("database is down");
+            }
+            collect(batch);
+        };
+
+        WHEN("the database is down while the queue overflows") {
+            RetirementSink sink{write_when_up, 2, 2, spill_dir};
+            for (int i = 0; i < 20; ++i) {
+                sink.Push({"dog"s + std::to_string(i), i, 0});
+            }
+            const auto start = std::chrono::steady_clock::now();
+            while (sink.GetStats().queue_size > 2 && std::chrono::steady_clock::now() - start < 5s) {
+                std::this_thread::sleep_for(10ms);
+            }
+
+            THEN("records over the capacity go to disk and are written first when the database is back") {
+                auto stats = sink.GetStats();
+                CHECK(stats.queue_size <= 2);
+                CHECK(stats.spilled >= 18);
+                CHECK(stats.spill_files > 0);
+
+                down = false;
+                while (sink.GetStats().written < 20 && std::chrono::steady_clock::now() - start < 10s) {
+                    std::this_thread::sleep_for(10ms);
+                }
+                stats = sink.GetStats();
+                CHECK(stats.written == 20);
+                CHECK(stats.dropped == 0);
+                CHECK(stats.spill_files == 0);
+
+                std::vector<RetiredPlayer> written;
+                for (const auto& batch : batches) {
+                    written.insert(written.end(), batch.begin(), batch.end());
+                }
+                REQUIRE(written.size() == 20);
+                for (int i = 0; i < 20; ++i) {
+                    CHECK(written[i].name == "dog"s + std::to_string(i));
+                }
+            }
+            down = false;
+            sink.Stop();
+        }
+
+        WHEN("the server stops while the database is down") {
+            {
+                RetirementSink sink{write_when_up, 100, 4, spill_dir};
+                for (int i = 0; i < 10; ++i) {
+                    sink.Push({"dog\n"s + std::to_string(i), i, i * 1000, "id"s + std::to_string(i)});
+                }
+                sink.Stop();
+                const auto stats = sink.GetStats();
+                CHECK(stats.written == 0);
+                CHECK(stats.dropped == 0);
+                CHECK(stats.spill_files > 0);
+            }
+
+            THEN("the next sink writes the records left on disk") {
+                down = false;
+                RetirementSink sink{write_when_up, 100, 4, spill_dir};
+                sink.Stop();
+                const auto stats = sink.GetStats();
+                CHECK(stats.written == 10);
+                CHECK(stats.spill_files == 0);
+
+                std::vector<RetiredPlayer> written;
+                for (const auto& batch : batches) {
+                    written.insert(written.end(), batch.begin(), batch.end());
+                }
+                REQUIRE(written.size() == 10);
+                for (int i = 0; i < 10; ++i) {
+                    CHECK(written[i].name == "dog\n"s + std::to_string(i));
+                    CHECK(written[i].score == i);
+                    CHECK(written[i].play_time_ms == i * 1000);
+                    CHECK(written[i].id == "id"s + std::to_string(i));
+                }
+            }
+        }
+        fs::remove_all(spill_dir);
+    }
+}
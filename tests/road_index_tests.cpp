@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/road_index.h"
+
+namespace {
+
+constexpr double ROAD_WIDTH = 0.8;
+
+struct TestRoad {
+    int x0, y0, x1, y1;
+};
+
+// Исходный алгоритм из GameSession::Tick: перебор всех дорог карты
+road_index::Area FindAreaByLoop(const std::vector<TestRoad>& roads, double x, double y) {
+    road_index::Area area;
+    for (const auto& road : roads) {
+        double min_x = std::min(road.x0, road.x1) - ROAD_WIDTH / 2;
+        double max_x = std::max(road.x0, road.x1) + ROAD_WIDTH / 2;
+        double min_y = std::min(road.y0, road.y1) - ROAD_WIDTH / 2;
+        double max_y = std::max(road.y0, road.y1) + ROAD_WIDTH / 2;
+        if (min_x <= x && x <= max_x && min_y <= y && y <= max_y) {
+            area.min_x = std::min(area.min_x, min_x);
+            area.max_x = std::max(area.max_x, max_x);
+            area.min_y = std::min(area.min_y, min_y);
+            area.max_y = std::max(area.max_y, max_y);
+        }
+    }
+    return area;
+}
+
+road_index::RoadIndex MakeIndex(const std::vector<TestRoad>& roads) {
+    road_index::RoadIndex index{ROAD_WIDTH};
+    for (const auto& road : roads) {
+        if (road.y0 == road.y1) {
+            index.AddHorizontal(road.y0, road.x0, road.x1);
+        } else {
+            index.AddVertical(road.x0, road.y0, road.y1);
+        }
+    }
+    index.Build();
+    return index;
+}
+
+// Сетка дорог: горизонтальные и вертикальные улицы, разрезанные на кварталы
+std::vector<TestRoad> MakeCity(size_t road_count, std::mt19937& gen) {
+    std::vector<TestRoad> roads;
+    std::uniform_int_distribution<int> coord(0, static_cast<int>(road_count) + 10);
+    std::uniform_int_distribution<int> length(1, 30);
+    while (roads.size() < road_count) {
+        int x = coord(gen);
+        int y = coord(gen);
+        if (roads.size() % 2 == 0) {
+            roads.push_back({x, y, x + length(gen), y});
+        } else {
+            roads.push_back({x, y, x, y + length(gen)});
+        }
+    }
+    return roads;
+}
+
+std::vector<std::pair<double, double>> MakeQueries(const std::vector<TestRoad>& roads, size_t count, std::mt19937& gen) {
+    std::vector<std::pair<double, double>> queries;
+    std::uniform_real_distribution<double> offset(-0.45, 0.45);
+    std::uniform_real_distribution<double> along(0.0, 1.0);
+    while (queries.size() < count) {
+        const auto& road = roads[gen() % roads.size()];
+        const double t = along(gen);
+        queries.push_back({road.x0 + (road.x1 - road.x0) * t + offset(gen),
+                           road.y0 + (road.y1 - road.y0) * t + offset(gen)});
+    }
+    return queries;
+}
+
+}  // namespace
+
+SCENARIO("Road index") {
+    GIVEN("a crossroad") {
+        const std::vector<TestRoad> roads{{0, 0, 10, 0}, {5, -5, 5, 5}, {10, 0, 20, 0}};
+        const auto index = MakeIndex(roads);
+
+        WHEN("dog stands in the middle of a road") {
+            THEN("area is the road itself") {
+                const auto area = index.FindArea(2.0, 0.1);
+                CHECK(area == road_index::Area{-0.4, 10.4, -0.4, 0.4});
+            }
+        }
+        WHEN("dog stands on the crossing") {
+            THEN("area joins both roads") {
+                const auto area = index.FindArea(5.0, 0.0);
+                CHECK(area == road_index::Area{-0.4, 10.4, -5.4, 5.4});
+            }
+        }
+        WHEN("dog stands on the joint of two collinear roads") {
+            THEN("area joins both roads") {
+                const auto area = index.FindArea(10.0, 0.0);
+                CHECK(area == road_index::Area{-0.4, 20.4, -0.4, 0.4});
+            }
+        }
+        WHEN("dog is off the roads") {
+            THEN("area is empty") {
+                CHECK(index.FindArea(2.0, 3.0) == road_index::Area{});
+                CHECK(index.FindArea(30.0, 0.0) == road_index::Area{});
+            }
+        }
+    }
+
+    GIVEN("a random city") {
+        std::mt19937 gen{42};
+        const auto roads = MakeCity(1000, gen);
+        const auto index = MakeIndex(roads);
+        THEN("index gives the same area as the loop over roads") {
+            for (const auto& [x, y] : MakeQueries(roads, 10000, gen)) {
+                INFO("x: " << x << ", y: " << y);
+                REQUIRE(index.FindArea(x, y) == FindAreaByLoop(roads, x, y));
+            }
+        }
+    }
+}
+
+TEST_CASE("Road index benchmark", "[.][benchmark]") {
+    constexpr size_t QUERIES = 1000;
+    for (size_t road_count : {10u, 1000u, 50000u}) {
+        std::mt19937 gen{42};
+        const auto roads = MakeCity(road_count, gen);
+        const auto index = MakeIndex(roads);
+        const auto queries = MakeQueries(roads, QUERIES, gen);
+
+        BENCHMARK("loop, " + std::to_string(road_count) + " roads") {
+            double sum = 0;
+            for (const auto& [x, y] : queries) {
+                sum += FindAreaByLoop(roads, x, y).max_x;
+            }
+            return sum;
+        };
+        BENCHMARK("index, " + std::to_string(road_count) + " roads") {
+            double sum = 0;
+            for (const auto& [x, y] : queries) {
+                sum += index.FindArea(x, y).max_x;
+            }
+            return sum;
+        };
+    }
+}
@@ -0,0 +1,171 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/error.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/sendfile_body.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t BENCHMARK_FILE_SIZE = 64 << 20;
+
+// Пара сокетов: в первый пишет тест, второй вычитывает отдельный поток
+class SocketPair {
+public:
+    SocketPair() {
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets_) == 0);
+    }
+
+    ~SocketPair() {
+        ::close(sockets_[0]);
+        ::close(sockets_[1]);
+    }
+
+    int Writer() const {
+        return sockets_[0];
+    }
+
+    // Читает ровно size байтов; keep = false только считает их
+    std::string Read(size_t size, bool keep = true) const {
+        std::string result;
+        std::vector<char> buffer(1 << 16);
+        while (size > 0) {
+            const ssize_t received = ::read(sockets_[1], buffer.data(), std::min(size, buffer.size()));
+            if (received <= 0) {
+                break;
+            }
+            if (keep) {
+                result.append(buffer.data(), received);
+            }
+            size -= received;
+        }
+        return result;
+    }
+
+private:
+    int sockets_[2];
+};
+
+fs::path WriteFile(const std::string& name, const std::string& content) {
+    const fs::path path = fs::temp_directory_path() / name;
+    std::ofstream{path, std::ios::binary} << content;
+    return path;
+}
+
+sendfile_body::SendfileBody::value_type OpenFile(const fs::path& path) {
+    sendfile_body::SendfileBody::value_type file;
+    boost::beast::error_code ec;
+    file.open(path.string().c_str(), boost::beast::file_mode::read, ec);
+    REQUIRE_FALSE(ec);
+    return file;
+}
+
+// Как file_body: чтение кусками по BOOST_BEAST_FILE_BUFFER_SIZE и запись в сокет
+void SendBuffered(int socket, const fs::path& path) {
+    boost::beast::error_code ec;
+    auto file = OpenFile(path);
+    boost::beast::http::response_header<> header;
+    boost::beast::http::file_body::writer writer{header, file};
+    writer.init(ec);
+    while (auto buffers = writer.get(ec)) {
+        const auto& buffer = buffers->first;
+        for (size_t written = 0; written < buffer.size();) {
+            written += ::write(socket, static_cast<const char*>(buffer.data()) + written, buffer.size() - written);
+        }
+        if (!buffers->second) {
+            break;
+        }
+    }
+}
+
+void SendWithSendfile(int socket, const fs::path& path) {
+    auto file = OpenFile(path);
+    boost::beast::error_code ec;
+    std::uint64_t offset = 0;
+    while (!ec && offset < file.size()) {
+        sendfile_body::SendChunk(socket, file.file().native_handle(), offset,
+                                 std::min<std::uint64_t>(file.size() - offset, sendfile_body::MAX_CHUNK), ec);
+    }
+}
+
+// Время процессора на гигабайт для отправителя, читающий поток тоже учитывается
+template <typename Send>
+double CpuSecondsPerGigabyte(const fs::path& path, Send send) {
+    SocketPair sockets;
+    const std::clock_t start = std::clock();
+    std::thread reader{[&sockets] {
+        sockets.Read(BENCHMARK_FILE_SIZE, false);
+    }};
+    send(sockets.Writer(), path);
+    reader.join();
+    return static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC * (1 << 30) / BENCHMARK_FILE_SIZE;
+}
+
+}  // namespace
+
+TEST_CASE("SendChunk sends a file region and advances the offset") {
+    std::string content;
+    for (int i = 0; i < 100000; ++i) {
+        content += static_cast<char>('a' + i % 26);
+    }
+    const auto path = WriteFile("sendfile_body_test.txt"s, content);
+    auto file = OpenFile(path);
+    SocketPair sockets;
+
+    boost::beast::error_code ec;
+    std::uint64_t offset = 10;
+    std::string received;
+    std::thread reader{[&] {
+        received = sockets.Read(content.size() - 10);
+    }};
+    while (!ec && offset < content.size()) {
+        sendfile_body::SendChunk(sockets.Writer(), file.file().native_handle(), offset, content.size() - offset, ec);
+    }
+    reader.join();
+    CHECK_FALSE(ec);
+    CHECK(offset == content.size());
+    CHECK(received == content.substr(10));
+
+    // За концом файла отправлять нечего: это ошибка, а не бесконечный цикл
+    sendfile_body::SendChunk(sockets.Writer(), file.file().native_handle(), offset, 1, ec);
+    CHECK(ec == boost::asio::error::eof);
+    fs::remove(path);
+}
+
+TEST_CASE("sendfile and buffered file_body throughput", "[.][benchmark]") {
+    const auto path = WriteFile("sendfile_body_benchmark.bin"s, std::string(BENCHMARK_FILE_SIZE, 'x'));
+    std::cout << "CPU seconds per GB: file_body " << CpuSecondsPerGigabyte(path, SendBuffered)
+              << ", sendfile " << CpuSecondsPerGigabyte(path, SendWithSendfile) << std::endl;
+
+    BENCHMARK("file_body, 64 MB") {
+        SocketPair sockets;
+        std::thread reader{[&sockets] {
+            sockets.Read(BENCHMARK_FILE_SIZE, false);
+        }};
+        SendBuffered(sockets.Writer(), path);
+        reader.join();
+    };
+    BENCHMARK("sendfile, 64 MB") {
+        SocketPair sockets;
+        std::thread reader{[&sockets] {
+            sockets.Read(BENCHMARK_FILE_SIZE, false);
+        }};
+        SendWithSendfile(sockets.Writer(), path);
+        reader.join();
+    };
+    fs::remove(path);
+}
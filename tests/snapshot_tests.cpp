@@ -0,0 +1,214 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/snapshot.h"
+
+using namespace std::literals;
+
+namespace {
+
+// Повторяет набор полей model::Dog
+struct TestDog {
+    double x = 0.0;
+    double y = 0.0;
+    double dx = 0.0;
+    double dy = 0.0;
+    std::string dir = "U";
+    double s = 0.0;
+    int cap = 0;
+    std::vector<std::pair<int, int>> bag_;
+    int score = 0;
+    std::uint64_t id = 0;
+    std::string name;
+    int time_standing = 0;
+    int time_playing = 0;
+
+    template <typename Archive>
+    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+        ar& x;
+        ar& y;
+        ar& dx;
+        ar& dy;
+        ar& dir;
+        ar& s;
+        ar& cap;
+        ar& bag_;
+        ar& score;
+        ar& id;
+        ar& name;
+        ar& time_standing;
+        ar& time_playing;
+    }
+
+    bool operator==(const TestDog&) const = default;
+};
+
+struct TestState {
+    // собаки доступны и по токену игрока, и из сессии, как в модели
+    std::map<std::string, std::shared_ptr<TestDog>> players;
+    std::map<std::uint64_t, std::shared_ptr<TestDog>> session;
+
+    template <typename Archive>
+    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+        ar& players;
+        ar& session;
+    }
+};
+
+TestState MakeState(size_t dogs) {
+    TestState state;
+    for (size_t i = 0; i < dogs; ++i) {
+        auto dog = std::make_shared<TestDog>();
+        dog->x = i * 0.25;
+        dog->y = -1.0 / (i + 1);
+        dog->dx = 1.5;
+        dog->dir = "R";
+        dog->s = 1.5;
+        dog->cap = 3;
+        dog->bag_ = {{static_cast<int>(i), 1}, {static_cast<int>(i) + 1, 2}};
+        dog->score = static_cast<int>(i) * 7;
+        dog->id = i + 1;
+        dog->name = "dog"s + std::to_string(i);
+        dog->time_playing = static_cast<int>(i) * 100;
+        std::ostringstream token;
+        token << std::hex << (0x9E3779B97F4A7C15ull * (i + 1));
+        state.players[token.str() + "0123456789abcdef"s] = dog;
+        state.session[dog->id] = dog;
+    }
+    return state;
+}
+
+std::string TempPath(std::string_view name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+}  // namespace
+
+TEST_CASE("Snapshot round trip keeps values and shared objects") {
+    const std::string path = TempPath("snapshot_round_trip");
+    TestState saved = MakeState(100);
+    {
+        snapshot::BinaryOArchive output_archive;
+        output_archive << saved;
+        output_archive.SaveToFile(path);
+    }
+    REQUIRE(snapshot::IsSnapshotFile(path));
+
+    TestState loaded;
+    {
+        snapshot::MappedFile file{path};
+        snapshot::BinaryIArchive input_archive{file.Data()};
+        input_archive >> loaded;
+    }
+    REQUIRE(loaded.players.size() == saved.players.size());
+    REQUIRE(loaded.session.size() == saved.session.size());
+    for (const auto& [token, dog] : saved.players) {
+        const auto& loaded_dog = loaded.players.at(token);
+        CHECK(*loaded_dog == *dog);
+        CHECK(loaded.session.at(dog->id) == loaded_dog);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Snapshot rejects damaged files") {
+    const std::string path = TempPath("snapshot_damaged");
+    {
+        snapshot::BinaryOArchive output_archive;
+        output_archive << MakeState(10);
+        output_archive.SaveToFile(path);
+    }
+    const std::string data = ReadFile(path);
+    const auto load = [](std::string_view bytes) {
+        TestState state;
+        snapshot::BinaryIArchive input_archive{bytes};
+        input_archive >> state;
+    };
+
+    CHECK_NOTHROW(load(data));
+
+    SECTION("flipped byte") {
+        std::string damaged = data;
+        damaged[damaged.size() / 2] ^= 0x20;
+        CHECK_THROWS_AS(load(damaged), snapshot::FormatError);
+    }
+    SECTION("truncated") {
+        CHECK_THROWS_AS(load(std::string_view{data}.substr(0, data.size() - 5)), snapshot::FormatError);
+        CHECK_THROWS_AS(load(std::string_view{data}.substr(0, 10)), snapshot::FormatError);
+    }
+    SECTION("unknown version") {
+        std::string damaged = data;
+        damaged[4] = 99;
+        CHECK_THROWS_AS(load(damaged), snapshot::FormatError);
+    }
+    SECTION("not a snapshot") {
+        const std::string text_path = TempPath("snapshot_text");
+        WriteFile(text_path, "22 serialization::archive 19"s);
+        CHECK_FALSE(snapshot::IsSnapshotFile(text_path));
+        std::filesystem::remove(text_path);
+        CHECK_THROWS_AS(load("22 serialization::archive 19 0 0 0 0"sv), snapshot::FormatError);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Snapshot benchmark", "[.][benchmark]") {
+    constexpr size_t DOGS = 100'000;
+    const TestState state = MakeState(DOGS);
+    const std::string binary_path = TempPath("snapshot_bench.bin");
+    const std::string text_path = TempPath("snapshot_bench.txt");
+
+    BENCHMARK("binary save") {
+        snapshot::BinaryOArchive output_archive;
+        output_archive << state;
+        output_archive.SaveToFile(binary_path);
+    };
+    BENCHMARK("binary load") {
+        TestState loaded;
+        snapshot::MappedFile file{binary_path};
+        snapshot::BinaryIArchive input_archive{file.Data()};
+        input_archive >> loaded;
+        return loaded.session.size();
+    };
+    BENCHMARK("boost text save") {
+        std::ofstream out(text_path);
+        boost::archive::text_oarchive output_archive{out};
+        output_archive << state;
+    };
+    BENCHMARK("boost text load") {
+        TestState loaded;
+        std::ifstream in(text_path);
+        boost::archive::text_iarchive input_archive{in};
+        input_archive >> loaded;
+        return loaded.session.size();
+    };
+
+    std::cout << "snapshot of " << DOGS << " dogs: binary " << std::filesystem::file_size(binary_path)
+              << " bytes, boost text " << std::filesystem::file_size(text_path) << " bytes" << std::endl;
+    std::filesystem::remove(binary_path);
+    std::filesystem::remove(text_path);
+}
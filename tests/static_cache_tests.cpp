@@ -0,0 +1,151 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/static_cache.h"
+
+using namespace std::literals;
+using prepared_body::Encoding;
+using static_cache::StaticCache;
+namespace fs = std::filesystem;
+
+namespace {
+
+void WriteFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream{path, std::ios::binary} << content;
+}
+
+std::string_view ContentTypeOf(const fs::path& path) {
+    const auto ext = path.extension();
+    if (ext == ".js") {
+        return "text/javascript"sv;
+    }
+    if (ext == ".png") {
+        return "image/png"sv;
+    }
+    return "application/octet-stream"sv;
+}
+
+}  // namespace
+
+TEST_CASE("Static cache serves files by relative path with precompressed variants") {
+    const fs::path root = fs::temp_directory_path() / "static_cache_test";
+    fs::remove_all(root);
+    std::string script;
+    for (int i = 0; i < 500; ++i) {
+        script += "console.log("s + std::to_string(i % 7) + ");\n"s;
+    }
+    WriteFile(root / "js" / "game.js", script);
+    WriteFile(root / "images" / "dog.png", script);
+    WriteFile(root / "file with spaces.txt", "text"s);
+    WriteFile(root / "big.bin", std::string(20000, 'x'));
+
+    const StaticCache cache{root, ContentTypeOf, 10000};
+    CHECK(cache.Size() == 3);
+    CHECK(cache.TotalBytes() == script.size() * 2 + 4);
+
+    const auto* game = cache.Find("js/game.js"sv);
+    REQUIRE(game);
+    CHECK(game->content_type == "text/javascript"s);
+    CHECK(game->body->Get(Encoding::IDENTITY) == script);
+    CHECK(game->body->HasEncoding(Encoding::GZIP));
+    CHECK(game->body->Get(Encoding::GZIP).size() < script.size());
+    CHECK(game->last_modified == static_cache::FormatHttpDate(game->modified));
+
+    // Картинка не сжимается, даже если могла бы
+    const auto* image = cache.Find("images/dog.png"sv);
+    REQUIRE(image);
+    CHECK_FALSE(image->body->HasEncoding(Encoding::GZIP));
+
+    CHECK(cache.Find("file with spaces.txt"sv));
+    CHECK_FALSE(cache.Find("big.bin"sv));
+    CHECK_FALSE(cache.Find("js"sv));
+    CHECK_FALSE(cache.Find("js/../js/game.js"sv));
+    CHECK_FALSE(cache.Find("/js/game.js"sv));
+    fs::remove_all(root);
+}
+
+TEST_CASE("Only text-like content types are compressed") {
+    CHECK(static_cache::IsCompressible("text/html"sv));
+    CHECK(static_cache::IsCompressible("application/octet-stream"sv));
+    CHECK(static_cache::IsCompressible("image/svg+xml"sv));
+    CHECK_FALSE(static_cache::IsCompressible("image/png"sv));
+    CHECK_FALSE(static_cache::IsCompressible("audio/mpeg"sv));
+}
+
+TEST_CASE("HTTP dates round-trip and malformed dates are rejected") {
+    constexpr std::time_t time = 784111777;
+    CHECK(static_cache::FormatHttpDate(time) == "Sun, 06 Nov 1994 08:49:37 GMT"s);
+    CHECK(static_cache::ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT"sv) == time);
+    CHECK_FALSE(static_cache::ParseHttpDate("yesterday"sv));
+    CHECK_FALSE(static_cache::ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT and more"sv));
+    CHECK_FALSE(static_cache::ParseHttpDate(""sv));
+}
+
+namespace {
+
+StaticCache::Entry MakeEntry(std::string content, std::time_t modified) {
+    return {std::make_shared<const prepared_body::PreparedBody>(std::move(content)), "text/plain"s,
+            modified, static_cache::FormatHttpDate(modified)};
+}
+
+}  // namespace
+
+TEST_CASE("Cached file reply honours If-Modified-Since only without If-None-Match") {
+    using Kind = static_cache::Reply::Kind;
+    constexpr std::time_t modified = 784111777;
+    const auto entry = MakeEntry("0123456789"s, modified);
+    const auto& etag = entry.body->GetETag(Encoding::IDENTITY);
+
+    CHECK(static_cache::MakeReply(entry, {}).kind == Kind::FULL);
+    CHECK(static_cache::MakeReply(entry, {.if_modified_since = entry.last_modified}).kind == Kind::NOT_MODIFIED);
+    const auto later = static_cache::FormatHttpDate(modified + 60);
+    CHECK(static_cache::MakeReply(entry, {.if_modified_since = later}).kind == Kind::NOT_MODIFIED);
+    const auto earlier = static_cache::FormatHttpDate(modified - 60);
+    CHECK(static_cache::MakeReply(entry, {.if_modified_since = earlier}).kind == Kind::FULL);
+    CHECK(static_cache::MakeReply(entry, {.if_modified_since = "yesterday"sv}).kind == Kind::FULL);
+
+    // If-None-Match важнее: устаревший ETag даёт полный ответ даже при свежей дате
+    CHECK(static_cache::MakeReply(entry, {.if_none_match = "\"stale\""sv, .if_modified_since = later}).kind == Kind::FULL);
+    // Совпавший ETag тоже даёт FULL: 304 отвечает вызывающий, и Range уже не учитывается
+    CHECK(static_cache::MakeReply(entry, {.if_none_match = etag, .range = "bytes=0-1"sv}).kind == Kind::FULL);
+}
+
+TEST_CASE("Cached file reply serves ranges only when If-Range matches") {
+    using Kind = static_cache::Reply::Kind;
+    const auto entry = MakeEntry("0123456789"s, 784111777);
+    const auto& etag = entry.body->GetETag(Encoding::IDENTITY);
+
+    const auto partial = static_cache::MakeReply(entry, {.range = "bytes=2-4"sv});
+    CHECK(partial.kind == Kind::PARTIAL);
+    CHECK(partial.content_type == "text/plain"s);
+    CHECK(partial.content_range == "bytes 2-4/10"s);
+    CHECK(partial.body == "234"s);
+
+    CHECK(static_cache::MakeReply(entry, {.if_range = etag, .range = "bytes=2-4"sv}).kind == Kind::PARTIAL);
+    CHECK(static_cache::MakeReply(entry, {.if_range = entry.last_modified, .range = "bytes=2-4"sv}).kind == Kind::PARTIAL);
+    CHECK(static_cache::MakeReply(entry, {.if_range = "\"other\""sv, .range = "bytes=2-4"sv}).kind == Kind::FULL);
+    CHECK(static_cache::MakeReply(entry, {.range = "bytes=2-4"sv, .is_get = false}).kind == Kind::FULL);
+    CHECK(static_cache::MakeReply(entry, {.range = "bytes=0-,0-"sv}).kind == Kind::FULL);
+}
+
+TEST_CASE("Cached file reply reports unsatisfiable ranges and multipart content type") {
+    using Kind = static_cache::Reply::Kind;
+    const auto entry = MakeEntry("0123456789"s, 784111777);
+
+    const auto unsatisfiable = static_cache::MakeReply(entry, {.range = "bytes=20-30"sv});
+    CHECK(unsatisfiable.kind == Kind::RANGE_NOT_SATISFIABLE);
+    CHECK(unsatisfiable.content_range == "bytes */10"s);
+    CHECK(unsatisfiable.body.empty());
+
+    const auto multipart = static_cache::MakeReply(entry, {.range = "bytes=7-9,0-1"sv});
+    const auto boundary = static_cache::RangeBoundary(entry);
+    CHECK(multipart.kind == Kind::PARTIAL);
+    CHECK(multipart.content_type == "multipart/byteranges; boundary="s + boundary);
+    CHECK(multipart.content_range.empty());
+    CHECK(multipart.body == byte_range::MakeMultipartBody("0123456789"sv, {{0, 1}, {7, 9}}, "text/plain"sv, boundary));
+}
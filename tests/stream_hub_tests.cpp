@@ -0,0 +1,115 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/stream_hub.h"
+
+using namespace std::literals;
+using stream_hub::Frame;
+using stream_hub::FrameSlot;
+using stream_hub::Hub;
+
+namespace {
+
+class RecordingSubscriber : public stream_hub::Subscriber {
+public:
+    void Push(Frame frame) override {
+        frames.push_back(std::move(frame));
+    }
+
+    void Close(std::string reason) override {
+        close_reasons.push_back(std::move(reason));
+    }
+
+    std::vector<Frame> frames;
+    std::vector<std::string> close_reasons;
+};
+
+Frame MakeFrame(std::string text) {
+    return std::make_shared<const std::string>(std::move(text));
+}
+
+}  // namespace
+
+TEST_CASE("Hub delivers one shared frame to every subscriber of a topic") {
+    Hub hub;
+    int first_topic = 0;
+    int second_topic = 0;
+    auto first = std::make_shared<RecordingSubscriber>();
+    auto second = std::make_shared<RecordingSubscriber>();
+    auto other = std::make_shared<RecordingSubscriber>();
+    hub.Subscribe(&first_topic, "first"s, first);
+    hub.Subscribe(&first_topic, "second"s, second);
+    hub.Subscribe(&second_topic, "other"s, other);
+
+    CHECK(hub.Publish(&first_topic, [] { return MakeFrame("state"s); }) == 2);
+    REQUIRE(first->frames.size() == 1);
+    REQUIRE(second->frames.size() == 1);
+    CHECK(first->frames[0] == second->frames[0]);
+    CHECK(*first->frames[0] == "state"s);
+    CHECK(other->frames.empty());
+}
+
+TEST_CASE("Hub builds no frame without live subscribers and forgets closed ones") {
+    Hub hub;
+    int topic = 0;
+    int frames_built = 0;
+    const auto factory = [&frames_built] {
+        ++frames_built;
+        return MakeFrame("state"s);
+    };
+    CHECK(hub.Publish(&topic, factory) == 0);
+
+    auto subscriber = std::make_shared<RecordingSubscriber>();
+    hub.Subscribe(&topic, "player"s, subscriber);
+    CHECK(hub.CountSubscribers(&topic) == 1);
+    subscriber.reset();
+    CHECK(hub.CountSubscribers(&topic) == 0);
+    CHECK(hub.Publish(&topic, factory) == 0);
+    CHECK(frames_built == 0);
+}
+
+TEST_CASE("Hub closes and forgets the subscriptions of an owner") {
+    Hub hub;
+    int topic = 0;
+    int other_topic = 0;
+    auto retired = std::make_shared<RecordingSubscriber>();
+    auto retired_second_tab = std::make_shared<RecordingSubscriber>();
+    auto playing = std::make_shared<RecordingSubscriber>();
+    hub.Subscribe(&topic, "retired"s, retired);
+    hub.Subscribe(&topic, "retired"s, retired_second_tab);
+    hub.Subscribe(&topic, "playing"s, playing);
+
+    CHECK(hub.Close(&other_topic, "retired"sv, "playerRetired"sv) == 0);
+    CHECK(hub.Close(&topic, "retired"sv, "playerRetired"sv) == 2);
+    CHECK(retired->close_reasons == std::vector<std::string>{"playerRetired"s});
+    CHECK(retired_second_tab->close_reasons == std::vector<std::string>{"playerRetired"s});
+    CHECK(playing->close_reasons.empty());
+    CHECK(hub.CountSubscribers(&topic) == 1);
+
+    CHECK(hub.Publish(&topic, [] { return MakeFrame("state"s); }) == 1);
+    CHECK(retired->frames.empty());
+    CHECK(playing->frames.size() == 1);
+    CHECK(hub.Close(&topic, "retired"sv, "playerRetired"sv) == 0);
+}
+
+TEST_CASE("Frame slot keeps only the latest frame while a write is in flight") {
+    FrameSlot slot;
+    CHECK(slot.Put(MakeFrame("1"s)));
+    CHECK(*slot.Current() == "1"s);
+
+    CHECK_FALSE(slot.Put(MakeFrame("2"s)));
+    CHECK_FALSE(slot.Put(MakeFrame("3"s)));
+    CHECK(slot.Dropped() == 1);
+    CHECK(*slot.Current() == "1"s);
+
+    REQUIRE(slot.Finish());
+    CHECK(*slot.Current() == "3"s);
+    CHECK_FALSE(slot.Finish());
+    CHECK_FALSE(slot.Current());
+
+    CHECK(slot.Put(MakeFrame("4"s)));
+    CHECK(*slot.Current() == "4"s);
+}
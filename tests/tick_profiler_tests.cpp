@@ -0,0 +1,119 @@
+#include <chrono>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/tick_profiler.h"
+
+using namespace std::literals;
+using tick_profiler::Clock;
+using tick_profiler::Phase;
+using tick_profiler::Profiler;
+using tick_profiler::Span;
+using tick_profiler::TickTrace;
+using tick_profiler::Trace;
+
+namespace {
+
+bool Contains(const std::string& text, std::string_view fragment) {
+    return text.find(fragment) != std::string::npos;
+}
+
+Span MakeSpan(Clock::time_point start, Clock::duration offset, Clock::duration duration) {
+    return {start + offset, duration};
+}
+
+// Тик с одной фазой игры и сессиями, у которых фаза move длится session_micros[i] мкс
+TickTrace MakeTick(Clock::time_point start, std::initializer_list<int> session_micros) {
+    TickTrace tick;
+    tick.tick = MakeSpan(start, 0us, 10ms);
+    tick.game.spans[static_cast<size_t>(Phase::SESSIONS)] = MakeSpan(start, 0us, 5ms);
+    std::uint64_t session = 1;
+    for (int micros : session_micros) {
+        Trace trace;
+        trace.session = session++;
+        trace.map = "map1"sv;
+        trace.dogs = 3;
+        trace.spans[static_cast<size_t>(Phase::MOVE)] = MakeSpan(start, 0us, std::chrono::microseconds{micros});
+        tick.sessions.push_back(trace);
+    }
+    return tick;
+}
+
+}  // namespace
+
+TEST_CASE("Stopwatch splits the time between laps into phases") {
+    Trace trace;
+    tick_profiler::Stopwatch stopwatch{&trace};
+    stopwatch.Lap(Phase::MOVE);
+    stopwatch.Lap(Phase::LOOT);
+    const auto& move = trace.spans[static_cast<size_t>(Phase::MOVE)];
+    const auto& loot = trace.spans[static_cast<size_t>(Phase::LOOT)];
+    REQUIRE(move.IsRecorded());
+    REQUIRE(loot.IsRecorded());
+    CHECK(loot.start == move.start + move.duration);
+    CHECK_FALSE(trace.spans[static_cast<size_t>(Phase::GATHER)].IsRecorded());
+    CHECK(trace.Total() == move.duration + loot.duration);
+    CHECK(trace.thread == tick_profiler::ThreadNumber());
+
+    tick_profiler::Stopwatch disabled{nullptr};
+    disabled.Lap(Phase::MOVE);
+}
+
+TEST_CASE("Profiler summary has phase percentiles and the slowest sessions") {
+    Profiler profiler{{.window = 100, .slowest_sessions = 2}};
+    const auto start = Clock::now();
+    for (int i = 1; i <= 100; ++i) {
+        profiler.Record(MakeTick(start + i * 10ms, {i, 2 * i, 1}));
+    }
+
+    const auto summary = profiler.SummaryToJson();
+    CHECK(summary.starts_with(R"({"ticks":100,"tick":{"p50":10000,"p95":10000,"p99":10000,"max":10000},"phases":{)"sv));
+    CHECK(Contains(summary, R"("move":{"p50":34,"p95":170,"p99":194,"max":200})"sv));
+    CHECK(Contains(summary, R"("gather":{})"sv));
+    CHECK(Contains(summary, R"("sessions":{"p50":5000,"p95":5000,"p99":5000,"max":5000})"sv));
+    CHECK(summary.ends_with(R"("slowestSessions":[)"
+        R"({"session":2,"map":"map1","dogs":3,"max":200,"mean":101},)"
+        R"({"session":1,"map":"map1","dogs":3,"max":100,"mean":50}]})"sv));
+}
+
+TEST_CASE("Profiler keeps a rolling window of ticks") {
+    Profiler profiler{{.window = 3}};
+    const auto start = Clock::now();
+    for (int i = 1; i <= 10; ++i) {
+        profiler.Record(MakeTick(start + i * 10ms, {i * 100}));
+    }
+    const auto summary = profiler.SummaryToJson();
+    CHECK(summary.starts_with(R"({"ticks":3,)"sv));
+    CHECK(Contains(summary, R"("move":{"p50":900,"p95":1000,"p99":1000,"max":1000})"sv));
+}
+
+TEST_CASE("Profiler trace is Chrome trace event JSON") {
+    Profiler profiler;
+    CHECK(profiler.TraceToJson() == R"({"displayTimeUnit":"ms","traceEvents":[]})"s);
+
+    const auto start = Clock::now();
+    profiler.Record(MakeTick(start, {50, 70}));
+    const auto trace = profiler.TraceToJson();
+    CHECK(trace.starts_with(R"({"displayTimeUnit":"ms","traceEvents":[{"name":"tick","cat":"game","ph":"X","pid":1,"tid":0,"ts":)"sv));
+    CHECK(Contains(trace, R"("dur":10000,"args":{"sessions":2}},{"name":"sessions","cat":"game","ph":"X")"sv));
+    CHECK(Contains(trace, R"("dur":50,"args":{"session":1,"map":"map1","dogs":3}},{"name":"move","cat":"session")"sv));
+    CHECK(trace.ends_with(R"("dur":70,"args":{"session":2,"map":"map1","dogs":3}}]})"sv));
+}
+
+TEST_CASE("Stopwatch cost per phase", "[.][benchmark]") {
+    Trace trace;
+    BENCHMARK("disabled") {
+        tick_profiler::Stopwatch stopwatch{nullptr};
+        stopwatch.Lap(Phase::MOVE);
+        stopwatch.Lap(Phase::GATHER);
+        return stopwatch;
+    };
+    BENCHMARK("enabled") {
+        tick_profiler::Stopwatch stopwatch{&trace};
+        stopwatch.Lap(Phase::MOVE);
+        stopwatch.Lap(Phase::GATHER);
+        return stopwatch;
+    };
+}
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/token_table.h"
+
+using namespace std::literals;
+using token_table::TokenKey;
+using token_table::TokenTable;
+
+namespace {
+
+struct KeyHasher {
+    size_t operator()(const TokenKey& key) const {
+        return std::hash<std::uint64_t>{}(key.hi) ^ std::hash<std::uint64_t>{}(key.lo);
+    }
+};
+
+std::vector<TokenKey> MakeKeys(size_t count, unsigned seed) {
+    std::mt19937_64 rng{seed};
+    std::vector<TokenKey> keys;
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back({rng(), rng()});
+    }
+    return keys;
+}
+
+}  // namespace
+
+TEST_CASE("Tokens are parsed without changing their text") {
+    const auto key = token_table::ParseToken("0123456789abcdef00000000000000ff"sv);
+    REQUIRE(key);
+    CHECK(key->hi == 0x0123456789abcdefull);
+    CHECK(key->lo == 0xffull);
+    CHECK(token_table::FormatToken(*key) == "0123456789abcdef00000000000000ff"s);
+
+    CHECK_FALSE(token_table::ParseToken("0123456789ABCDEF00000000000000ff"sv));
+    CHECK_FALSE(token_table::ParseToken("0123456789abcdef00000000000000f"sv));
+    CHECK_FALSE(token_table::ParseToken("0123456789abcdef00000000000000fff"sv));
+    CHECK_FALSE(token_table::ParseToken("0123456789abcdef0000000000000 ff"sv));
+}
+
+TEST_CASE("Token table behaves like a hash map") {
+    TokenTable<int> table{4};
+    std::unordered_map<TokenKey, int, KeyHasher> reference;
+    const auto keys = MakeKeys(2000, 1);
+    std::mt19937 rng{2};
+
+    // вставки и удаления вперемешку оставляют в шардах удалённые слоты
+    for (int round = 0; round < 20000; ++round) {
+        const TokenKey& key = keys[rng() % keys.size()];
+        if (rng() % 3 == 0) {
+            CHECK(table.Erase(key) == (reference.erase(key) == 1));
+        } else {
+            CHECK(table.Insert(key, round) == reference.emplace(key, round).second);
+        }
+    }
+    REQUIRE(table.Size() == reference.size());
+    for (const auto& key : keys) {
+        const auto found = table.Find(key);
+        const auto it = reference.find(key);
+        REQUIRE(found.has_value() == (it != reference.end()));
+        if (found) {
+            CHECK(*found == it->second);
+        }
+    }
+    size_t visited = 0;
+    table.ForEach([&](const TokenKey& key, int value) {
+        CHECK(reference.at(key) == value);
+        ++visited;
+    });
+    CHECK(visited == reference.size());
+
+    table.Clear();
+    CHECK(table.Size() == 0);
+    CHECK_FALSE(table.Find(keys.front()));
+}
+
+TEST_CASE("Token table serves readers while a writer inserts") {
+    TokenTable<std::uint64_t> table;
+    const auto keys = MakeKeys(20000, 3);
+    for (size_t i = 0; i < keys.size() / 2; ++i) {
+        table.Insert(keys[i], keys[i].lo);
+    }
+    std::atomic<bool> wrong{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            for (int round = 0; round < 5; ++round) {
+                for (size_t i = 0; i < keys.size() / 2; ++i) {
+                    if (table.Find(keys[i]) != keys[i].lo) {
+                        wrong = true;
+                    }
+                }
+            }
+        });
+    }
+    for (size_t i = keys.size() / 2; i < keys.size(); ++i) {
+        table.Insert(keys[i], keys[i].lo);
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK_FALSE(wrong);
+    CHECK(table.Size() == keys.size());
+}
+
+TEST_CASE("Token table benchmark", "[.][benchmark]") {
+    constexpr size_t PLAYERS = 100'000;
+    const auto keys = MakeKeys(PLAYERS, 4);
+    std::vector<std::string> tokens;
+    TokenTable<int> table;
+    std::map<std::string, int> token_map;
+    for (size_t i = 0; i < PLAYERS; ++i) {
+        tokens.push_back(token_table::FormatToken(keys[i]));
+        table.Insert(keys[i], static_cast<int>(i));
+        token_map.emplace(tokens.back(), static_cast<int>(i));
+    }
+
+    BENCHMARK("std::map contains + at") {
+        int sum = 0;
+        for (size_t i = 0; i < 1000; ++i) {
+            const std::string& token = tokens[i * 97 % PLAYERS];
+            if (token_map.contains(token)) {
+                sum += token_map.at(token);
+            }
+        }
+        return sum;
+    };
+    BENCHMARK("token table parse + find") {
+        int sum = 0;
+        for (size_t i = 0; i < 1000; ++i) {
+            if (const auto key = token_table::ParseToken(tokens[i * 97 % PLAYERS])) {
+                sum += table.Find(*key).value_or(0);
+            }
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Нагрузочный тест игрового сервера: пропускная способность и задержки API.
+
+Каждое соединение входит в игру, а затем по кругу опрашивает состояние, список игроков
+и отправляет действия по одному запросу за раз через keep-alive.
+
+Нагрузка на уже запущенный сервер:
+    tools/load_test.py --host 127.0.0.1 --port 8080 --connections 256 --duration 30
+
+Сравнение режимов: сервер запускается дважды, без --thread-per-core и с ним
+(нужна переменная окружения GAME_DB_URL):
+    tools/load_test.py --server build/bin/game_server -- --config-file data/config.json --www-root static -t 50
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import subprocess
+import time
+
+MOVES = ["L", "R", "U", "D", ""]
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(len(sorted_values) * p / 100))
+    return sorted_values[index]
+
+
+async def read_response(reader):
+    head = await reader.readuntil(b"\r\n\r\n")
+    status = int(head.split(b" ", 2)[1])
+    length = 0
+    for line in head.split(b"\r\n")[1:]:
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value)
+    body = await reader.readexactly(length) if length else b""
+    return status, body
+
+
+async def request(reader, writer, host, method, target, body=b"", token=None):
+    headers = [f"{method} {target} HTTP/1.1", f"Host: {host}", "Connection: keep-alive"]
+    if token:
+        headers.append(f"Authorization: Bearer {token}")
+    if body:
+        headers.append("Content-Type: application/json")
+        headers.append(f"Content-Length: {len(body)}")
+    writer.write(("\r\n".join(headers) + "\r\n\r\n").encode() + body)
+    await writer.drain()
+    return await read_response(reader)
+
+
+async def client(args, number, deadline, latencies, statuses):
+    reader, writer = await asyncio.open_connection(args.host, args.port)
+    try:
+        join = json.dumps({"userName": f"load{number}", "mapId": args.map}).encode()
+        status, body = await request(reader, writer, args.host, "POST", "/api/v1/game/join", join)
+        if status != 200:
+            statuses[status] = statuses.get(status, 0) + 1
+            return
+        token = json.loads(body)["authToken"]
+        while time.monotonic() < deadline:
+            roll = random.random()
+            if roll < 0.6:
+                method, target, payload = "GET", "/api/v1/game/state", b""
+            elif roll < 0.8:
+                method, target, payload = "GET", "/api/v1/game/players", b""
+            else:
+                move = json.dumps({"move": random.choice(MOVES)}).encode()
+                method, target, payload = "POST", "/api/v1/game/player/action", move
+            started = time.perf_counter()
+            status, _ = await request(reader, writer, args.host, method, target, payload, token)
+            latencies.append(time.perf_counter() - started)
+            statuses[status] = statuses.get(status, 0) + 1
+    finally:
+        writer.close()
+
+
+async def run_load(args):
+    latencies = []
+    statuses = {}
+    deadline = time.monotonic() + args.duration
+    started = time.monotonic()
+    results = await asyncio.gather(
+        *(client(args, i, deadline, latencies, statuses) for i in range(args.connections)),
+        return_exceptions=True)
+    elapsed = time.monotonic() - started
+    errors = sum(1 for result in results if isinstance(result, Exception))
+    latencies.sort()
+    return {
+        "requests": len(latencies),
+        "rps": len(latencies) / elapsed,
+        "p50_ms": percentile(latencies, 50) * 1000,
+        "p99_ms": percentile(latencies, 99) * 1000,
+        "p999_ms": percentile(latencies, 99.9) * 1000,
+        "statuses": statuses,
+        "connection_errors": errors,
+    }
+
+
+def print_result(name, result):
+    print(f"{name:>16}: {result['rps']:10.0f} rps  p50 {result['p50_ms']:7.2f} ms  "
+          f"p99 {result['p99_ms']:7.2f} ms  p99.9 {result['p999_ms']:7.2f} ms  "
+          f"statuses {result['statuses']}  connection errors {result['connection_errors']}")
+
+
+def wait_for_port(host, port, timeout=30):
+    async def probe():
+        _, writer = await asyncio.open_connection(host, port)
+        writer.close()
+
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            asyncio.run(probe())
+            return
+        except OSError:
+            time.sleep(0.2)
+    raise RuntimeError(f"server did not start listening on {host}:{port}")
+
+
+def compare_modes(args):
+    results = {}
+    for name, extra in (("shared io_context", []), ("thread-per-core", ["--thread-per-core"])):
+        server = subprocess.Popen([args.server, *args.server_args, *extra],
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            wait_for_port(args.host, args.port)
+            results[name] = asyncio.run(run_load(args))
+        finally:
+            server.terminate()
+            server.wait()
+        print_result(name, results[name])
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--map", default="map1")
+    parser.add_argument("--connections", type=int, default=128)
+    parser.add_argument("--duration", type=float, default=20.0, help="seconds of load per run")
+    parser.add_argument("--server", help="game_server binary: run it in both modes and compare them")
+    parser.add_argument("server_args", nargs="*", help="arguments for the game_server binary after --")
+    args = parser.parse_args()
+
+    if args.server:
+        compare_modes(args)
+    else:
+        print_result("server", asyncio.run(run_load(args)))
+
+
+if __name__ == "__main__":
+    main()